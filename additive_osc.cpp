@@ -0,0 +1,191 @@
+// synth/additive_osc.cpp
+#include "additive_osc.h"
+#include "fft.h"
+#include "phase_accumulator.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iterator>
+
+namespace {
+
+constexpr int N = MonoAdditiveOscillator::FFT_SIZE;
+constexpr int H = MonoAdditiveOscillator::HOP;
+constexpr int KERNEL_HALF_WIDTH = 4;  // Blackman-Harris main lobe, in bins
+constexpr int KERNEL_OVERSAMPLE = 64; // kernel table points per bin
+
+// 4-term Blackman-Harris, -92 dB sidelobes.
+constexpr double BH[4] = {0.35875, 0.48829, 0.14128, 0.01168};
+
+struct AdditiveTables {
+    FFT fft{N};
+    // Zero-phase transform of the window, K(d) for d in [-4, 4] bins.
+    float kernel[2 * KERNEL_HALF_WIDTH * KERNEL_OVERSAMPLE + 2];
+    // Triangle / window / N over the central N/2 samples of a frame.
+    float synthesisWeight[2 * H];
+
+    AdditiveTables() {
+        // sum over n' in [-N/2, N/2) of e^{-2 pi i x n' / N}, closed form.
+        auto dirichlet = [](double x) {
+            double frac = x - std::round(x);
+            if (std::fabs(frac) < 1e-12) {
+                return std::fabs(x) < 1e-12 ? static_cast<double>(N) : 0.0;
+            }
+            std::complex<double> r = std::polar(1.0, -2.0 * M_PI * x / N);
+            std::complex<double> sum = std::pow(r, -N / 2) * (1.0 - std::pow(r, N)) / (1.0 - r);
+            return sum.real();
+        };
+        for (int i = 0; i < static_cast<int>(std::size(kernel)); ++i) {
+            double d = static_cast<double>(i) / KERNEL_OVERSAMPLE - KERNEL_HALF_WIDTH;
+            // The centred window is a0 + a1 cos + a2 cos(2x) + a3 cos(3x).
+            double k = BH[0] * dirichlet(d);
+            for (int j = 1; j < 4; ++j) {
+                k += 0.5 * BH[j] * (dirichlet(d - j) + dirichlet(d + j));
+            }
+            kernel[i] = static_cast<float>(k);
+        }
+
+        for (int j = 0; j < 2 * H; ++j) {
+            int n = N / 4 + j;
+            double w = BH[0] - BH[1] * std::cos(2.0 * M_PI * n / N) +
+                       BH[2] * std::cos(4.0 * M_PI * n / N) - BH[3] * std::cos(6.0 * M_PI * n / N);
+            double tri = (j < H) ? static_cast<double>(j) / H : static_cast<double>(2 * H - j) / H;
+            synthesisWeight[j] = static_cast<float>(tri / (w * N));
+        }
+    }
+
+    float kernelAt(float d) const {
+        float idx = (d + KERNEL_HALF_WIDTH) * KERNEL_OVERSAMPLE;
+        int i0 = static_cast<int>(idx);
+        float frac = idx - static_cast<float>(i0);
+        return kernel[i0] + (kernel[i0 + 1] - kernel[i0]) * frac;
+    }
+};
+
+const AdditiveTables TABLES;
+
+// Adds a * sin(theta + ...) centred on fractional bin `bin` to a half spectrum
+// [0, N/2], folding the part of the lobe that falls below DC back as its
+// conjugate.
+inline void addPartial(std::complex<float>* spectrum, float bin, float re, float im) {
+    int m0 = static_cast<int>(std::ceil(bin - KERNEL_HALF_WIDTH));
+    int m1 = static_cast<int>(std::floor(bin + KERNEL_HALF_WIDTH));
+    for (int m = m0; m <= m1; ++m) {
+        float k = TABLES.kernelAt(static_cast<float>(m) - bin);
+        if (m & 1) k = -k; // frame centre is at N/2
+        if (m > 0) {
+            spectrum[m] += std::complex<float>(re * k, im * k);
+        } else if (m < 0) {
+            spectrum[-m] += std::complex<float>(re * k, -im * k);
+        } else {
+            spectrum[0] += std::complex<float>(2.0f * re * k, 0.0f);
+        }
+    }
+}
+
+} // namespace
+
+template <int Channels>
+AdditiveOscillator<Channels>::AdditiveOscillator(int sampleRate)
+    : sampleRate_(static_cast<float>(sampleRate)) {
+    reset();
+}
+
+template <int Channels>
+void AdditiveOscillator<Channels>::attachBuffers(float* buffers) {
+    buffers_ = buffers;
+    if (buffers_) std::fill(buffers_, buffers_ + BUFFER_FLOATS, 0.0f);
+    pos_ = HOP;
+}
+
+template <int Channels>
+void AdditiveOscillator<Channels>::reset() {
+    pos_ = HOP;
+    sync();
+    if (buffers_) std::fill(buffers_, buffers_ + BUFFER_FLOATS, 0.0f);
+}
+
+template <int Channels>
+void AdditiveOscillator<Channels>::sync() {
+    std::fill(std::begin(phases_), std::end(phases_), 0u);
+}
+
+template <int Channels>
+void AdditiveOscillator<Channels>::synthesizeFrame(int members, float freqHz, const float* detuneRatios,
+                                                   const float* gainL, const float* gainR,
+                                                   const float* amplitudes) {
+    // Scratch is per thread rather than per oscillator; only the OLA tail is
+    // real per-voice state.
+    thread_local std::complex<float> halfSpectrum[Channels][N / 2 + 1];
+    thread_local std::complex<float> frame[N];
+
+    for (auto& spectrum : halfSpectrum) {
+        std::fill(std::begin(spectrum), std::end(spectrum), std::complex<float>());
+    }
+
+    const float binsPerHz = static_cast<float>(N) / sampleRate_;
+    const float maxBin = static_cast<float>(N / 2 - KERNEL_HALF_WIDTH - 1);
+
+    for (int i = 0; i < members; ++i) {
+        const float freq = freqHz * detuneRatios[i];
+        const uint32_t increment = PhaseAccumulator::incrementFor(static_cast<double>(freq),
+                                                                  static_cast<double>(sampleRate_));
+        // Partials are written with their phase at the frame centre, one hop ahead.
+        const uint32_t centrePhase = phases_[i] + increment * static_cast<uint32_t>(H);
+        phases_[i] += increment * static_cast<uint32_t>(H);
+        if (freq <= 0.0f) continue;
+
+        const float fundamentalBin = freq * binsPerHz;
+        const int limit = std::clamp(partialLimit_, 0, NUM_OSC_HARMONICS);
+        const int partials = static_cast<int>(std::min(static_cast<float>(limit), maxBin / fundamentalBin));
+        for (int k = 1; k <= partials; ++k) {
+            const float a = amplitudes[k - 1];
+            if (a == 0.0f) continue;
+            // a * sin(theta) as a positive-frequency phasor: (a/2)(sin theta - i cos theta).
+            const uint32_t theta = centrePhase * static_cast<uint32_t>(k);
+            const float re = 0.5f * a * SINE_TABLE.lookup(theta);
+            const float im = -0.5f * a * SINE_TABLE.lookup(theta + 0x40000000u);
+            const float bin = fundamentalBin * static_cast<float>(k);
+            addPartial(halfSpectrum[0], bin, re * gainL[i], im * gainL[i]);
+            if constexpr (Channels == 2) {
+                addPartial(halfSpectrum[1], bin, re * gainR[i], im * gainR[i]);
+            }
+        }
+    }
+
+    // Both channels are real signals: pack them as L + iR into one IFFT.
+    for (int m = 0; m <= N / 2; ++m) {
+        std::complex<float> l = halfSpectrum[0][m];
+        std::complex<float> r = (Channels == 2) ? halfSpectrum[Channels - 1][m] : std::complex<float>();
+        frame[m] = std::complex<float>(l.real() - r.imag(), l.imag() + r.real());
+        if (m > 0 && m < N / 2) {
+            frame[N - m] = std::complex<float>(l.real() + r.imag(), r.real() - l.imag());
+        }
+    }
+    TABLES.fft.inverse(frame);
+
+    for (int c = 0; c < Channels; ++c) {
+        float* buffer = buffers_ + c * 2 * HOP;
+        std::copy(buffer + HOP, buffer + 2 * HOP, buffer);
+        std::fill(buffer + HOP, buffer + 2 * HOP, 0.0f);
+        for (int j = 0; j < 2 * HOP; ++j) {
+            const std::complex<float>& s = frame[N / 4 + j];
+            buffer[j] += (c == 0 ? s.real() : s.imag()) * TABLES.synthesisWeight[j];
+        }
+    }
+    pos_ = 0;
+}
+
+// Member by member: processMono/processStereo are channel specific.
+template AdditiveOscillator<1>::AdditiveOscillator(int);
+template void AdditiveOscillator<1>::attachBuffers(float*);
+template void AdditiveOscillator<1>::reset();
+template void AdditiveOscillator<1>::sync();
+template void AdditiveOscillator<1>::synthesizeFrame(int, float, const float*, const float*, const float*,
+                                                     const float*);
+template AdditiveOscillator<2>::AdditiveOscillator(int);
+template void AdditiveOscillator<2>::attachBuffers(float*);
+template void AdditiveOscillator<2>::reset();
+template void AdditiveOscillator<2>::sync();
+template void AdditiveOscillator<2>::synthesizeFrame(int, float, const float*, const float*, const float*,
+                                                     const float*);
@@ -0,0 +1,76 @@
+// synth/additive_osc.h
+#pragma once
+#include "waveform.h"
+#include <cstdint>
+
+// Harmonic additive oscillator rendered by inverse-FFT overlap-add (FFT^-1
+// synthesis). Once per hop every partial is written into a spectrum as a
+// Blackman-Harris main lobe, one IFFT turns that into a frame, and
+// triangle-weighted frames overlap-add into the output. Per-sample cost is
+// dominated by the IFFT, so it barely depends on the partial count, and
+// partials that would land above Nyquist are simply not written.
+//
+// Frequency and amplitudes are sampled once per hop (HOP samples), so
+// audio-rate FM and sync only take effect at frame boundaries.
+//
+// With Channels == 2 several detuned, panned copies of the partial set (a
+// unison stack) share one IFFT: left and right are packed into the real
+// and imaginary parts of the same transform.
+template <int Channels>
+class AdditiveOscillator {
+    static_assert(Channels == 1 || Channels == 2, "mono or stereo only");
+
+public:
+    static constexpr int FFT_SIZE = 512;
+    static constexpr int HOP = FFT_SIZE / 4;
+    static constexpr int MAX_MEMBERS = 8;
+    static constexpr int BUFFER_FLOATS = Channels * 2 * HOP;
+
+    explicit AdditiveOscillator(int sampleRate);
+
+    // The overlap-add buffers (BUFFER_FLOATS) live outside the oscillator,
+    // so voices that never render additively do not carry them. They must be
+    // attached before rendering; nullptr detaches. Attaching clears them.
+    void attachBuffers(float* buffers);
+    // Silence and zero phase; the next sample starts a fresh frame.
+    void reset();
+    // Zero the partial phases from the next frame on.
+    void sync();
+    // At most this many partials are written per frame (quality scaling).
+    void setPartialLimit(int partials) { partialLimit_ = partials; }
+
+    float processMono(float freqHz, const float* amplitudes) {
+        static_assert(Channels == 1, "processMono needs a mono oscillator");
+        if (pos_ == HOP) {
+            const float unity = 1.0f;
+            synthesizeFrame(1, freqHz, &unity, &unity, nullptr, amplitudes);
+        }
+        return buffers_[pos_++];
+    }
+
+    void processStereo(int members, float freqHz, const float* detuneRatios,
+                       const float* gainL, const float* gainR, const float* amplitudes,
+                       float& left, float& right) {
+        static_assert(Channels == 2, "processStereo needs a stereo oscillator");
+        if (pos_ == HOP) {
+            synthesizeFrame(members, freqHz, detuneRatios, gainL, gainR, amplitudes);
+        }
+        left = buffers_[pos_];
+        right = buffers_[(Channels - 1) * 2 * HOP + pos_];
+        ++pos_;
+    }
+
+private:
+    void synthesizeFrame(int members, float freqHz, const float* detuneRatios,
+                         const float* gainL, const float* gainR, const float* amplitudes);
+
+    float sampleRate_;
+    int pos_;
+    int partialLimit_ = NUM_OSC_HARMONICS;
+    uint32_t phases_[MAX_MEMBERS]; // fundamental phase of each member at the hop start
+    // [channel][2 * HOP]: [0, HOP) is being played, [HOP, 2*HOP) is the next tail.
+    float* buffers_ = nullptr;
+};
+
+using MonoAdditiveOscillator = AdditiveOscillator<1>;
+using StereoAdditiveOscillator = AdditiveOscillator<2>;
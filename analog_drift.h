@@ -1,18 +1,19 @@
 #pragma once
 
+#include "random_seed.h"
+#include <algorithm>
 #include <random>
-#include <vector>
-#include <numeric> 
 #include <cmath>   
 
 class AnalogDrift {
 public:
+    static constexpr int MAX_OCTAVES = 8;
+
     AnalogDrift(int numOctaves = 5) 
-        : numOctaves_(numOctaves), totalValue_(0.0f) {
-        rng_.seed(std::random_device{}()); 
-        dist_ = std::uniform_real_distribution<float>(-1.0f, 1.0f);
-        values_.resize(numOctaves_, 0.0f);
-        counters_.resize(numOctaves_, 0);
+        : numOctaves_(std::clamp(numOctaves, 1, MAX_OCTAVES)), totalValue_(0.0f),
+          rng_(nextRandomSeed()), dist_(-1.0f, 1.0f) {
+        std::fill(std::begin(values_), std::end(values_), 0.0f);
+        std::fill(std::begin(counters_), std::end(counters_), 0u);
     }
 
     float process() {
@@ -30,9 +31,9 @@ public:
 
 private:
     int numOctaves_;
-    std::vector<float> values_;
-    std::vector<unsigned int> counters_;
+    float totalValue_; 
     std::default_random_engine rng_; 
     std::uniform_real_distribution<float> dist_;
-    float totalValue_; 
-};
\ No newline at end of file
+    float values_[MAX_OCTAVES];
+    unsigned int counters_[MAX_OCTAVES];
+};
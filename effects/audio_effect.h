@@ -8,6 +8,10 @@ public:
   
   virtual void processStereoSample(float inL, float inR, float& outL, float& outR) = 0;
 
+  // Called on the audio thread when the synth's quality tier changes
+  // (0 = full quality); effects may trade density for CPU.
+  virtual void setQualityTier(int /*tier*/) {}
+
   void setEnabled(bool enabledStatus) { this->enabled = enabledStatus; }
   bool isEnabled() const { return enabled; }
 
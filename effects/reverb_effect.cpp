@@ -8,20 +8,79 @@
 #define M_PI (3.14159265358979323846)
 #endif
 
+namespace {
+
+// Per-sample one-pole coefficient for a glide with the given time constant.
+float glideCoefficient(int sr, float seconds) {
+  return 1.0f - std::exp(-1.0f / (seconds * static_cast<float>(sr)));
+}
+
+// Delay times settle on whole samples, so a line at rest reads exactly one
+// stored sample per tap.
+float delaySamplesFor(float delayMs, int sr, int maxDelaySamples) {
+  const int samples = static_cast<int>(delayMs * 0.001f * static_cast<float>(sr));
+  return static_cast<float>(std::clamp(samples, 1, maxDelaySamples));
+}
+
+int maxDelaySamplesFor(float maxDelayMs, int sr) {
+  return std::max(1, static_cast<int>(std::ceil(maxDelayMs * 0.001f * static_cast<float>(sr))));
+}
+
+} // namespace
+
+// --- DelayLine Implementation ---
+// Two spare slots keep the oldest interpolated read clear of the write.
+ReverbEffect::DelayLine::DelayLine(int maxDelaySamples)
+    : buffer_(static_cast<size_t>(maxDelaySamples) + 2, 0.0f) {}
+
+float ReverbEffect::DelayLine::read(int delaySamples) const {
+  int index = writePos_ - delaySamples;
+  if (index < 0) index += static_cast<int>(buffer_.size());
+  return buffer_[index];
+}
+
+float ReverbEffect::DelayLine::readInterpolated(float delaySamples) const {
+  const int size = static_cast<int>(buffer_.size());
+  float pos = static_cast<float>(writePos_) - delaySamples;
+  if (pos < 0.0f) pos += static_cast<float>(size);
+  int i0 = static_cast<int>(pos);
+  const float frac = pos - static_cast<float>(i0);
+  if (i0 >= size) i0 -= size;
+  const int i1 = (i0 + 1 == size) ? 0 : i0 + 1;
+  return buffer_[i0] + frac * (buffer_[i1] - buffer_[i0]);
+}
+
+void ReverbEffect::DelayLine::write(float value) {
+  buffer_[writePos_] = value;
+  if (++writePos_ == static_cast<int>(buffer_.size())) writePos_ = 0;
+}
+
+void ReverbEffect::DelayLine::clear() {
+  std::fill(buffer_.begin(), buffer_.end(), 0.0f);
+}
+
 // --- CombFilter Implementation ---
-ReverbEffect::CombFilter::CombFilter(int sr, float delayMs, float /*initialFeedback*/,
+ReverbEffect::CombFilter::CombFilter(int sr, float maxDelayMs, float delayMs,
                                      float dampingCutoffHz) 
-    : sampleRate_(sr), writePos_(0), currentFeedback_(0.7f), // Initial feedback set by updateParameters
-      filterStore_(0.0f), delayMs_(delayMs), dampingAlpha_(0.5f) { // dampingAlpha_ init
+    : sampleRate_(sr), line_(maxDelaySamplesFor(maxDelayMs, sr)),
+      glideCoeff_(glideCoefficient(sr, DELAY_GLIDE_SECONDS)),
+      currentFeedback_(0.7f), targetFeedback_(0.7f), // set by updateParameters
+      dampingAlpha_(0.5f), filterStore_(0.0f), delayMs_(delayMs) {
   setDelay(delayMs); 
+  delaySamples_ = targetDelaySamples_;
   setDampingCutoff(dampingCutoffHz); 
 }
 
 float ReverbEffect::CombFilter::process(float input) {
-    if (buffer_.empty()) {
-        return input; 
+    float readVal;
+    if (delaySamples_ == targetDelaySamples_) {
+        readVal = line_.read(static_cast<int>(delaySamples_));
+    } else {
+        readVal = line_.readInterpolated(delaySamples_);
+        delaySamples_ += (targetDelaySamples_ - delaySamples_) * glideCoeff_;
+        if (std::abs(targetDelaySamples_ - delaySamples_) < 1e-3f) delaySamples_ = targetDelaySamples_;
     }
-    float readVal = buffer_[writePos_];
+    currentFeedback_ += (targetFeedback_ - currentFeedback_) * glideCoeff_;
     
     // Apply LPF to the signal from the delay line (feedback damping)
     // y[n] = (1-alpha) * x[n] + alpha * y[n-1]
@@ -30,25 +89,22 @@ float ReverbEffect::CombFilter::process(float input) {
 
     float outputToBuffer = input + filterStore_ * currentFeedback_; 
     
-    buffer_[writePos_] = std::clamp(outputToBuffer, -2.0f, 2.0f); 
-    
-    writePos_ = (writePos_ + 1) % buffer_.size(); 
+    line_.write(std::clamp(outputToBuffer, -2.0f, 2.0f)); 
     return filterStore_; 
 }
 
+// Never reallocates; the tap glides to the new delay.
 void ReverbEffect::CombFilter::setDelay(float delayMs) {
   delayMs_ = delayMs; 
-  bufferSize_ = static_cast<int>(delayMs_ * 0.001f * static_cast<float>(sampleRate_));
-  if (bufferSize_ < 1) {
-    bufferSize_ = 1;
-  }
-  if (static_cast<int>(buffer_.size()) != bufferSize_) { 
-    buffer_.assign(bufferSize_, 0.0f); 
-    // writePos_ = 0; // Resetting writePos on delay change can be problematic.
-                   // If buffer resizes, it's implicitly handled by assign or new allocation.
-                   // If only delayMs changes but not bufferSize due to rounding, fine.
-  }
-  // filterStore_ = 0.0f; // Resetting filter state on delay change is often good.
+  targetDelaySamples_ = delaySamplesFor(delayMs, sampleRate_, line_.getMaxDelay());
+}
+
+// Also settles any glide, as for a freshly built filter.
+void ReverbEffect::CombFilter::clear() {
+  line_.clear();
+  filterStore_ = 0.0f;
+  delaySamples_ = targetDelaySamples_;
+  currentFeedback_ = targetFeedback_;
 }
 
 float ReverbEffect::CombFilter::getDelayMs() const {
@@ -56,7 +112,7 @@ float ReverbEffect::CombFilter::getDelayMs() const {
 }
 
 void ReverbEffect::CombFilter::setFeedback(float fb) {
-  currentFeedback_ = std::clamp(fb, 0.0f, 0.999f); 
+  targetFeedback_ = std::clamp(fb, 0.0f, 0.999f); 
 }
 
 void ReverbEffect::CombFilter::setDampingCutoff(float cutoffHz) {
@@ -74,17 +130,23 @@ void ReverbEffect::CombFilter::setDampingCutoff(float cutoffHz) {
 
 
 // --- AllPassFilter Implementation ---
-ReverbEffect::AllPassFilter::AllPassFilter(int sr, float delayMs,
+ReverbEffect::AllPassFilter::AllPassFilter(int sr, float maxDelayMs, float delayMs,
                                            float feedback)
-    : sampleRate_(sr), writePos_(0), currentFeedback_(feedback), bufferSize_(0) { // bufferSize_ init
+    : sampleRate_(sr), line_(maxDelaySamplesFor(maxDelayMs, sr)),
+      glideCoeff_(glideCoefficient(sr, DELAY_GLIDE_SECONDS)), currentFeedback_(feedback) {
   setDelay(delayMs);
+  delaySamples_ = targetDelaySamples_;
 }
 
 float ReverbEffect::AllPassFilter::process(float input) {
-  if (buffer_.empty()) {
-    return input; 
+  float buf_out;
+  if (delaySamples_ == targetDelaySamples_) {
+    buf_out = line_.read(static_cast<int>(delaySamples_));
+  } else {
+    buf_out = line_.readInterpolated(delaySamples_);
+    delaySamples_ += (targetDelaySamples_ - delaySamples_) * glideCoeff_;
+    if (std::abs(targetDelaySamples_ - delaySamples_) < 1e-3f) delaySamples_ = targetDelaySamples_;
   }
-  float buf_out = buffer_[writePos_];
   // Schroeder Allpass: y[n] = -g*x[n] + x[n-M] + g*y[n-M] is complex to implement directly with one buffer.
   // Common variant: y[n] = x[n-M] - g * (x[n] - y[n-M]) (nested structure)
   // Simpler for non-nested:
@@ -92,21 +154,17 @@ float ReverbEffect::AllPassFilter::process(float input) {
   //   output = -feedback * input + delayed_val;
   //   buffer[write_pos] = input + feedback * output;
   float output = -currentFeedback_ * input + buf_out;
-  buffer_[writePos_] = std::clamp(input + currentFeedback_ * output, -2.0f, 2.0f);
-
-  writePos_ = (writePos_ + 1) % buffer_.size();
+  line_.write(std::clamp(input + currentFeedback_ * output, -2.0f, 2.0f));
   return output;
 }
 
 void ReverbEffect::AllPassFilter::setDelay(float delayMs) {
-  bufferSize_ = static_cast<int>(delayMs * 0.001f * static_cast<float>(sampleRate_));
-  if (bufferSize_ < 1) {
-    bufferSize_ = 1;
-  }
-   if (static_cast<int>(buffer_.size()) != bufferSize_) {
-       buffer_.assign(bufferSize_, 0.0f);
-      //  writePos_ = 0; // Reset if buffer reallocated.
-   }
+  targetDelaySamples_ = delaySamplesFor(delayMs, sampleRate_, line_.getMaxDelay());
+}
+
+void ReverbEffect::AllPassFilter::clear() {
+  line_.clear();
+  delaySamples_ = targetDelaySamples_;
 }
 
 void ReverbEffect::AllPassFilter::setFeedback(float fb) {
@@ -120,22 +178,54 @@ ReverbEffect::ReverbEffect(float sr)
   
   combFiltersL.reserve(baseCombDelayTimesL.size());
   for (size_t i = 0; i < baseCombDelayTimesL.size(); ++i) {
-    combFiltersL.emplace_back(static_cast<int>(this->sampleRate), baseCombDelayTimesL[i], 0.7f, 5000.0f); 
+    combFiltersL.emplace_back(static_cast<int>(this->sampleRate), baseCombDelayTimesL[i] * MAX_ROOM_DELAY_SCALE,
+                              baseCombDelayTimesL[i], 5000.0f); 
   }
   combFiltersR.reserve(baseCombDelayTimesR.size());
   for (size_t i = 0; i < baseCombDelayTimesR.size(); ++i) {
-    combFiltersR.emplace_back(static_cast<int>(this->sampleRate), baseCombDelayTimesR[i], 0.7f, 5000.0f);
+    combFiltersR.emplace_back(static_cast<int>(this->sampleRate), baseCombDelayTimesR[i] * MAX_ROOM_DELAY_SCALE,
+                              baseCombDelayTimesR[i], 5000.0f);
   }
   
   allPassFiltersL.reserve(baseAllPassDelayTimesL.size());
   for (size_t i = 0; i < baseAllPassDelayTimesL.size(); ++i) {
-    allPassFiltersL.emplace_back(static_cast<int>(this->sampleRate), baseAllPassDelayTimesL[i], baseAllPassFeedbacks[i % baseAllPassFeedbacks.size()]);
+    allPassFiltersL.emplace_back(static_cast<int>(this->sampleRate), baseAllPassDelayTimesL[i] * MAX_ROOM_DELAY_SCALE,
+                                 baseAllPassDelayTimesL[i], baseAllPassFeedbacks[i % baseAllPassFeedbacks.size()]);
   }
   allPassFiltersR.reserve(baseAllPassDelayTimesR.size());
    for (size_t i = 0; i < baseAllPassDelayTimesR.size(); ++i) {
-    allPassFiltersR.emplace_back(static_cast<int>(this->sampleRate), baseAllPassDelayTimesR[i], baseAllPassFeedbacks[i % baseAllPassFeedbacks.size()]);
+    allPassFiltersR.emplace_back(static_cast<int>(this->sampleRate), baseAllPassDelayTimesR[i] * MAX_ROOM_DELAY_SCALE,
+                                 baseAllPassDelayTimesR[i], baseAllPassFeedbacks[i % baseAllPassFeedbacks.size()]);
   }
+  activeCombs_ = combFiltersL.size();
+  activeAllPasses_ = allPassFiltersL.size();
   updateParameters(); 
+  // Start settled on the initial parameters rather than gliding to them.
+  for (auto &comb : combFiltersL) comb.clear();
+  for (auto &comb : combFiltersR) comb.clear();
+}
+
+void ReverbEffect::setQualityTier(int tier) {
+  static constexpr size_t COMBS[] = {8, 6, 4, 4};
+  static constexpr size_t ALLPASSES[] = {4, 4, 4, 2};
+  const size_t t = static_cast<size_t>(std::clamp(tier, 0, 3));
+  const size_t combs = std::min(COMBS[t], combFiltersL.size());
+  const size_t allPasses = std::min(ALLPASSES[t], allPassFiltersL.size());
+
+  // Filters coming back into use still hold the tail from when they stopped.
+  for (size_t i = activeCombs_; i < combs; ++i) {
+    combFiltersL[i].clear();
+    combFiltersR[i].clear();
+  }
+  for (size_t i = activeAllPasses_; i < allPasses; ++i) {
+    allPassFiltersL[i].clear();
+    allPassFiltersR[i].clear();
+  }
+  activeCombs_ = combs;
+  activeAllPasses_ = allPasses;
+  // Comb outputs are largely uncorrelated, so the sum's power scales with
+  // their number.
+  combGain_ = std::sqrt(static_cast<float>(combFiltersL.size()) / static_cast<float>(std::max<size_t>(combs, 1)));
 }
 
 
@@ -149,12 +239,14 @@ void ReverbEffect::processStereoSample(float inL, float inR, float &outL, float
   float wetSignalAccumulatorL = 0.0f;
   float wetSignalAccumulatorR = 0.0f;
 
-  for (auto &comb : combFiltersL) {
-    wetSignalAccumulatorL += comb.process(inL);
+  for (size_t i = 0; i < activeCombs_; ++i) {
+    wetSignalAccumulatorL += combFiltersL[i].process(inL);
   }
-  for (auto &comb : combFiltersR) {
-    wetSignalAccumulatorR += comb.process(inR);
+  for (size_t i = 0; i < activeCombs_; ++i) {
+    wetSignalAccumulatorR += combFiltersR[i].process(inR);
   }
+  wetSignalAccumulatorL *= combGain_;
+  wetSignalAccumulatorR *= combGain_;
 
   // Normalization factor (empirical, often 1/sqrt(numCombs) or tuned by ear)
   // Can be absorbed into wetGain_ or individual comb gains.
@@ -167,15 +259,15 @@ void ReverbEffect::processStereoSample(float inL, float inR, float &outL, float
 
   float diffusedL = wetSignalAccumulatorL;
   float diffusedR = wetSignalAccumulatorR;
-  for (auto &apf : allPassFiltersL) {
-    diffusedL = apf.process(diffusedL);
+  for (size_t i = 0; i < activeAllPasses_; ++i) {
+    diffusedL = allPassFiltersL[i].process(diffusedL);
   }
-  for (auto &apf : allPassFiltersR) {
-    diffusedR = apf.process(diffusedR);
+  for (size_t i = 0; i < activeAllPasses_; ++i) {
+    diffusedR = allPassFiltersR[i].process(diffusedR);
   }
   
-  float finalWetL = std::tanh(diffusedL * wetGain_); 
-  float finalWetR = std::tanh(diffusedR * wetGain_);
+  float finalWetL = wetShaperL_.process(diffusedL * wetGain_); 
+  float finalWetR = wetShaperR_.process(diffusedR * wetGain_);
 
   outL = inL * (1.0f - dryWetMix_) + finalWetL * dryWetMix_;
   outR = inR * (1.0f - dryWetMix_) + finalWetR * dryWetMix_;
@@ -224,7 +316,7 @@ void ReverbEffect::setRT60(float seconds) {
 
 
 void ReverbEffect::updateParameters() {
-  float roomDelayScale = 0.5f + roomSize_ * 1.0f; 
+  float roomDelayScale = MIN_ROOM_DELAY_SCALE + roomSize_ * (MAX_ROOM_DELAY_SCALE - MIN_ROOM_DELAY_SCALE); 
   float calculatedDampingCutoff = calculateDampingCutoffHz(dampingParam_);
 
   for (size_t i = 0; i < combFiltersL.size(); ++i) {
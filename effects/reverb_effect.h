@@ -1,27 +1,49 @@
 // synth/effects/reverb_effect.h
 #pragma once
 #include "audio_effect.h"
+#include "../waveshaper.h"
 #include <algorithm> 
 #include <cmath>
 #include <vector>
 
 class ReverbEffect : public AudioEffect {
 private:
+  // Circular buffer allocated once for the longest delay it will be asked
+  // for. Reading at a fractional delay interpolates linearly.
+  class DelayLine {
+  public:
+    explicit DelayLine(int maxDelaySamples);
+    float read(int delaySamples) const;
+    float readInterpolated(float delaySamples) const;
+    void write(float value);
+    void clear();
+    int getMaxDelay() const { return static_cast<int>(buffer_.size()) - 2; }
+
+  private:
+    std::vector<float> buffer_;
+    int writePos_ = 0;
+  };
+
+  // Delay and feedback changes glide over DELAY_GLIDE_SECONDS instead of
+  // jumping; once settled the tap sits on a whole sample again.
   class CombFilter {
   public:
-    CombFilter(int sr, float delayMs, float initialFeedback, float dampingCutoffHz);
+    CombFilter(int sr, float maxDelayMs, float delayMs, float dampingCutoffHz);
     float process(float input);
     void setDelay(float delayMs);
     float getDelayMs() const; 
     void setFeedback(float fb);
     void setDampingCutoff(float cutoffHz); 
+    void clear();
 
   private:
     int sampleRate_;
-    std::vector<float> buffer_;
-    int bufferSize_;
-    int writePos_;
+    DelayLine line_;
+    float delaySamples_;
+    float targetDelaySamples_;
+    float glideCoeff_;
     float currentFeedback_;
+    float targetFeedback_;
     float dampingAlpha_; 
     float filterStore_;    
     float delayMs_; 
@@ -29,19 +51,26 @@ private:
 
   class AllPassFilter {
   public:
-    AllPassFilter(int sr, float delayMs, float feedback);
+    AllPassFilter(int sr, float maxDelayMs, float delayMs, float feedback);
     float process(float input);
     void setDelay(float delayMs);
     void setFeedback(float fb);
+    void clear();
 
   private:
     int sampleRate_;
-    std::vector<float> buffer_;
-    int bufferSize_;
-    int writePos_;
+    DelayLine line_;
+    float delaySamples_;
+    float targetDelaySamples_;
+    float glideCoeff_;
     float currentFeedback_;
   };
 
+  static constexpr float DELAY_GLIDE_SECONDS = 0.1f;
+  // Room size 0..1 scales the base delay times by 0.5..1.5.
+  static constexpr float MIN_ROOM_DELAY_SCALE = 0.5f;
+  static constexpr float MAX_ROOM_DELAY_SCALE = 1.5f;
+
   const std::vector<float> baseCombDelayTimesL = {
       29.7f, 37.1f, 41.1f, 43.7f, 53.3f, 61.3f, 67.7f, 73.3f 
   }; 
@@ -65,11 +94,20 @@ private:
   float rt60_;          
   float wetGain_;       
 
+  AdaaTanh wetShaperL_;
+  AdaaTanh wetShaperR_;
+
+  // Filters in use per channel; lower quality tiers run fewer of them.
+  size_t activeCombs_;
+  size_t activeAllPasses_;
+  float combGain_ = 1.0f; // keeps the wet level when combs are dropped
+
 public:
   ReverbEffect(float sr);
   ~ReverbEffect() override = default;
 
   void processStereoSample(float inL, float inR, float &outL, float &outR) override;
+  void setQualityTier(int tier) override;
 
   void setDryWetMix(float mix); 
   float getDryWetMix() const { return dryWetMix_; }
@@ -0,0 +1,92 @@
+// synth/effects_pipeline.cpp
+#include "effects_pipeline.h"
+#include "rt_check.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+constexpr int SPINS_BEFORE_YIELD = 2000;
+
+} // namespace
+
+EffectsPipeline::EffectsPipeline(Stage stage, int maxBlockFrames, const RealtimeConfig& workerConfig)
+    : stage_(std::move(stage)),
+      maxBlockFrames_(std::max(1, maxBlockFrames)),
+      workerConfig_(workerConfig) {
+    for (auto& buffer : buffers_) {
+        buffer.assign(2 * static_cast<size_t>(maxBlockFrames_), 0.0f);
+    }
+}
+
+EffectsPipeline::~EffectsPipeline() {
+    stop();
+}
+
+bool EffectsPipeline::start() {
+    if (running_.load()) return workerConfigOk_;
+    workerConfigured_.store(false);
+    running_.store(true);
+    worker_ = std::thread(&EffectsPipeline::workerLoop, this);
+    while (!workerConfigured_.load()) {
+        std::this_thread::yield();
+    }
+    return workerConfigOk_;
+}
+
+void EffectsPipeline::stop() {
+    running_.store(false);
+    jobSignal_.notify();
+    if (worker_.joinable()) worker_.join();
+}
+
+float* EffectsPipeline::beginBlock(int /*numFrames*/) {
+    if (pendingFrames_ > 0) {
+        job_ = buffers_[1 - filling_].data();
+        jobFrames_ = pendingFrames_;
+        posted_.fetch_add(1, std::memory_order_release);
+        jobSignal_.notify();
+    }
+    return buffers_[filling_].data();
+}
+
+void EffectsPipeline::endBlock(float* left, float* right, int stride, int numFrames) {
+    int copied = 0;
+    if (pendingFrames_ > 0) {
+        const unsigned posted = posted_.load(std::memory_order_relaxed);
+        for (int spins = 0; completed_.load(std::memory_order_acquire) != posted; ++spins) {
+            if (spins >= SPINS_BEFORE_YIELD) std::this_thread::yield();
+        }
+        copied = std::min(numFrames, pendingFrames_);
+        const float* processed = buffers_[1 - filling_].data();
+        for (int i = 0; i < copied; ++i) {
+            left[i * stride] = processed[2 * i];
+            right[i * stride] = processed[2 * i + 1];
+        }
+    }
+    for (int i = copied; i < numFrames; ++i) {
+        left[i * stride] = 0.0f;
+        right[i * stride] = 0.0f;
+    }
+    pendingFrames_ = numFrames;
+    filling_ = 1 - filling_;
+}
+
+void EffectsPipeline::workerLoop() {
+    workerConfigError_.clear();
+    workerConfigOk_ = Realtime::configureCurrentThread(workerConfig_, workerConfigError_);
+    workerConfigured_.store(true);
+
+    unsigned completed = completed_.load(std::memory_order_relaxed);
+    for (;;) {
+        jobSignal_.wait([this, completed] {
+            return posted_.load(std::memory_order_acquire) != completed || !running_.load(std::memory_order_relaxed);
+        });
+        if (posted_.load(std::memory_order_acquire) == completed) return; // stopped
+        {
+            RtCheck::RenderScope rtCheckScope;
+            stage_(job_, jobFrames_);
+        }
+        completed_.store(++completed, std::memory_order_release);
+    }
+}
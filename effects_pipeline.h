@@ -0,0 +1,68 @@
+// synth/effects_pipeline.h
+#pragma once
+#include "realtime.h"
+#include "worker_signal.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs a block-processing stage (the synth's effects chain) on a worker
+// thread one block behind the audio thread: while the audio thread renders
+// the dry signal of block N+1, the worker processes block N. Output is one
+// block late. Blocks are expected to keep the same size; a block of a
+// different size than the one before it is padded or truncated.
+//
+// The two threads hand blocks over through a pair of counters. The audio
+// thread never blocks: it waits for the worker by spinning, then yielding.
+// The worker waits for the next block on a WorkerSignal, so between blocks
+// it sleeps instead of occupying a core.
+class EffectsPipeline {
+public:
+    using Stage = std::function<void(float* interleavedStereo, int numFrames)>;
+
+    EffectsPipeline(Stage stage, int maxBlockFrames, const RealtimeConfig& workerConfig = RealtimeConfig());
+    ~EffectsPipeline();
+
+    EffectsPipeline(const EffectsPipeline&) = delete;
+    EffectsPipeline& operator=(const EffectsPipeline&) = delete;
+
+    // Returns false if the worker could not be given its real-time
+    // configuration (it still runs; see getWorkerConfigError()).
+    bool start();
+    void stop();
+    const std::string& getWorkerConfigError() const { return workerConfigError_; }
+
+    bool accepts(int numFrames) const { return numFrames > 0 && numFrames <= maxBlockFrames_; }
+
+    // Audio thread, once per block: beginBlock() hands the previous block to
+    // the worker and returns the buffer to render this block's dry signal
+    // into; endBlock() waits for the worker and writes the previous block's
+    // processed output (silence for the very first block), frame i going to
+    // left[i * stride] and right[i * stride].
+    float* beginBlock(int numFrames);
+    void endBlock(float* left, float* right, int stride, int numFrames);
+
+private:
+    void workerLoop();
+
+    Stage stage_;
+    int maxBlockFrames_;
+    std::vector<float> buffers_[2];
+    int filling_ = 0;       // buffer the audio thread renders into
+    int pendingFrames_ = 0; // frames waiting in the other buffer
+
+    float* job_ = nullptr;
+    int jobFrames_ = 0;
+    std::atomic<unsigned> posted_{0};
+    std::atomic<unsigned> completed_{0};
+    WorkerSignal jobSignal_;
+
+    RealtimeConfig workerConfig_;
+    std::string workerConfigError_;
+    bool workerConfigOk_ = true;
+    std::atomic<bool> workerConfigured_{false};
+    std::atomic<bool> running_{false};
+    std::thread worker_;
+};
@@ -8,13 +8,12 @@ struct EnvelopeParams {
     float release;
 };
 
+// Timing parameters are supplied on every step() (they live in the shared
+// Patch), so an Envelope only carries its running state.
 class Envelope {
 public:
-    Envelope(float attack = 0.01f, float decay = 0.1f,
-             float sustain = 0.7f, float release = 0.2f,
-             int sampleRate = 44100)
-        : attackTime(attack), decayTime(decay), sustainLevel(sustain),
-          releaseTime(release), sampleRate_(sampleRate), // Renamed for clarity
+    Envelope(int sampleRate = 44100)
+        : sampleRate_(sampleRate), // Renamed for clarity
           state(State::Idle), level(0.0f), counter(0), initialReleaseLevel(0.0f) {}
 
     void noteOn() {
@@ -28,10 +27,11 @@ public:
         initialReleaseLevel = level; 
     }
 
-    float step() {
-        float safeAttackTime = (attackTime <= 0.0f) ? 0.0001f : attackTime; // Avoid 0, use smaller epsilon
-        float safeDecayTime = (decayTime <= 0.0f) ? 0.0001f : decayTime;
-        float safeReleaseTime = (releaseTime <= 0.0f) ? 0.0001f : releaseTime;
+    float step(const EnvelopeParams& p) {
+        float safeAttackTime = (p.attack <= 0.0f) ? 0.0001f : p.attack; // Avoid 0, use smaller epsilon
+        float safeDecayTime = (p.decay <= 0.0f) ? 0.0001f : p.decay;
+        float safeReleaseTime = (p.release <= 0.0f) ? 0.0001f : p.release;
+        float sustainLevel = p.sustain;
 
         float sr_float = static_cast<float>(sampleRate_);
 
@@ -99,7 +99,6 @@ private:
     enum class State { Idle, Attack, Decay, Sustain, Release };
     State state;
 
-    float attackTime, decayTime, sustainLevel, releaseTime;
     int sampleRate_; // Renamed to avoid potential conflict
     float level;
     int counter; 
@@ -0,0 +1,44 @@
+// synth/fft.cpp
+#include "fft.h"
+#include <cmath>
+#include <utility>
+
+FFT::FFT(int size) : size_(size), twiddles_(size / 2), bitReversed_(size) {
+    for (int k = 0; k < size / 2; ++k) {
+        double angle = -2.0 * 3.14159265358979323846 * k / size;
+        twiddles_[k] = std::complex<float>(static_cast<float>(std::cos(angle)),
+                                           static_cast<float>(std::sin(angle)));
+    }
+    int bits = 0;
+    while ((1 << bits) < size) ++bits;
+    for (int i = 0; i < size; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        bitReversed_[i] = r;
+    }
+}
+
+void FFT::transform(std::complex<float>* data, bool inverse) const {
+    for (int i = 0; i < size_; ++i) {
+        int r = bitReversed_[i];
+        if (i < r) std::swap(data[i], data[r]);
+    }
+    for (int len = 2; len <= size_; len <<= 1) {
+        const int half = len >> 1;
+        const int stride = size_ / len;
+        for (int start = 0; start < size_; start += len) {
+            for (int k = 0; k < half; ++k) {
+                std::complex<float> w = twiddles_[k * stride];
+                if (inverse) w = std::conj(w);
+                // Written out to avoid std::complex's NaN-checking multiply.
+                const std::complex<float> b = data[start + k + half];
+                const std::complex<float> t(w.real() * b.real() - w.imag() * b.imag(),
+                                            w.real() * b.imag() + w.imag() * b.real());
+                data[start + k + half] = data[start + k] - t;
+                data[start + k] += t;
+            }
+        }
+    }
+}
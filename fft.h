@@ -0,0 +1,25 @@
+// synth/fft.h
+#pragma once
+#include <complex>
+#include <vector>
+
+// In-place iterative radix-2 complex FFT of a fixed power-of-two size.
+// Twiddles and the bit-reversal permutation are computed once at
+// construction; transforms themselves never allocate.
+class FFT {
+public:
+    explicit FFT(int size);
+
+    int size() const { return size_; }
+
+    // Unscaled: forward(inverse(x)) == size() * x.
+    void forward(std::complex<float>* data) const { transform(data, false); }
+    void inverse(std::complex<float>* data) const { transform(data, true); }
+
+private:
+    void transform(std::complex<float>* data, bool inverse) const;
+
+    int size_;
+    std::vector<std::complex<float>> twiddles_; // e^{-2*pi*i*k/size}, k < size/2
+    std::vector<int> bitReversed_;
+};
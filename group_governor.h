@@ -0,0 +1,64 @@
+// synth/group_governor.h
+#pragma once
+#include "poly_synth.h"
+#include "quality_governor.h"
+#include "voice_budget.h"
+#include <algorithm>
+#include <climits>
+
+// Load adaptation for hosts that render several PolySynths per callback
+// (MultiTimbralSynth, SynthEngine). Each synth's own QualityGovernor and
+// VoiceBudget only see that synth's render time, which on a pool says little
+// about whether the callback as a whole makes its deadline. The host times
+// the whole callback instead and hands it to onBlock(), which moves every
+// synth to one quality tier and splits one voice cap across them: each synth
+// may keep what it has sounding plus an even share of the headroom left.
+// The synths' own adaptation and budgets should stay off (their default).
+// Like theirs, adaptation and the cap here are off until enabled.
+//
+// onBlock() runs on the host's audio thread once the synths have rendered;
+// the setters and getters are safe from any thread.
+class GroupGovernor {
+public:
+    // maxVoices is the voice count of all synths together.
+    explicit GroupGovernor(int maxVoices) : budget_(maxVoices) {}
+    void setMaxVoices(int maxVoices) { budget_.setMaxVoices(maxVoices); }
+
+    void setAdaptiveQuality(bool enabled) { quality_.setAdaptive(enabled); }
+    void setQualityTier(int tier) { quality_.requestTier(tier); }
+    const QualityGovernor& getQualityGovernor() const { return quality_; }
+
+    // Fraction of each callback's duration that all synths together may use;
+    // 0 means no cap (see VoiceBudget).
+    void setVoiceBudget(float loadFraction) { budget_.setBudget(loadFraction); }
+    const VoiceBudget& getVoiceBudget() const { return budget_; }
+
+    // synthAt(i) returns the i-th of `count` synths.
+    template <typename SynthAt>
+    void onBlock(int count, SynthAt synthAt, double renderSeconds, double blockSeconds) {
+        double blockVoices = 0.0;
+        int sounding = 0;
+        for (int i = 0; i < count; ++i) {
+            blockVoices += synthAt(i)->getBlockVoices();
+            sounding += synthAt(i)->getActiveVoices();
+        }
+        budget_.onBlock(renderSeconds, blockSeconds, blockVoices);
+        const bool limited = budget_.isLimited();
+        const int headroom = std::max(0, budget_.getCap() - sounding);
+        const int share = count > 0 ? (headroom + count - 1) / count : 0;
+        for (int i = 0; i < count; ++i) {
+            PolySynth* synth = synthAt(i);
+            synth->setHostVoiceCap(limited ? std::max(1, synth->getActiveVoices() + share) : INT_MAX);
+        }
+        if (quality_.onBlock(renderSeconds, blockSeconds)) {
+            for (int i = 0; i < count; ++i) {
+                synthAt(i)->setQualityTier(quality_.getTier());
+            }
+            budget_.restartEstimate();
+        }
+    }
+
+private:
+    QualityGovernor quality_;
+    VoiceBudget budget_;
+};
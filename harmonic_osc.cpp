@@ -3,49 +3,34 @@
 #include <cmath>
 #include <algorithm> 
 
-HarmonicOscillator::HarmonicOscillator(int sr, int numHarmonics_)
-    : sampleRate(sr), numHarmonics(numHarmonics_), 
-      baseFreq(440.0f), phase(0.0f), gateOpen(false), waveform(Waveform::Sine),
-      // lfos and envelopes vectors are initialized but not directly used for osc modulation in current global design
-      // Consider if these should be per-harmonic modulators or if this was for a different design.
-      // For now, their presence doesn't harm, but they aren't wired into the process() output.
-      lfos(numHarmonics), // Assuming default LFO constructor or provide params
-      envelopes(numHarmonics), // Assuming default Envelope constructor
-      noiseDist(-1.0f, 1.0f), // This is fine if used, otherwise remove
-      rng(std::random_device{}()), // This is fine if used, otherwise remove
-      pulseWidth(0.5f), pwmDepth(0.0f), currentPWMSourceValue(0.0f), 
-      polyModPWValue(0.0f), wheelModPWValue(0.0f), driftPWValue(0.0f)
+HarmonicOscillator::HarmonicOscillator(int sr)
+    : sampleRate(sr), 
+      invSampleRate_(1.0f / static_cast<float>(sr)),
+      baseFreq(440.0f),
+      incrementPerHz_(PhaseAccumulator::incrementPerHz(static_cast<double>(sr) * AdaptiveOversampling::MAX_FACTOR)),
+      maxRateIncrement_(0),
+      additive_(sr),
+      gateOpen(false),
+      polyModPWValue(0.0f), driftPWValue(0.0f)
 {
-    harmonicAmplitudes_.resize(numHarmonics, 0.0f);
-    if (numHarmonics > 0) {
-        harmonicAmplitudes_[0] = 1.0f; 
-    }
 }
 
 void HarmonicOscillator::setFrequency(float freq) {
     baseFreq = std::max(0.0f, freq);
+    maxRateIncrement_ = PhaseAccumulator::incrementFromHz(baseFreq, incrementPerHz_);
 }
 
 float HarmonicOscillator::getBaseFrequency() const { 
     return baseFreq; 
 }
 
-void HarmonicOscillator::setWaveform(Waveform wf) {
-    waveform = wf;
-}
-
-Waveform HarmonicOscillator::getWaveform() const {
-    return waveform;
-}
-
 void HarmonicOscillator::noteOn() {
     gateOpen = true;
-    // If envelopes/lfos per harmonic were intended, they'd be triggered here.
+    oversampling_.snapNextUpdate();
 }
 
 void HarmonicOscillator::noteOff() {
     gateOpen = false;
-    // If envelopes/lfos per harmonic were intended, they'd be released here.
 }
 
 bool HarmonicOscillator::isRunning() const {
@@ -58,97 +43,67 @@ bool HarmonicOscillator::isGateOpen() const {
     return gateOpen;
 }
 
-float HarmonicOscillator::process() {
-    // --- 2x Oversampling ---
-    float outSample = 0.0f;
-    constexpr int oversamplingFactor = 2; // Or make this a member/configurable
-    float subSamples[oversamplingFactor];
-
-    // float originalSampleRate = static_cast<float>(sampleRate); // Not directly needed if sampleRate is member
-    float oversampledRate = static_cast<float>(sampleRate * oversamplingFactor);
-    // float phaseIncrementPerSubSample = baseFreq / oversampledRate; // baseFreq can change due to FM
-
-    for (int i = 0; i < oversamplingFactor; ++i) {
-        // Calculate effective frequency for this sub-sample if FM is sample-by-sample
-        // For now, baseFreq is assumed constant across sub-samples within one main sample period.
-        float currentEffectiveFreq = std::max(0.0f, baseFreq);
-
-
-        float currentPhasePos = std::fmod(phase, 1.0f);
-        if (currentPhasePos < 0.0f) currentPhasePos += 1.0f;
-
-        float sample_component = 0.0f;
-        switch (waveform) {
-            case Waveform::Sine:
-                sample_component = std::sin(2.0f * static_cast<float>(M_PI) * currentPhasePos);
-                break;
-            case Waveform::Saw:
-                sample_component = 2.0f * currentPhasePos - 1.0f;
-                // PolyBLEP for Saw:
-                // float t = currentPhasePos; // Phase [0, 1)
-                // float inc = currentEffectiveFreq / oversampledRate;
-                // sample_component = 2.0f * t - 1.0f;
-                // sample_component -= poly_blep(t, inc); // Subtract BLEP at discontinuity
-                break;
-            case Waveform::Square:
-                sample_component = (currentPhasePos < 0.5f) ? 1.0f : -1.0f;
-                // PolyBLEP for Square:
-                // float t = currentPhasePos;
-                // float inc = currentEffectiveFreq / oversampledRate;
-                // sample_component = (t < 0.5f) ? 1.0f : -1.0f;
-                // sample_component += poly_blep(t, inc);          // Add BLEP at 0
-                // sample_component -= poly_blep(std::fmod(t + 0.5f, 1.0f), inc); // Subtract BLEP at 0.5
-                break;
-            case Waveform::Triangle:
-                 if (currentPhasePos < 0.5f) {
-                    sample_component = -1.0f + 4.0f * currentPhasePos;
-                } else {
-                    sample_component = 1.0f - 4.0f * (currentPhasePos - 0.5f);
-                }
-                break;
-            case Waveform::Pulse: {
-                float lfo_pwm_effect = pwmDepth * currentPWMSourceValue;
-                float total_pwm_offset = lfo_pwm_effect + 
-                                         polyModPWValue + 
-                                         wheelModPWValue + 
-                                         driftPWValue;
-                float effectivePW = pulseWidth + total_pwm_offset;
-                effectivePW = std::clamp(effectivePW, 0.01f, 0.99f);
-                sample_component = (currentPhasePos < effectivePW) ? 1.0f : -1.0f;
-                // PolyBLEP for Pulse (similar to Square but with 'effectivePW')
-                // float t = currentPhasePos;
-                // float inc = currentEffectiveFreq / oversampledRate;
-                // sample_component = (t < effectivePW) ? 1.0f : -1.0f;
-                // sample_component += poly_blep(t, inc); // Add BLEP at 0
-                // sample_component -= poly_blep(std::fmod(t - effectivePW + 1.0f, 1.0f), inc); // Subtract BLEP at effectivePW
-                break;
-            }
-            case Waveform::Additive: {
-                sample_component = 0.0f;
-                for (int h_idx = 0; h_idx < numHarmonics; ++h_idx) {
-                    if (harmonicAmplitudes_[h_idx] != 0.0f) {
-                        sample_component += harmonicAmplitudes_[h_idx] * std::sin(2.0f * static_cast<float>(M_PI) * currentPhasePos * static_cast<float>(h_idx + 1));
-                    }
-                }
-                break;
-            }
-        }
-        subSamples[i] = sample_component;
-
-        phase += currentEffectiveFreq / oversampledRate;
-        // Sync will reset phase externally if needed. If sync happens mid-subsample block, this won't catch it perfectly without more logic.
+HarmonicOscillator::RenderFn HarmonicOscillator::rendererFor(Waveform waveform) {
+    switch (waveform) {
+        case Waveform::Sine:     return &HarmonicOscillator::renderWaveform<Waveform::Sine>;
+        case Waveform::Saw:      return &HarmonicOscillator::renderWaveform<Waveform::Saw>;
+        case Waveform::Square:   return &HarmonicOscillator::renderWaveform<Waveform::Square>;
+        case Waveform::Triangle: return &HarmonicOscillator::renderWaveform<Waveform::Triangle>;
+        case Waveform::Pulse:    return &HarmonicOscillator::renderWaveform<Waveform::Pulse>;
+        case Waveform::Additive: return &HarmonicOscillator::renderWaveform<Waveform::Additive>;
     }
+    return &HarmonicOscillator::renderWaveform<Waveform::Sine>;
+}
 
-    if (phase >= 1.0f) phase -= std::floor(phase); 
-    else if (phase < 0.0f) phase -= std::floor(phase);
+float HarmonicOscillator::process(Waveform waveform, float pulseWidth, const float* harmonicAmplitudes) {
+    return render(rendererFor(waveform), pulseWidth, harmonicAmplitudes);
+}
 
+template <Waveform W>
+float HarmonicOscillator::renderWaveform(float pulseWidth, const float* harmonicAmplitudes) {
+    if constexpr (W == Waveform::Additive) {
+        // The naive phase still runs so sync and getPhase() see the cycle.
+        phase_.setIncrement(maxRateIncrement_ * AdaptiveOversampling::MAX_FACTOR);
+        phase_.advance();
+        return additive_.processMono(baseFreq, harmonicAmplitudes);
+    }
 
-    outSample = 0.0f;
-    for (int i = 0; i < oversamplingFactor; ++i) {
-        outSample += subSamples[i];
+    // The pulse width only depends on modulation inputs that are constant
+    // across the sub-samples of one output sample.
+    float effectivePW = 0.5f;
+    if constexpr (W == Waveform::Pulse) {
+        effectivePW = effectivePulseWidth(pulseWidth);
     }
-    outSample /= static_cast<float>(oversamplingFactor); // Simple averaging for downsampling
 
+    if (oversampling_.isFading()) {
+        float weights[AdaptiveOversampling::MAX_FACTOR];
+        const int subSamples = oversampling_.fadeWeights(weights);
+        return subSamples == 2 ? renderSubSamples<W, 2, true>(effectivePW, harmonicAmplitudes, weights)
+                               : renderSubSamples<W, 4, true>(effectivePW, harmonicAmplitudes, weights);
+    }
+    switch (oversampling_.getFactor()) {
+        case 1:  return renderSubSamples<W, 1, false>(effectivePW, harmonicAmplitudes, nullptr);
+        case 2:  return renderSubSamples<W, 2, false>(effectivePW, harmonicAmplitudes, nullptr);
+        default: return renderSubSamples<W, 4, false>(effectivePW, harmonicAmplitudes, nullptr);
+    }
+}
+
+// Weighted is only needed while crossfading between factors; otherwise the
+// sub-samples are plainly averaged.
+template <Waveform W, int SubSamples, bool Weighted>
+float HarmonicOscillator::renderSubSamples(float effectivePW, const float* harmonicAmplitudes,
+                                           const float* weights) {
+    phase_.setIncrement(maxRateIncrement_ * static_cast<uint32_t>(AdaptiveOversampling::MAX_FACTOR / SubSamples));
+    float outSample = 0.0f;
+    for (int i = 0; i < SubSamples; ++i) {
+        float v = waveformSample<W>(phase_.get(), effectivePW, harmonicAmplitudes);
+        outSample += Weighted ? weights[i] * v : v;
+        phase_.advance();
+        // Sync will reset phase externally if needed. If sync happens mid-subsample block, this won't catch it perfectly without more logic.
+    }
+    if constexpr (!Weighted) {
+        outSample *= 1.0f / static_cast<float>(SubSamples); // Simple averaging for downsampling
+    }
     return outSample;
 }
 
@@ -172,24 +127,14 @@ float HarmonicOscillator::process() {
 
 
 void HarmonicOscillator::resetPhase() {
-    phase = 0.0f;
+    phase_.reset();
+    additive_.reset();
 }
 
 float HarmonicOscillator::getPhase() const {
-    return phase;
-}
-
-void HarmonicOscillator::setPulseWidth(float width) {
-    pulseWidth = std::clamp(width, 0.01f, 0.99f);
-}
-
-void HarmonicOscillator::setPWMDepth(float depth) {
-    pwmDepth = std::clamp(depth, 0.0f, 1.0f);
+    return phase_.normalized();
 }
 
-void HarmonicOscillator::setPWMSource(float value) {
-    currentPWMSourceValue = value;
-}
 void HarmonicOscillator::setPolyModPWValue(float value) {
     polyModPWValue = value;
 }
@@ -200,26 +145,10 @@ void HarmonicOscillator::sync() {
     // the reset will apply from the next block of sub-samples.
     // For perfect sync, the `sync()` might need to be aware of sub-sample timing
     // or `process()` would need to handle sync trigger within its sub-sample loop.
-    phase = 0.0f;
-}
-
-void HarmonicOscillator::setWheelModPWValue(float value) {
-    wheelModPWValue = value;
+    phase_.reset();
+    additive_.sync();
 }
 
 void HarmonicOscillator::setDriftPWValue(float value) {
     driftPWValue = value;
 }
-
-void HarmonicOscillator::setHarmonicAmplitude(int harmonicIndex, float amplitude) {
-    if (harmonicIndex >= 0 && harmonicIndex < numHarmonics) {
-        harmonicAmplitudes_[harmonicIndex] = std::clamp(amplitude, 0.0f, 1.0f);
-    }
-}
-
-float HarmonicOscillator::getHarmonicAmplitude(int harmonicIndex) const {
-    if (harmonicIndex >= 0 && harmonicIndex < numHarmonics) {
-        return harmonicAmplitudes_[harmonicIndex];
-    }
-    return 0.0f;
-}
\ No newline at end of file
@@ -1,10 +1,9 @@
 // synth/harmonic_osc.h
 #pragma once
-#include "envelope.h" 
-#include "lfo.h"      
 #include "waveform.h" 
-#include <vector>
-#include <random>
+#include "phase_accumulator.h"
+#include "additive_osc.h"
+#include "oversampling.h"
 #include <cmath>
 #include <algorithm> 
 
@@ -15,49 +14,86 @@
 
 class HarmonicOscillator { 
 public:
-    HarmonicOscillator(int sampleRate, int numHarmonics); 
+    // Waveform-specialised render function, picked once per patch change with
+    // rendererFor() so the per-sample path carries no waveform switch.
+    using RenderFn = float (HarmonicOscillator::*)(float pulseWidth, const float* harmonicAmplitudes);
+    static RenderFn rendererFor(Waveform waveform);
+
+    HarmonicOscillator(int sampleRate); 
     void setFrequency(float freq);                         
     float getBaseFrequency() const;                        
     void noteOn();                                         
     void noteOff();                                        
-    float process();                                       
+    float process(Waveform waveform, float pulseWidth, const float* harmonicAmplitudes);
+    float render(RenderFn fn, float pulseWidth, const float* harmonicAmplitudes) {
+        return (this->*fn)(pulseWidth, harmonicAmplitudes);
+    }
     bool isRunning() const;                                
+    // Picks the oversampling factor from the spectrum reach in Hz, i.e. the
+    // fundamental scaled by how bright the waveform is (see AdaptiveOversampling).
+    void updateOversampling(float spectrumReachHz) {
+        oversampling_.update(spectrumReachHz * invSampleRate_);
+    }
+    int getOversampling() const { return oversampling_.getFactor(); }
+    void setMaxOversampling(int factor) { oversampling_.setMaxFactor(factor); }
+    void setAdditivePartialLimit(int partials) { additive_.setPartialLimit(partials); }
+    void attachAdditiveBuffers(float* buffers) { additive_.attachBuffers(buffers); }
     bool isGateOpen() const;                               
 
-    void setWaveform(Waveform wf);                         
-    Waveform getWaveform() const;                          
+    // Pulse width after the modulation (LFO, wheel and poly-mod all arrive
+    // through the mod matrix) and drift offsets.
+    float effectivePulseWidth(float pulseWidth) const {
+        return std::clamp(pulseWidth + polyModPWValue + driftPWValue, 0.01f, 0.99f);
+    }
+
+    // One naive sample of waveform W at a fixed-point phase. Shared with the
+    // unison stack so both oscillators stay identical.
+    template <Waveform W>
+    static float waveformSample(uint32_t phase, float effectivePW, const float*) {
+        const float t = PhaseAccumulator::toUnit(phase);
+        if constexpr (W == Waveform::Sine) {
+            return SINE_TABLE.lookup(phase);
+        } else if constexpr (W == Waveform::Saw) {
+            // PolyBLEP for Saw: subtract poly_blep(t, inc) at the discontinuity
+            return 2.0f * t - 1.0f;
+        } else if constexpr (W == Waveform::Square) {
+            // PolyBLEP for Square: add poly_blep(t, inc) at 0, subtract it at 0.5
+            return (t < 0.5f) ? 1.0f : -1.0f;
+        } else if constexpr (W == Waveform::Triangle) {
+            return (t < 0.5f) ? -1.0f + 4.0f * t : 1.0f - 4.0f * (t - 0.5f);
+        } else if constexpr (W == Waveform::Pulse) {
+            // PolyBLEP for Pulse: as Square but with the falling edge at effectivePW
+            return (t < effectivePW) ? 1.0f : -1.0f;
+        } else {
+            // Additive has no per-sample form; AdditiveOscillator renders it
+            // a frame at a time.
+            return 0.0f;
+        }
+    }
+
     void resetPhase();                                     
     float getPhase() const;                                
-    void setPulseWidth(float width);                       
-    void setPWMDepth(float depth);                         
-    void setPWMSource(float value);                        
     void setPolyModPWValue(float value);                   
-    void setWheelModPWValue(float value);                  
-    void setHarmonicAmplitude(int harmonicIndex, float amplitude); 
-    float getHarmonicAmplitude(int harmonicIndex) const;           
     void setDriftPWValue(float value);                     
     void sync();                                           
 
 private:
+    template <Waveform W>
+    float renderWaveform(float pulseWidth, const float* harmonicAmplitudes);
+    template <Waveform W, int SubSamples, bool Weighted>
+    float renderSubSamples(float effectivePW, const float* harmonicAmplitudes, const float* weights);
+
     int sampleRate;
-    int numHarmonics; 
+    float invSampleRate_;
     float baseFreq; 
-    float phase;
+    float incrementPerHz_;      // at MAX_FACTOR times the sample rate
+    uint32_t maxRateIncrement_; // phase step per sub-sample at MAX_FACTOR
+    PhaseAccumulator phase_;
+    AdaptiveOversampling oversampling_;
+    MonoAdditiveOscillator additive_;
     bool gateOpen;
-    Waveform waveform;
-
-    std::vector<LFO> lfos; // These seem unused currently for direct osc modulation
-    std::vector<Envelope> envelopes; // These also seem unused currently for direct osc modulation
-    std::vector<float> harmonicAmplitudes_; 
-
-    std::mt19937 rng; // Unused currently
-    std::uniform_real_distribution<float> noiseDist; // Unused currently
 
-    float pulseWidth;
-    float pwmDepth;
-    float currentPWMSourceValue;
     float polyModPWValue;
-    float wheelModPWValue;
     float driftPWValue;
 
 };
\ No newline at end of file
@@ -0,0 +1,191 @@
+// synth/lfo.cpp
+#include "lfo.h"
+#include "patch.h"
+#include "random_seed.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+constexpr int VECTOR_FLOATS = 8;
+
+// PhaseAccumulator::toUnit() through a signed conversion, which SSE has and
+// the unsigned one does not; the top 24 bits always fit.
+float toUnit(uint32_t phase) {
+    return static_cast<float>(static_cast<int32_t>(phase >> 8)) * (1.0f / 16777216.0f);
+}
+
+float toBipolar(uint32_t bits) {
+    return toUnit(bits) * 2.0f - 1.0f;
+}
+
+uint32_t nextRandom(uint32_t state) {
+    return state * 1664525u + 1013904223u;
+}
+
+// `frames` samples of N instances of one LFO into out[frame * outStride +
+// instance]. The state is worked on in local copies so the fixed-width lane
+// loops vectorize without alias checks. Random steps draw a new value
+// whenever the phase wraps.
+template <LfoWaveform W, int N>
+void renderLanes(uint32_t* phase, uint32_t* random, float* held, uint32_t increment,
+                 int frames, float* out, int outStride) {
+    uint32_t p[N];
+    uint32_t r[N];
+    float h[N];
+    std::copy(phase, phase + N, p);
+    std::copy(random, random + N, r);
+    std::copy(held, held + N, h);
+    for (int f = 0; f < frames; ++f) {
+        float values[N];
+        for (int i = 0; i < N; ++i) {
+            p[i] += increment;
+            const float t = toUnit(p[i]);
+            if constexpr (W == LfoWaveform::Sine) {
+                values[i] = SINE_TABLE.lookup(p[i]);
+            } else if constexpr (W == LfoWaveform::Triangle) {
+                values[i] = 1.0f - 4.0f * std::fabs(t - 0.5f);
+            } else if constexpr (W == LfoWaveform::SawUp) {
+                values[i] = 2.0f * t - 1.0f;
+            } else if constexpr (W == LfoWaveform::Square) {
+                values[i] = 1.0f - 2.0f * static_cast<float>(static_cast<int32_t>(p[i] >> 31));
+            } else {
+                const bool wrapped = p[i] < increment;
+                const uint32_t drawn = nextRandom(r[i]);
+                r[i] = wrapped ? drawn : r[i];
+                h[i] = wrapped ? toBipolar(drawn) : h[i];
+                values[i] = h[i];
+            }
+        }
+        std::copy(values, values + N, out + f * outStride);
+    }
+    std::copy(p, p + N, phase);
+    std::copy(r, r + N, random);
+    std::copy(h, h + N, held);
+}
+
+// `count` is 1 or a multiple of VECTOR_FLOATS.
+template <LfoWaveform W>
+void renderShape(uint32_t* phase, uint32_t* random, float* held, int count, uint32_t increment,
+                 int frames, float* out, int outStride) {
+    if (count == 1) {
+        renderLanes<W, 1>(phase, random, held, increment, frames, out, outStride);
+        return;
+    }
+    for (int i = 0; i < count; i += VECTOR_FLOATS) {
+        renderLanes<W, VECTOR_FLOATS>(phase + i, random + i, held + i, increment, frames, out + i, outStride);
+    }
+}
+
+} // namespace
+
+LfoBank::LfoBank(float sampleRate, int maxVoices)
+    : sampleRate_(sampleRate),
+      maxVoices_(std::max(1, maxVoices)),
+      voiceStride_((maxVoices_ + VECTOR_FLOATS - 1) / VECTOR_FLOATS * VECTOR_FLOATS),
+      voicePhase_(NUM_LFOS * voiceStride_, 0),
+      voiceRandom_(NUM_LFOS * voiceStride_),
+      voiceHeld_(NUM_LFOS * voiceStride_, 0.0f),
+      voiceOut_(NUM_LFOS * LFO_CHUNK * voiceStride_, 0.0f),
+      noteStamps_(maxVoices_, ULLONG_MAX) {
+    for (int l = 0; l < NUM_LFOS; ++l) {
+        random_[l] = nextRandomSeed();
+    }
+    for (auto& state : voiceRandom_) {
+        state = nextRandomSeed();
+    }
+}
+
+void LfoBank::configure(const Patch& patch, unsigned inUse) {
+    const unsigned wasActive = active_;
+    active_ = 0;
+    perVoice_ = 0;
+    for (int l = 0; l < NUM_LFOS; ++l) {
+        LfoSettings s = l == 0 ? LfoSettings{patch.lfoRate, patch.lfoWaveform, false} : patch.extraLfos[l - 1];
+        s.rate = std::max(0.01f, s.rate);
+        const bool restartNeeded =
+            !configured_ || s.waveform != settings_[l].waveform || s.perVoice != settings_[l].perVoice;
+        settings_[l] = s;
+        increment_[l] = PhaseAccumulator::incrementFor(static_cast<double>(s.rate), static_cast<double>(sampleRate_));
+        if (restartNeeded) {
+            restart(l, {&phase_[l], &random_[l], &held_[l]}, 1);
+            restart(l, voiceState(l, 0), voiceStride_);
+        }
+        if ((inUse & (1u << l)) == 0) continue;
+        active_ |= 1u << l;
+        if (s.perVoice) perVoice_ |= 1u << l;
+        // The rest of the chunk holds nothing or the old waveform.
+        if (restartNeeded || (wasActive & (1u << l)) == 0) renderRest(l);
+    }
+    configured_ = true;
+}
+
+void LfoBank::renderRest(int lfo) {
+    const int first = frame_ + 1;
+    if (first >= LFO_CHUNK) return;
+    if (perVoice_ & (1u << lfo)) {
+        render(settings_[lfo].waveform, voiceState(lfo, 0), voiceStride_, increment_[lfo], LFO_CHUNK - first,
+               voiceOut(lfo, first), NUM_LFOS * voiceStride_);
+    } else {
+        render(settings_[lfo].waveform, {&phase_[lfo], &random_[lfo], &held_[lfo]}, 1, increment_[lfo],
+               LFO_CHUNK - first, &globalOut_[lfo][first], 1);
+    }
+}
+
+void LfoBank::restart(int lfo, State state, int count) {
+    const bool random = settings_[lfo].waveform == LfoWaveform::RandomStep;
+    for (int i = 0; i < count; ++i) {
+        state.phase[i] = 0;
+        if (random) {
+            state.random[i] = nextRandom(state.random[i]);
+            state.held[i] = toBipolar(state.random[i]);
+        }
+    }
+}
+
+void LfoBank::render(LfoWaveform waveform, State state, int count, uint32_t increment,
+                     int frames, float* out, int outStride) {
+    switch (waveform) {
+        case LfoWaveform::Triangle:
+            renderShape<LfoWaveform::Triangle>(state.phase, state.random, state.held, count, increment, frames, out, outStride);
+            break;
+        case LfoWaveform::SawUp:
+            renderShape<LfoWaveform::SawUp>(state.phase, state.random, state.held, count, increment, frames, out, outStride);
+            break;
+        case LfoWaveform::Square:
+            renderShape<LfoWaveform::Square>(state.phase, state.random, state.held, count, increment, frames, out, outStride);
+            break;
+        case LfoWaveform::Sine:
+            renderShape<LfoWaveform::Sine>(state.phase, state.random, state.held, count, increment, frames, out, outStride);
+            break;
+        case LfoWaveform::RandomStep:
+            renderShape<LfoWaveform::RandomStep>(state.phase, state.random, state.held, count, increment, frames, out, outStride);
+            break;
+    }
+}
+
+void LfoBank::renderChunk() {
+    frame_ = 0;
+    for (int l = 0; l < NUM_LFOS; ++l) {
+        if ((active_ & (1u << l)) == 0) continue;
+        if (perVoice_ & (1u << l)) {
+            render(settings_[l].waveform, voiceState(l, 0), voiceStride_, increment_[l], LFO_CHUNK, voiceOut(l, 0),
+                   NUM_LFOS * voiceStride_);
+        } else {
+            render(settings_[l].waveform, {&phase_[l], &random_[l], &held_[l]}, 1, increment_[l], LFO_CHUNK,
+                   globalOut_[l], 1);
+        }
+    }
+}
+
+void LfoBank::restartVoice(int voice, unsigned long long noteStamp) {
+    noteStamps_[voice] = noteStamp;
+    for (int l = 0; l < NUM_LFOS; ++l) {
+        if ((perVoice_ & (1u << l)) == 0) continue;
+        // Re-render the rest of the chunk for this voice only.
+        restart(l, voiceState(l, voice), 1);
+        render(settings_[l].waveform, voiceState(l, voice), 1, increment_[l], LFO_CHUNK - frame_,
+               voiceOut(l, frame_) + voice, NUM_LFOS * voiceStride_);
+    }
+}
@@ -1,12 +1,8 @@
 // synth/lfo.h
 #pragma once
-#include <cmath>
-#include <algorithm> 
-#include <random>    
-
-#ifndef M_PI
-#define M_PI (3.14159265358979323846)
-#endif
+#include <cstdint>
+#include <vector>
+#include "phase_accumulator.h"
 
 enum class LfoWaveform {
     Triangle,
@@ -16,101 +12,104 @@ enum class LfoWaveform {
     RandomStep 
 };
 
-class LFO {
-public:
-    LFO(float sampleRate = 44100.0f)
-        : rate(1.0f), depth(1.0f), sampleRate_(sampleRate), phase(0.0f), 
-          waveform(LfoWaveform::Triangle),
-          randomEngine(std::random_device{}()), 
-          randomDistribution(-1.0f, 1.0f),    
-          lastRandomValue(0.0f),
-          samplesUntilNextRandomStep(0) {
-            updateSamplesPerStep(); 
-          }
+// LFO 1 is the patch's main LFO (lfoRate, lfoWaveform), always global; the
+// others are configured by Patch::extraLfos.
+constexpr int NUM_LFOS = 4;
 
-    void setRate(float r) { 
-        rate = std::max(0.01f, r); 
-        updateSamplesPerStep();
-    }
-    void setDepth(float d) { depth = std::clamp(d, 0.0f, 1.0f); } 
-    void setWaveform(LfoWaveform wf) { 
-        waveform = wf; 
-        if (waveform == LfoWaveform::RandomStep) {
-            samplesUntilNextRandomStep = 0; 
-        } else {
-            phase = 0.0f; 
-        }
-    }
-    void resetPhase() { 
-        phase = 0.0f; 
-        if (waveform == LfoWaveform::RandomStep) {
-            samplesUntilNextRandomStep = 0;
-        }
-    }
+struct LfoSettings {
+    float rate = 1.0f;
+    LfoWaveform waveform = LfoWaveform::Sine;
+    bool perVoice = false; // one instance per voice, restarted on every note
+};
+
+struct LfoValues {
+    float lfo[NUM_LFOS] = {};
+};
 
-    float getRate() const { return rate; }
-    float getDepth() const { return depth; }
-    LfoWaveform getWaveform() const { return waveform; }
+struct Patch;
 
+// Every LFO of a synth, rendered LFO_CHUNK samples at a time instead of one
+// value per call: the waveform is chosen once per chunk, so the sample loops
+// are branch-free, and per-voice LFOs keep their state as one array per LFO
+// with the voices innermost, so a chunk step covers all voices in one
+// vectorizable loop. LFOs no route reads are not rendered at all.
+// Audio thread only; allocates in the constructor only.
+class LfoBank {
+public:
+    static constexpr int LFO_CHUNK = 32;
 
-    float step() {
-        float val = 0.0f;
+    LfoBank(float sampleRate, int maxVoices);
 
-        if (waveform == LfoWaveform::RandomStep) {
-            if (samplesUntilNextRandomStep <= 0) {
-                lastRandomValue = randomDistribution(randomEngine);
-                updateSamplesPerStep(); 
-                samplesUntilNextRandomStep = samplesPerStep;
-            }
-            val = lastRandomValue;
-            samplesUntilNextRandomStep--;
-        } else {
-            phase += rate / sampleRate_;
-            if (phase >= 1.0f) phase -= 1.0f;
+    // On patch change. `inUse` has bit n set when LFO n + 1 feeds a route.
+    // A changed waveform restarts that LFO and, like an LFO that was not in
+    // use before, is heard from the next sample; a changed rate carries on
+    // from the current phase and is heard from the next chunk on.
+    void configure(const Patch& patch, unsigned inUse);
 
-            switch (waveform) {
-                case LfoWaveform::Sine:
-                    val = std::sin(2.0f * static_cast<float>(M_PI) * phase);
-                    break;
-                case LfoWaveform::Triangle:
-                    if (phase < 0.5f) {
-                        val = -1.0f + 4.0f * phase; 
-                    } else {
-                        val = 1.0f - 4.0f * (phase - 0.5f); 
-                    }
-                    break;
-                case LfoWaveform::SawUp: 
-                    val = 2.0f * phase - 1.0f;
-                    break;
-                case LfoWaveform::Square:
-                    val = (phase < 0.5f) ? 1.0f : -1.0f;
-                    break;
-                case LfoWaveform::RandomStep: // Should be handled by the block above
-                    break; 
-            }
+    // Once per sample, before any voice: moves to the next frame, rendering a
+    // new chunk when the current one is used up. Returns the global LFOs.
+    const LfoValues& next() {
+        if (++frame_ >= LFO_CHUNK) renderChunk();
+        for (int l = 0; l < NUM_LFOS; ++l) {
+            current_.lfo[l] = globalOut_[l][frame_];
         }
-        return depth * val;
+        return current_;
     }
 
-private:
-    void updateSamplesPerStep() {
-        if (rate > 0.0f) {
-            samplesPerStep = static_cast<int>(sampleRate_ / rate);
-            if (samplesPerStep < 1) samplesPerStep = 1;
-        } else {
-            samplesPerStep = static_cast<int>(sampleRate_); 
+    bool hasPerVoice() const { return perVoice_ != 0; }
+    // The per-voice LFOs of `voice` at the current frame; the other entries
+    // are meaningless. A new noteStamp (the voice's note-on timestamp)
+    // restarts them first.
+    const LfoValues& voiceValues(int voice, unsigned long long noteStamp) {
+        if (noteStamp != noteStamps_[voice]) restartVoice(voice, noteStamp);
+        const float* frame = voiceOut(0, frame_) + voice;
+        for (int l = 0; l < NUM_LFOS; ++l) {
+            voiceCurrent_.lfo[l] = frame[l * voiceStride_];
         }
+        return voiceCurrent_;
     }
 
-    float rate;      
-    float depth;     
-    float sampleRate_; // Renamed to avoid conflict if global `sampleRate` exists
-    float phase;
-    LfoWaveform waveform;
+private:
+    struct State {
+        uint32_t* phase;
+        uint32_t* random;
+        float* held;
+    };
 
-    std::default_random_engine randomEngine;
-    std::uniform_real_distribution<float> randomDistribution;
-    float lastRandomValue;
-    int samplesPerStep; 
-    int samplesUntilNextRandomStep;
-};
\ No newline at end of file
+    void renderChunk();
+    void renderRest(int lfo);
+    void restartVoice(int voice, unsigned long long noteStamp);
+    void restart(int lfo, State state, int count);
+    static void render(LfoWaveform waveform, State state, int count, uint32_t increment,
+                       int frames, float* out, int outStride);
+    State voiceState(int lfo, int voice) {
+        const int i = lfo * voiceStride_ + voice;
+        return {&voicePhase_[i], &voiceRandom_[i], &voiceHeld_[i]};
+    }
+    float* voiceOut(int lfo, int frame) { return &voiceOut_[(frame * NUM_LFOS + lfo) * voiceStride_]; }
+
+    float sampleRate_;
+    int maxVoices_;
+    int voiceStride_; // maxVoices_ rounded up to whole vectors
+    LfoSettings settings_[NUM_LFOS];
+    uint32_t increment_[NUM_LFOS] = {};
+    unsigned active_ = 0;
+    unsigned perVoice_ = 0;
+    bool configured_ = false;
+    int frame_ = LFO_CHUNK - 1;
+
+    // Global LFOs.
+    uint32_t phase_[NUM_LFOS] = {};
+    uint32_t random_[NUM_LFOS] = {};
+    float held_[NUM_LFOS] = {};
+    float globalOut_[NUM_LFOS][LFO_CHUNK] = {};
+    LfoValues current_;
+
+    // Per-voice LFOs, [lfo][voice] and [frame][lfo][voice].
+    std::vector<uint32_t> voicePhase_;
+    std::vector<uint32_t> voiceRandom_;
+    std::vector<float> voiceHeld_;
+    std::vector<float> voiceOut_;
+    std::vector<unsigned long long> noteStamps_;
+    LfoValues voiceCurrent_;
+};
@@ -1,10 +1,19 @@
 // synth/main.cpp
 #include "poly_synth.h"
+#include "multi_timbral_synth.h"
+#include "preset.h"
+#include "preset_bank.h"
+#include "preset_json.h"
+#include "preset_morph.h"
+#include "preset_watcher.h"
+#include "realtime.h"
+#include "render_ahead.h"
+#include "rt_check.h"
 #include "effects/reverb_effect.h"
 #include "waveform.h"
 #include "synth_parameters.h"
-#include "envelope.h" // For EnvelopeParams in JSON loading
-#include "lfo.h"      // For LfoWaveform in JSON loading
+#include "envelope.h"
+#include "lfo.h"
 
 #include <iostream>
 #include <fstream>
@@ -12,32 +21,57 @@
 #include <vector>
 #include <chrono>
 #include <thread>
+#include <atomic>
 #include <algorithm> // For std::min, std::max
 #include <cmath>     // For std::pow, std::log, std::exp
 
 #include <portaudio.h>
 
 // External library headers (ensure these are in your include path)
-#include "nlohmann/json.hpp" // For JSON parsing
 #include "rtmidi/RtMidi.h"          // For MIDI input
 #include "MidiFile.h"        // For MIDI file playback
 
 // Global synth instance
 PolySynth synth(44100, 16); // Default sample rate and max voices
 ReverbEffect* mainReverbPtr = nullptr; // Pointer to the reverb effect
+// Set in multi-timbral mode (--multitimbral), which replaces `synth` with one
+// part per MIDI channel.
+MultiTimbralSynth* multiSynthPtr = nullptr;
+// Set with --morph=preset.
+PresetMorph* morphPtr = nullptr;
+// Whichever of the morph or the --watch reloader drives the synth's patch at
+// block boundaries, if any.
+BlockEventSource* blockEventsPtr = nullptr;
+
+// PortAudio owns the callback thread, so the callback configures itself on its
+// first call and the main loop reports the outcome.
+enum CallbackThreadState { CALLBACK_THREAD_PENDING, CALLBACK_THREAD_CONFIGURED, CALLBACK_THREAD_FAILED };
+RealtimeConfig callbackThreadConfig;
+std::atomic<int> callbackThreadState{CALLBACK_THREAD_PENDING};
+std::string callbackThreadConfigError; // reserved up front; written once by the callback
+PageFaultMonitor callbackPageFaults;
 
 // PortAudio callback function (remains largely the same)
 int audioCallback(const void* /*inputBuffer*/, void* outputBuffer,
                   unsigned long framesPerBuffer,
                   const PaStreamCallbackTimeInfo* /*timeInfo*/,
                   PaStreamCallbackFlags /*statusFlags*/,
-                  void* /*userData*/) {
+                  void* userData) {
+    if (callbackThreadState.load(std::memory_order_relaxed) == CALLBACK_THREAD_PENDING) {
+        const bool ok = Realtime::configureCurrentThread(callbackThreadConfig, callbackThreadConfigError);
+        callbackThreadState.store(ok ? CALLBACK_THREAD_CONFIGURED : CALLBACK_THREAD_FAILED, std::memory_order_release);
+    }
+    RtCheck::RenderScope rtCheckScope;
+    callbackPageFaults.begin();
     float* out = static_cast<float*>(outputBuffer);
-    for (unsigned long i = 0; i < framesPerBuffer; ++i) {
-        StereoSample sample = synth.process();
-        *out++ = sample.L;
-        *out++ = sample.R;
+    if (multiSynthPtr) {
+        multiSynthPtr->processBlock(out, static_cast<int>(framesPerBuffer));
+    } else if (userData) { // render-ahead mode: the synth runs on its own thread
+        static_cast<RenderAhead*>(userData)->read(out, static_cast<int>(framesPerBuffer));
+    } else {
+        synth.processBlock(out, static_cast<int>(framesPerBuffer), blockEventsPtr);
     }
+    callbackPageFaults.end();
     return paContinue;
 }
 
@@ -135,219 +169,76 @@ void loadDefaultStringsSound(PolySynth& s, ReverbEffect* reverb) {
         reverb->setWetGain(1.0f);
     }
     
+    const float fundamentalOnly[] = {1.0f};
     for (int oscNum = 1; oscNum <= 2; ++oscNum) {
-      for (int i = 0; i < 16; ++i) { 
-          s.setOscHarmonicAmplitude(oscNum, i, (i == 0) ? 1.0f : 0.0f);
-      }
+      s.setOscHarmonics(oscNum, fundamentalOnly, 1);
     }
 }
 
-// --- JSON Parameter Loading ---
-namespace { // Anonymous namespace for helpers
+// --- Preset Loading ---
+bool isCompiledPreset(const std::string& path) {
+    return path.size() > 4 && path.compare(path.size() - 4, 4, ".psp") == 0;
+}
 
-// Helper to get value from json or default, with error logging
-template <typename T>
-T get_json_value_safe(const nlohmann::json& j, const std::string& key, T default_val, const std::string& path_prefix = "") {
-    if (j.contains(key)) {
-        try {
-            return j.at(key).get<T>();
-        } catch (const nlohmann::json::exception& e) {
-            std::cerr << "Warning: JSON type mismatch or error for key '" << path_prefix << key << "': " << e.what() << ". Using default." << std::endl;
-            return default_val;
+// Reads a compiled preset (.psp) or compiles a JSON one, reporting whatever
+// validation had to fix. Returns false if the file gave nothing usable.
+bool readPreset(const std::string& path, Preset& preset) {
+    if (isCompiledPreset(path)) {
+        std::string error;
+        if (!PresetFile::load(path, preset, error)) {
+            std::cerr << "Warning: Could not load compiled preset " << path << ": " << error << std::endl;
+            return false;
         }
+        std::cout << "Loaded compiled preset " << path << std::endl;
+        return true;
     }
-    return default_val;
-}
-
-Waveform stringToWaveform(const std::string& s, Waveform default_wf = Waveform::Saw) {
-    if (s == "Sine") return Waveform::Sine;
-    if (s == "Saw") return Waveform::Saw;
-    if (s == "Square") return Waveform::Square;
-    if (s == "Triangle") return Waveform::Triangle;
-    if (s == "Pulse") return Waveform::Pulse;
-    if (s == "Additive") return Waveform::Additive;
-    std::cerr << "Warning: Unknown waveform string '" << s << "'. Using default." << std::endl;
-    return default_wf;
-}
-
-LfoWaveform stringToLfoWaveform(const std::string& s, LfoWaveform default_wf = LfoWaveform::Triangle) {
-    if (s == "Triangle") return LfoWaveform::Triangle;
-    if (s == "SawUp") return LfoWaveform::SawUp;
-    if (s == "Square") return LfoWaveform::Square;
-    if (s == "Sine") return LfoWaveform::Sine;
-    if (s == "RandomStep") return LfoWaveform::RandomStep;
-    std::cerr << "Warning: Unknown LFO waveform string '" << s << "'. Using default." << std::endl;
-    return default_wf;
-}
-
-SynthParams::FilterType stringToFilterType(const std::string& s, SynthParams::FilterType default_ft = SynthParams::FilterType::LPF24) {
-    if (s == "LPF24") return SynthParams::FilterType::LPF24;
-    if (s == "LPF12") return SynthParams::FilterType::LPF12;
-    if (s == "HPF12") return SynthParams::FilterType::HPF12;
-    if (s == "BPF12") return SynthParams::FilterType::BPF12;
-    if (s == "NOTCH") return SynthParams::FilterType::NOTCH;
-    std::cerr << "Warning: Unknown filter type string '" << s << "'. Using default." << std::endl;
-    return default_ft;
-}
-
-WheelModSource stringToWheelModSource(const std::string& s, WheelModSource default_src = WheelModSource::LFO) {
-    if (s == "LFO") return WheelModSource::LFO;
-    if (s == "NOISE") return WheelModSource::NOISE;
-    std::cerr << "Warning: Unknown wheel mod source string '" << s << "'. Using default." << std::endl;
-    return default_src;
+    std::vector<std::string> errors;
+    const bool ok = compilePresetFile(path, preset, errors);
+    for (const auto& error : errors) {
+        std::cerr << "Warning: " << path << ": " << error << std::endl;
+    }
+    if (ok) std::cout << "Loaded parameters from " << path << std::endl;
+    return ok;
 }
 
-} // anonymous namespace
-
-void loadParametersFromJson(PolySynth& s, ReverbEffect* reverb, const std::string& filename) {
-    std::ifstream f(filename);
-    if (!f.is_open()) {
-        std::cerr << "Warning: Could not open JSON parameter file: " << filename << std::endl;
-        loadDefaultStringsSound(s, reverb);
-        return;
-    }
 
-    nlohmann::json j;
-    try {
-        f >> j;
-    } catch (nlohmann::json::parse_error& e) {
-        std::cerr << "Warning: Could not parse JSON file: " << filename << ". Error: " << e.what() << std::endl;
-        loadDefaultStringsSound(s, reverb);
-        return;
-    }
-
-    std::cout << "Loading parameters from " << filename << "..." << std::endl;
-
-    // Synth-wide parameters
-    s.setMasterTuneCents(get_json_value_safe(j, "masterTuneCents", 0.0f));
-    if (j.contains("osc1Waveform")) {
-        s.setOsc1Waveform(stringToWaveform(j.at("osc1Waveform").get<std::string>()));
-    } else if (j.contains("waveform")) { // Fallback for old "waveform" key for OSC1
-        std::cout << "Warning: 'waveform' key is deprecated for osc1, use 'osc1Waveform'. Using 'waveform' for OSC1." << std::endl;
-        s.setOsc1Waveform(stringToWaveform(j.at("waveform").get<std::string>()));
-    }
-    if (j.contains("osc2Waveform")) {
-        s.setOsc2Waveform(stringToWaveform(j.at("osc2Waveform").get<std::string>()));
-    } else if (j.contains("waveform")) { // Fallback for old "waveform" key for OSC2
-         std::cout << "Warning: 'waveform' key is deprecated for osc2, use 'osc2Waveform'. Using 'waveform' for OSC2." << std::endl;
-        s.setOsc2Waveform(stringToWaveform(j.at("waveform").get<std::string>()));
-    }
-    s.setOsc1Level(get_json_value_safe(j, "osc1Level", 1.0f));
-    s.setOsc2Level(get_json_value_safe(j, "osc2Level", 0.0f));
-    s.setNoiseLevel(get_json_value_safe(j, "noiseLevel", 0.0f));
-    s.setRingModLevel(get_json_value_safe(j, "ringModLevel", 0.0f));
-    s.setVCOBDetuneCents(get_json_value_safe(j, "vcoBDetuneCents", 0.0f));
-    s.setSyncEnabled(get_json_value_safe(j, "syncEnabled", false));
-    s.setPulseWidth(get_json_value_safe(j, "pulseWidth", 0.5f));
-    s.setPWMDepth(get_json_value_safe(j, "pwmDepth", 0.0f));
-    s.setVCOBLowFreqEnabled(get_json_value_safe(j, "vcoBLowFreqEnabled", false));
-    s.setVCOBFreqKnob(get_json_value_safe(j, "vcoBFreqKnob", 0.5f));
-    s.setVCOBKeyFollowEnabled(get_json_value_safe(j, "vcoBKeyFollowEnabled", true));
-    s.setFilterEnvVelocitySensitivity(get_json_value_safe(j, "filterEnvVelocitySensitivity", 0.0f));
-    s.setAmpVelocitySensitivity(get_json_value_safe(j, "ampVelocitySensitivity", 0.7f));
-    s.setXModOsc2ToOsc1FMAmount(get_json_value_safe(j, "xmodOsc2ToOsc1FMAmount", 0.0f));
-    s.setXModOsc1ToOsc2FMAmount(get_json_value_safe(j, "xmodOsc1ToOsc2FMAmount", 0.0f));
-    s.setPMFilterEnvToFreqAAmount(get_json_value_safe(j, "pmFilterEnvToFreqAAmount", 0.0f));
-    s.setPMFilterEnvToPWAAmount(get_json_value_safe(j, "pmFilterEnvToPWAAmount", 0.0f));
-    s.setPMFilterEnvToFilterCutoffAmount(get_json_value_safe(j, "pmFilterEnvToFilterCutoffAmount", 0.0f));
-    s.setPMOscBToPWAAmount(get_json_value_safe(j, "pmOscBToPWAAmount", 0.0f));
-    s.setPMOscBToFilterCutoffAmount(get_json_value_safe(j, "pmOscBToFilterCutoffAmount", 0.0f));
-    
-    if (j.contains("filterType")) s.setFilterType(stringToFilterType(j.at("filterType").get<std::string>()));
-    s.setVCFBaseCutoff(get_json_value_safe(j, "vcfBaseCutoff", 5000.0f));
-    s.setVCFResonance(get_json_value_safe(j, "vcfResonance", 0.1f));
-    s.setVCFKeyFollow(get_json_value_safe(j, "vcfKeyFollow", 0.0f));
-    s.setVCFEnvelopeAmount(get_json_value_safe(j, "vcfEnvelopeAmount", 0.5f));
-
-    s.setMixerDrive(get_json_value_safe(j, "mixerDrive", 0.0f));
-    s.setMixerPostGain(get_json_value_safe(j, "mixerPostGain", 1.0f));
-
-    // Envelopes
-    if (j.contains("ampEnv")) {
-        const auto& env_j = j.at("ampEnv");
-        EnvelopeParams p = {
-            get_json_value_safe(env_j, "attack", 0.01f, "ampEnv."),
-            get_json_value_safe(env_j, "decay", 0.1f, "ampEnv."),
-            get_json_value_safe(env_j, "sustain", 0.7f, "ampEnv."),
-            get_json_value_safe(env_j, "release", 0.2f, "ampEnv.")
-        };
-        s.setAmpEnvelope(p);
-    }
-    if (j.contains("filterEnv")) {
-        const auto& env_j = j.at("filterEnv");
-        EnvelopeParams p = {
-            get_json_value_safe(env_j, "attack", 0.05f, "filterEnv."),
-            get_json_value_safe(env_j, "decay", 0.2f, "filterEnv."),
-            get_json_value_safe(env_j, "sustain", 0.5f, "filterEnv."),
-            get_json_value_safe(env_j, "release", 0.3f, "filterEnv.")
-        };
-        s.setFilterEnvelope(p);
-    }
-
-    // LFO
-    s.setLfoRate(get_json_value_safe(j, "lfoRate", 1.0f));
-    if (j.contains("lfoWaveform")) s.setLfoWaveform(stringToLfoWaveform(j.at("lfoWaveform").get<std::string>()));
-    s.setLfoAmountToVco1Freq(get_json_value_safe(j, "lfoAmountToVco1Freq", 0.0f));
-    s.setLfoAmountToVco2Freq(get_json_value_safe(j, "lfoAmountToVco2Freq", 0.0f));
-    s.setLfoAmountToVco1Pw(get_json_value_safe(j, "lfoAmountToVco1Pw", 0.0f));
-    s.setLfoAmountToVco2Pw(get_json_value_safe(j, "lfoAmountToVco2Pw", 0.0f));
-    s.setLfoAmountToVcfCutoff(get_json_value_safe(j, "lfoAmountToVcfCutoff", 0.0f));
-    
-    // Modulation Wheel
-    s.setModulationWheelValue(get_json_value_safe(j, "modulationWheelValue", 0.0f)); // Usually set by MIDI, but can be preset
-    if (j.contains("wheelModSource")) s.setWheelModSource(stringToWheelModSource(j.at("wheelModSource").get<std::string>()));
-    s.setWheelModAmountToFreqA(get_json_value_safe(j, "wheelModAmountToFreqA", 0.0f));
-    s.setWheelModAmountToFreqB(get_json_value_safe(j, "wheelModAmountToFreqB", 0.0f));
-    s.setWheelModAmountToPWA(get_json_value_safe(j, "wheelModAmountToPWA", 0.0f));
-    s.setWheelModAmountToPWB(get_json_value_safe(j, "wheelModAmountToPWB", 0.0f));
-    s.setWheelModAmountToFilter(get_json_value_safe(j, "wheelModAmountToFilter", 0.0f));
-
-    // Unison
-    s.setUnisonEnabled(get_json_value_safe(j, "unisonEnabled", false));
-    s.setUnisonDetuneCents(get_json_value_safe(j, "unisonDetuneCents", 7.0f));
-    s.setUnisonStereoSpread(get_json_value_safe(j, "unisonStereoSpread", 0.7f));
-
-    // Glide
-    s.setGlideEnabled(get_json_value_safe(j, "glideEnabled", false));
-    s.setGlideTime(get_json_value_safe(j, "glideTime", 0.05f));
-
-    // Analog Drift
-    s.setAnalogPitchDriftDepth(get_json_value_safe(j, "analogPitchDriftDepth", 0.0f));
-    s.setAnalogPWDriftDepth(get_json_value_safe(j, "analogPWDriftDepth", 0.0f));
-
-    // Pitch Bend Range
-    s.setPitchBendRange(get_json_value_safe(j, "pitchBendRangeSemitones", 2.0f));
-
-
-    // Harmonics (for Additive waveform primarily)
-    if (j.contains("osc1Harmonics") && j.at("osc1Harmonics").is_array()) {
-        int harmonicIdx = 0;
-        for (const auto& amp_json : j.at("osc1Harmonics")) {
-            if (harmonicIdx < 16) {
-                s.setOscHarmonicAmplitude(1, harmonicIdx++, get_json_value_safe(amp_json, "", 0.0f));
-            } else break;
-        }
+// --- Preset Bank and Morph ---
+// Program change selects from the mapped bank (--bank=file.psb); bank select
+// (CC 0/32) picks the group of 128. Only lookups and a patch publish happen
+// here, so it is safe on the MIDI thread while playing. While morphing, the
+// selected preset becomes the morph target instead, and CC 16 sets the
+// morph position. With --watch the preset file owns the sound and program
+// changes are ignored.
+PresetBank presetBank;
+int bankSelect[16] = {};
+Preset morphSource;
+const int MORPH_CONTROLLER = 16;
+
+// Returns true if the message was bank select, program change or the morph
+// controller.
+bool handlePresetMessage(unsigned char status, unsigned char data1, unsigned char data2) {
+    const int channel = status & 0x0F;
+    const int type = status & 0xF0;
+    if (type == 0xB0 && data1 == MORPH_CONTROLLER && morphPtr) {
+        morphPtr->setPositionFromController(data2);
+        return true;
     }
-    if (j.contains("osc2Harmonics") && j.at("osc2Harmonics").is_array()) {
-        int harmonicIdx = 0;
-        for (const auto& amp_json : j.at("osc2Harmonics")) {
-            if (harmonicIdx < 16) {
-                s.setOscHarmonicAmplitude(2, harmonicIdx++, get_json_value_safe(amp_json, "", 0.0f));
-            } else break;
-        }
+    if (type == 0xB0 && (data1 == 0 || data1 == 32)) {
+        bankSelect[channel] = data1 == 0 ? (data2 << 7) | (bankSelect[channel] & 0x7F)
+                                         : (bankSelect[channel] & ~0x7F) | data2;
+        return true;
     }
-
-    // Reverb
-    if (j.contains("reverb") && reverb) {
-        const auto& rev_j = j.at("reverb");
-        reverb->setEnabled(get_json_value_safe(rev_j, "enabled", false, "reverb."));
-        reverb->setDryWetMix(get_json_value_safe(rev_j, "dryWetMix", 0.3f, "reverb."));
-        reverb->setRoomSize(get_json_value_safe(rev_j, "roomSize", 0.5f, "reverb."));
-        reverb->setDamping(get_json_value_safe(rev_j, "damping", 0.5f, "reverb."));
-        reverb->setWetGain(get_json_value_safe(rev_j, "wetGain", 1.0f, "reverb."));
-        reverb->setRT60(get_json_value_safe(rev_j, "rt60", 1.2f, "reverb."));
+    if (type != 0xC0) return false;
+    const Preset* preset = presetBank.getPreset(bankSelect[channel] * 128 + data1);
+    if (!preset) return true;
+    if (multiSynthPtr) {
+        if (channel < multiSynthPtr->getNumParts()) applyPreset(multiSynthPtr->getPart(channel), nullptr, *preset);
+    } else if (morphPtr) {
+        morphPtr->setPresets(morphSource, *preset);
+    } else if (!blockEventsPtr) {
+        applyPreset(synth, mainReverbPtr, *preset);
     }
-    std::cout << "Parameters loaded successfully from " << filename << std::endl;
+    return true;
 }
 
 
@@ -359,8 +250,15 @@ void midiInputCallback(double /*deltatime*/, std::vector<unsigned char>* message
     if (!message || message->empty()) return;
 
     unsigned char status = message->at(0);
+    if (message->size() >= 2 &&
+        handlePresetMessage(status, message->at(1), message->size() >= 3 ? message->at(2) : 0)) {
+        return;
+    }
+    if (multiSynthPtr) {
+        if (message->size() >= 3) multiSynthPtr->handleMidiMessage(status, message->at(1), message->at(2));
+        return;
+    }
     unsigned char type = status & 0xF0;
-    // unsigned char channel = status & 0x0F; // Channel info if needed
 
     if (type == 0x90 && message->size() >= 3) { // Note On
         int note = message->at(1);
@@ -468,6 +366,7 @@ void playMidiFile(const std::string& filePath, PaStream* audioStream) {
         if (midiInputActive.load()) { // If live MIDI input starts, stop file playback
             std::cout << "MIDI input detected, stopping MIDI file playback." << std::endl;
             synth.noteOff(-1); // All notes off as a precaution
+            if (multiSynthPtr) multiSynthPtr->allNotesOff();
             return;
         }
 
@@ -493,7 +392,12 @@ void playMidiFile(const std::string& filePath, PaStream* audioStream) {
         currentTimeSeconds = eventTimeSeconds; // Update our tracked time regardless
 
         // Process MIDI event
-        if (event.isNoteOn()) {
+        if (event.size() >= 2 && handlePresetMessage(event[0], event[1], event.size() >= 3 ? event[2] : 0)) {
+            continue;
+        }
+        if (multiSynthPtr) {
+            if (event.size() >= 3) multiSynthPtr->handleMidiMessage(event[0], event[1], event[2]);
+        } else if (event.isNoteOn()) {
             synth.noteOn(event.getKeyNumber(), static_cast<float>(event.getVelocity()));
         } else if (event.isNoteOff()) {
             synth.noteOff(event.getKeyNumber());
@@ -512,6 +416,7 @@ void playMidiFile(const std::string& filePath, PaStream* audioStream) {
     }
     std::cout << "MIDI file playback finished." << std::endl;
     synth.noteOff(-1); // All notes off
+    if (multiSynthPtr) multiSynthPtr->allNotesOff();
 }
 
 
@@ -521,19 +426,91 @@ int main(int argc, char* argv[]) {
     std::string midiFilePath = "";
     int midiInputPort = -1; // Default to no MIDI input, will prompt if not specified
 
+    int renderAheadBlocks = 0; // 0 = render inside the audio callback
+    RealtimeConfig renderThreadConfig;
+    bool lockMemory = false;
+    bool pipelineEffects = false;
+    bool multitimbral = false;
+    std::string compilePresetPath; // --compile-preset=out.psp: compile and exit
+    std::string bankPath;          // --bank=file.psb: presets for MIDI program change
+    std::string morphPath;         // --morph=preset: morph target for CC 16
+    bool watchPreset = false;      // --watch: reload the JSON preset when it is saved
+
     // Basic command line argument parsing
-    // Usage: ./synth [json_config_path] [midi_file_path] [midi_input_port_num]
-    if (argc > 1) jsonPath = argv[1];
-    if (argc > 2) midiFilePath = argv[2];
-    if (argc > 3) {
+    // Usage: ./synth [options] [json_config_path] [midi_file_path] [midi_input_port_num]
+    // Options: --render-ahead[=blocks] --rt-priority=N --rt-cpu=N --mlock --pipeline-effects --multitimbral
+    //          --compile-preset=out.psp (compile the preset to binary and exit) --bank=file.psb
+    //          --morph=preset (CC 16 morphs from the loaded preset to this one) --watch
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--rt-priority=", 0) == 0) {
+            try {
+                renderThreadConfig.priority = std::clamp(std::stoi(arg.substr(14)), 1, 99);
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid real-time priority: " << arg << ". Ignoring it." << std::endl;
+            }
+        } else if (arg.rfind("--rt-cpu=", 0) == 0) {
+            try {
+                renderThreadConfig.cpu = std::max(0, std::stoi(arg.substr(9)));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid CPU number: " << arg << ". Ignoring it." << std::endl;
+            }
+        } else if (arg == "--mlock") {
+            lockMemory = true;
+        } else if (arg == "--pipeline-effects") {
+            pipelineEffects = true;
+        } else if (arg == "--multitimbral") {
+            multitimbral = true;
+        } else if (arg.rfind("--compile-preset=", 0) == 0) {
+            compilePresetPath = arg.substr(17);
+        } else if (arg.rfind("--bank=", 0) == 0) {
+            bankPath = arg.substr(7);
+        } else if (arg.rfind("--morph=", 0) == 0) {
+            morphPath = arg.substr(8);
+        } else if (arg == "--watch") {
+            watchPreset = true;
+        } else if (arg == "--render-ahead") {
+            renderAheadBlocks = 4;
+        } else if (arg.rfind("--render-ahead=", 0) == 0) {
+            try {
+                renderAheadBlocks = std::max(1, std::stoi(arg.substr(15)));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid render-ahead block count: " << arg << ". Using 4." << std::endl;
+                renderAheadBlocks = 4;
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() > 0) jsonPath = args[0];
+    if (args.size() > 1) midiFilePath = args[1];
+    if (args.size() > 2) {
         try {
-            midiInputPort = std::stoi(argv[3]);
+            midiInputPort = std::stoi(args[2]);
         } catch (const std::exception& e) {
-            std::cerr << "Invalid MIDI input port number: " << argv[3] << ". Will prompt if MIDI input is chosen." << std::endl;
+            std::cerr << "Invalid MIDI input port number: " << args[2] << ". Will prompt if MIDI input is chosen." << std::endl;
             midiInputPort = -1;
         }
     }
     
+    if (!compilePresetPath.empty()) {
+        Preset compiled;
+        std::string error;
+        if (!readPreset(jsonPath, compiled)) return 1;
+        if (!PresetFile::save(compiled, compilePresetPath, error)) {
+            std::cerr << "Could not write compiled preset: " << error << std::endl;
+            return 1;
+        }
+        std::cout << "Compiled " << jsonPath << " to " << compilePresetPath << std::endl;
+        return 0;
+    }
+
+    const SynthFootprint& footprint = synth.getFootprint();
+    std::cout << "Synth: " << footprint.numVoices << " voices x " << footprint.bytesPerVoice
+              << " bytes (" << footprint.voicePoolBytes + footprint.additivePoolBytes + footprint.patchBytes
+              << " bytes total), constructed in " << footprint.constructionMicros << " us" << std::endl;
+
     // Initialize PortAudio
     if (Pa_Initialize() != paNoError) {
         std::cerr << "PortAudio initialization error!" << std::endl;
@@ -545,13 +522,162 @@ int main(int argc, char* argv[]) {
     mainReverbPtr = reverbInstance.get();
     synth.addEffect(std::move(reverbInstance));
 
-    // Load parameters (from JSON or default strings)
-    loadParametersFromJson(synth, mainReverbPtr, jsonPath);
+    // Load parameters (from a JSON or compiled preset, or default strings)
+    Preset preset;
+    const bool havePreset = readPreset(jsonPath, preset);
+    if (havePreset) {
+        applyPreset(synth, mainReverbPtr, preset);
+    } else {
+        loadDefaultStringsSound(synth, mainReverbPtr);
+    }
+
+    if (!bankPath.empty()) {
+        std::string error;
+        std::vector<std::string> skipped;
+        if (presetBank.open(bankPath, error, skipped)) {
+            std::cout << "Preset bank " << bankPath << ": " << presetBank.size() << " presets" << std::endl;
+            for (const auto& message : skipped) {
+                std::cerr << "Warning: skipping " << message << std::endl;
+            }
+        } else {
+            std::cerr << "Warning: Could not open preset bank " << bankPath << ": " << error << std::endl;
+        }
+    }
+
+    // Multi-timbral: every part starts from the same preset, and its reverb
+    // settings go to one shared send reverb, fed at the preset's dry/wet mix.
+    std::unique_ptr<MultiTimbralSynth> multiSynth;
+    if (multitimbral) {
+        RealtimeConfig poolConfig = renderThreadConfig;
+        if (poolConfig.cpu >= 0) poolConfig.cpu += 1;
+        const int workers = std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+        multiSynth = std::make_unique<MultiTimbralSynth>(synth.getSampleRate(), MultiTimbralSynth::MAX_PARTS, 16,
+                                                         workers, poolConfig);
+        auto sendReverb = std::make_unique<ReverbEffect>(multiSynth->getSampleRate());
+        if (havePreset) {
+            applyPreset(multiSynth->getPart(0), sendReverb.get(), preset);
+        } else {
+            loadDefaultStringsSound(multiSynth->getPart(0), sendReverb.get());
+        }
+        for (int i = 1; i < multiSynth->getNumParts(); ++i) {
+            multiSynth->getPart(i).setPatch(multiSynth->getPart(0).getPatch());
+        }
+        const float send = sendReverb->isEnabled() ? sendReverb->getDryWetMix() : 0.0f;
+        for (int i = 0; i < multiSynth->getNumParts(); ++i) {
+            multiSynth->setPartLevel(i, 1.0f - send);
+            multiSynth->setPartSend(i, send);
+        }
+        sendReverb->setDryWetMix(1.0f);
+        multiSynth->addSendEffect(std::move(sendReverb));
+        if (!multiSynth->getRenderPool().getWorkerConfigError().empty()) {
+            std::cerr << "Render workers run without real-time settings: "
+                      << multiSynth->getRenderPool().getWorkerConfigError() << std::endl;
+        }
+        multiSynth->setAdaptiveQuality(true);
+        multiSynth->setVoiceBudget(VoiceBudget::LIVE_BUDGET);
+        multiSynthPtr = multiSynth.get();
+        std::cout << "Multi-timbral: " << multiSynth->getNumParts() << " parts on "
+                  << workers + 1 << " render threads" << std::endl;
+        if (renderAheadBlocks > 0 || pipelineEffects) {
+            std::cout << "--render-ahead and --pipeline-effects apply to single-part mode only; ignoring them." << std::endl;
+            renderAheadBlocks = 0;
+            pipelineEffects = false;
+        }
+    }
+
+    // Morph from the loaded preset to --morph's, driven by CC 16.
+    std::unique_ptr<PresetMorph> morph;
+    if (!morphPath.empty()) {
+        Preset target;
+        if (multitimbral || renderAheadBlocks > 0) {
+            std::cout << "--morph applies to single-part mode without --render-ahead; ignoring it." << std::endl;
+        } else if (!havePreset) {
+            std::cerr << "--morph needs a preset to morph from; ignoring it." << std::endl;
+        } else if (readPreset(morphPath, target)) {
+            morphSource = preset;
+            morph = std::make_unique<PresetMorph>(synth, mainReverbPtr);
+            morph->setPresets(morphSource, target);
+            morphPtr = morph.get();
+            blockEventsPtr = morphPtr;
+            std::cout << "Morphing to " << morphPath << " with CC " << MORPH_CONTROLLER << std::endl;
+        }
+    }
+
+    // Hot reload: edits to the JSON preset are applied at the next block.
+    std::unique_ptr<PresetWatcher> watcher;
+    if (watchPreset) {
+        std::string error;
+        if (multitimbral || renderAheadBlocks > 0 || morph) {
+            std::cout << "--watch applies to single-part mode without --render-ahead or --morph; ignoring it."
+                      << std::endl;
+        } else if (!havePreset || isCompiledPreset(jsonPath)) {
+            std::cerr << "--watch needs a JSON preset that loaded; ignoring it." << std::endl;
+        } else {
+            watcher = std::make_unique<PresetWatcher>(synth, mainReverbPtr, jsonPath, preset);
+            if (watcher->start(error)) {
+                blockEventsPtr = watcher.get();
+                std::cout << "Watching " << jsonPath << " for changes" << std::endl;
+            } else {
+                std::cerr << "Could not watch " << jsonPath << ": " << error << std::endl;
+                watcher.reset();
+            }
+        }
+    }
+
+    // Live playback has a deadline, so let the synth trade quality and
+    // polyphony for time.
+    if (!multitimbral) {
+        synth.setAdaptiveQuality(true);
+        synth.setVoiceBudget(VoiceBudget::LIVE_BUDGET);
+    }
+
+    // Effects one block behind the voices, on their own core next to the
+    // render thread's when that is pinned.
+    if (pipelineEffects) {
+        RealtimeConfig effectsThreadConfig = renderThreadConfig;
+        if (effectsThreadConfig.cpu >= 0) effectsThreadConfig.cpu += 1;
+        if (!synth.setPipelinedEffects(true, 4096, effectsThreadConfig)) {
+            std::cerr << "Effects thread runs without real-time settings: "
+                      << synth.getEffectsPipeline()->getWorkerConfigError() << std::endl;
+        }
+        std::cout << "Effects pipelined onto a second thread (one block of extra latency)." << std::endl;
+    }
+
+    // Everything the audio path touches exists by now; lock it in RAM.
+    if (lockMemory) {
+        std::string error;
+        if (Realtime::lockMemory(error)) {
+            std::cout << "Memory locked and prefaulted." << std::endl;
+        } else {
+            std::cerr << "Could not lock memory: " << error << std::endl;
+        }
+    }
+
+    // The thread doing the DSP gets the priority and the pinned core. With
+    // render-ahead the callback thread only copies, so it gets the priority
+    // but is left free to run on any core.
+    callbackThreadConfig = renderThreadConfig;
+    callbackThreadConfigError.reserve(256);
+
+    // Optional render-ahead: a dedicated thread keeps the ring topped up and
+    // the callback only copies from it, at the cost of added latency.
+    const int framesPerBuffer = 256;
+    std::unique_ptr<RenderAhead> renderAhead;
+    if (renderAheadBlocks > 0) {
+        callbackThreadConfig.cpu = -1;
+        renderAhead = std::make_unique<RenderAhead>(synth, framesPerBuffer, renderAheadBlocks, renderThreadConfig);
+        if (!renderAhead->start()) {
+            std::cerr << "Render thread runs without real-time settings: "
+                      << renderAhead->getThreadConfigError() << std::endl;
+        }
+        std::cout << "Rendering ahead by " << renderAheadBlocks << " blocks ("
+                  << 1000.0 * renderAheadBlocks * framesPerBuffer / synth.getSampleRate() << " ms)" << std::endl;
+    }
 
     // Open PortAudio stream
     PaStream* audioStream;
     PaError err = Pa_OpenDefaultStream(&audioStream, 0, 2, paFloat32,
-                                     synth.getSampleRate(), 256, audioCallback, nullptr);
+                                     synth.getSampleRate(), framesPerBuffer, audioCallback, renderAhead.get());
     if (err != paNoError) {
         std::cerr << "PortAudio stream open error: " << Pa_GetErrorText(err) << std::endl;
         Pa_Terminate();
@@ -581,7 +707,7 @@ int main(int argc, char* argv[]) {
         midiFilePlayed = true;
     } else {
         std::cout << "No MIDI input or MIDI file specified. Idling." << std::endl;
-        std::cout << "Usage: " << argv[0] << " [params.json] [song.mid] [midi_port_num]" << std::endl;
+        std::cout << "Usage: " << argv[0] << " [--render-ahead[=blocks]] [--rt-priority=N] [--rt-cpu=N] [--mlock] [--pipeline-effects] [--multitimbral] [--compile-preset=out.psp] [--bank=file.psb] [--morph=preset] [--watch] [params.json|params.psp] [song.mid] [midi_port_num]" << std::endl;
         std::cout << "Example (strings preset, play midifile): " << argv[0] << " \"\" my_song.mid" << std::endl;
         std::cout << "Example (load 'custom.json', listen to MIDI port 0): " << argv[0] << " custom.json \"\" 0" << std::endl;
         std::cout << "If params.json is empty string or non-existent, default strings are used." << std::endl;
@@ -590,8 +716,39 @@ int main(int argc, char* argv[]) {
     // Main loop (keep audio running)
     if (midiInputActive.load() || !midiFilePlayed) { // Keep alive if MIDI input or if nothing played
         std::cout << "Synth running. Press Ctrl+C to quit." << std::endl;
+        unsigned reportedQualityTransitions = 0;
+        unsigned reportedUnderruns = 0;
+        unsigned long reportedPageFaults = 0;
         while (Pa_IsStreamActive(audioStream)) {
             Pa_Sleep(100); // Sleep a bit
+            const QualityGovernor& quality =
+                multiSynthPtr ? multiSynthPtr->getQualityGovernor() : synth.getQualityGovernor();
+            if (quality.getTransitions() != reportedQualityTransitions) {
+                reportedQualityTransitions = quality.getTransitions();
+                std::cout << "Quality tier " << quality.getTier() << " (DSP load "
+                          << static_cast<int>(quality.getLoad() * 100.0f) << "%)" << std::endl;
+            }
+            if (callbackThreadState.load(std::memory_order_acquire) == CALLBACK_THREAD_FAILED) {
+                std::cerr << "Audio callback thread runs without real-time settings: "
+                          << callbackThreadConfigError << std::endl;
+                callbackThreadState.store(CALLBACK_THREAD_CONFIGURED, std::memory_order_relaxed);
+            }
+            unsigned long pageFaults = callbackPageFaults.getFaults();
+            if (renderAhead) pageFaults += renderAhead->getStats().renderPageFaults;
+            if (pageFaults != reportedPageFaults) {
+                reportedPageFaults = pageFaults;
+                std::cout << "Audio threads took " << pageFaults << " page faults while rendering"
+                          << (lockMemory ? "" : " (run with --mlock to prevent this)") << std::endl;
+            }
+            if (renderAhead) {
+                const RenderAheadStats stats = renderAhead->getStats();
+                if (stats.underruns != reportedUnderruns) {
+                    reportedUnderruns = stats.underruns;
+                    std::cout << "Render-ahead underrun (" << stats.underruns << " total, lowest fill "
+                              << stats.minFillFrames << "/" << stats.lookaheadFrames << " frames)" << std::endl;
+                    renderAhead->resetStats();
+                }
+            }
             if (midiInputActive.load() && midiIn && !midiIn->isPortOpen()) {
                  std::cerr << "MIDI port seems to have closed unexpectedly." << std::endl;
                  break; // Or try to reopen?
@@ -610,11 +767,13 @@ int main(int argc, char* argv[]) {
     if (err != paNoError) {
         std::cerr << "PortAudio stream stop error: " << Pa_GetErrorText(err) << std::endl;
     }
+    if (renderAhead) renderAhead->stop();
     err = Pa_CloseStream(audioStream);
     if (err != paNoError) {
         std::cerr << "PortAudio stream close error: " << Pa_GetErrorText(err) << std::endl;
     }
     Pa_Terminate();
+    RtCheck::report();
     std::cout << "Synth stopped." << std::endl;
 
     return 0;
@@ -0,0 +1,129 @@
+// synth/mod_matrix.cpp
+#include "mod_matrix.h"
+#include "patch.h"
+
+namespace {
+
+const char* const SOURCE_NAMES[] = {"lfo", "lfo2", "lfo3", "lfo4", "wheel", "noise", "constant", "filterEnv", "ampEnv", "velocity", "oscB"};
+static_assert(sizeof(SOURCE_NAMES) / sizeof(SOURCE_NAMES[0]) == NUM_MOD_SOURCES, "one name per ModSource");
+
+const ModDestinationInfo DESTINATION_INFO[] = {
+    {"osc1Pitch", 48.0f},
+    {"osc2Pitch", 48.0f},
+    {"osc1LinearFM", 4.0f},
+    {"osc1PulseWidth", 1.0f},
+    {"osc2PulseWidth", 1.0f},
+    {"osc1Level", 1.0f},
+    {"osc2Level", 1.0f},
+    {"noiseLevel", 1.0f},
+    {"drive", 1.0f},
+    {"filterCutoff", 20000.0f},
+    {"filterResonance", 1.0f},
+    {"amplitude", 1.0f},
+};
+static_assert(sizeof(DESTINATION_INFO) / sizeof(DESTINATION_INFO[0]) == NUM_MOD_DESTINATIONS,
+              "one entry per ModDestination");
+
+float lfoAmount(const Patch& patch, LfoDestination destination) {
+    return patch.lfoModAmounts[static_cast<int>(destination)];
+}
+
+} // namespace
+
+const char* modSourceName(ModSource source) {
+    return SOURCE_NAMES[static_cast<int>(source)];
+}
+
+const ModDestinationInfo& modDestinationInfo(ModDestination destination) {
+    return DESTINATION_INFO[static_cast<int>(destination)];
+}
+
+bool modRouteSupported(const ModRoute& route) {
+    return route.source != ModSource::OscB ||
+           (route.destination != ModDestination::Osc1Pitch && route.destination != ModDestination::Osc2Pitch &&
+            route.destination != ModDestination::Osc2PulseWidth);
+}
+
+void ModMatrix::addRoute(ModSource source, ModDestination destination, float amount, bool viaWheel) {
+    ModVector* columns = viaWheel ? viaWheel_ : fixed_;
+    columns[static_cast<int>(source)].lanes[static_cast<int>(destination)] += amount;
+}
+
+void ModMatrix::compile(const Patch& patch) {
+    for (int s = 0; s < NUM_MOD_SOURCES; ++s) {
+        fixed_[s] = ModVector();
+        viaWheel_[s] = ModVector();
+    }
+    using D = ModDestination;
+    using S = ModSource;
+
+    // The Patch's fixed routings, in the units Voice used to apply them.
+    // LFO to pulse width goes through the PWM depth.
+    addRoute(S::Lfo, D::Osc1Pitch, lfoAmount(patch, LfoDestination::VCO1_Freq), false);
+    addRoute(S::Lfo, D::Osc2Pitch, lfoAmount(patch, LfoDestination::VCO2_Freq), false);
+    addRoute(S::Lfo, D::Osc1PulseWidth, lfoAmount(patch, LfoDestination::VCO1_PW) * patch.pwmDepth, false);
+    addRoute(S::Lfo, D::Osc2PulseWidth, lfoAmount(patch, LfoDestination::VCO2_PW) * patch.pwmDepth, false);
+    addRoute(S::Lfo, D::FilterCutoff, lfoAmount(patch, LfoDestination::VCF_Cutoff), false);
+
+    const S wheelSource = patch.wheelModSource == WheelModSource::LFO ? S::Lfo : S::Noise;
+    addRoute(wheelSource, D::Osc1Pitch, patch.wheelModToFreqAAmount * 12.0f, true);
+    addRoute(wheelSource, D::Osc2Pitch, patch.wheelModToFreqBAmount * 12.0f, true);
+    addRoute(wheelSource, D::Osc1PulseWidth, patch.wheelModToPWAAmount * 0.49f, true);
+    addRoute(wheelSource, D::Osc2PulseWidth, patch.wheelModToPWBAmount * 0.49f, true);
+    addRoute(wheelSource, D::FilterCutoff, patch.wheelModToFilterAmount * 2000.0f, true);
+
+    // Poly-mod treats the filter envelope as bipolar around 0.5, hence the
+    // Constant offsets.
+    addRoute(S::FilterEnv, D::Osc1LinearFM, 4.0f * patch.pmFilterEnvToFreqAAmount, false);
+    addRoute(S::Constant, D::Osc1LinearFM, -2.0f * patch.pmFilterEnvToFreqAAmount, false);
+    addRoute(S::FilterEnv, D::Osc1PulseWidth, patch.pmFilterEnvToPWAAmount, false);
+    addRoute(S::Constant, D::Osc1PulseWidth, -0.5f * patch.pmFilterEnvToPWAAmount, false);
+    addRoute(S::FilterEnv, D::FilterCutoff, 4000.0f * patch.pmFilterEnvToFilterCutoffAmount, false);
+    addRoute(S::Constant, D::FilterCutoff, -2000.0f * patch.pmFilterEnvToFilterCutoffAmount, false);
+    addRoute(S::OscB, D::Osc1PulseWidth, 0.5f * patch.pmOscBToPWAAmount, false);
+    addRoute(S::OscB, D::FilterCutoff, 2000.0f * patch.pmOscBToFilterCutoffAmount, false);
+
+    const int numRoutes = patch.numModRoutes < MAX_MOD_ROUTES ? patch.numModRoutes : MAX_MOD_ROUTES;
+    for (int i = 0; i < numRoutes; ++i) {
+        const ModRoute& route = patch.modRoutes[i];
+        const int source = static_cast<int>(route.source);
+        const int destination = static_cast<int>(route.destination);
+        if (source < 0 || source >= NUM_MOD_SOURCES || destination < 0 || destination >= NUM_MOD_DESTINATIONS) continue;
+        if (!modRouteSupported(route)) continue;
+        addRoute(route.source, route.destination, route.amount, route.viaWheel);
+    }
+
+    perVoiceLfos_ = 0;
+    for (int l = 1; l < NUM_LFOS; ++l) {
+        if (patch.extraLfos[l - 1].perVoice) perVoiceLfos_ |= 1u << l;
+    }
+
+    activeSources_ = 0;
+    targeted_ = 0;
+    for (int s = 0; s < NUM_MOD_SOURCES; ++s) {
+        for (int d = 0; d < NUM_MOD_DESTINATIONS; ++d) {
+            if (fixed_[s].lanes[d] != 0.0f || viaWheel_[s].lanes[d] != 0.0f) {
+                activeSources_ |= 1u << s;
+                targeted_ |= 1u << d;
+            }
+        }
+    }
+    refreshColumns();
+}
+
+void ModMatrix::setWheel(float wheel) {
+    if (wheel == wheel_) return;
+    wheel_ = wheel;
+    refreshColumns();
+}
+
+void ModMatrix::refreshColumns() {
+    for (int s = 0; s < NUM_MOD_SOURCES; ++s) {
+        for (int i = 0; i < MOD_LANES; ++i) {
+            columns_[s].lanes[i] = fixed_[s].lanes[i] + wheel_ * viaWheel_[s].lanes[i];
+        }
+    }
+    blockBase_ = ModVector();
+    addColumn(ModSource::Constant, 1.0f, blockBase_);
+    addColumn(ModSource::Wheel, wheel_, blockBase_);
+}
@@ -0,0 +1,142 @@
+// synth/mod_matrix.h
+#pragma once
+#include "lfo.h"
+
+struct Patch;
+
+// Global sources are shared by all voices and evaluated once per sample;
+// voice sources are per note. LFOs and Noise are bipolar, the rest 0..1
+// (Constant is always 1, for offsets). OscB is oscillator B's audio output.
+// Lfo is LFO 1; Lfo2..Lfo4 are global or per voice as the patch says.
+enum class ModSource {
+    Lfo,
+    Lfo2,
+    Lfo3,
+    Lfo4,
+    Wheel,
+    Noise,
+    Constant,
+    FilterEnv,
+    AmpEnv,
+    Velocity,
+    OscB,
+    NumSources
+};
+
+// Amounts are in the destination's units: semitones for pitch, multiples of
+// the note frequency for linear FM, Hz for cutoff, and offsets in the
+// parameter's own 0..1 range otherwise. Amplitude scales the amp envelope by
+// (1 + value).
+enum class ModDestination {
+    Osc1Pitch,
+    Osc2Pitch,
+    Osc1LinearFM,
+    Osc1PulseWidth,
+    Osc2PulseWidth,
+    Osc1Level,
+    Osc2Level,
+    NoiseLevel,
+    Drive,
+    FilterCutoff,
+    FilterResonance,
+    Amplitude,
+    NumDestinations
+};
+
+struct ModRoute {
+    ModSource source = ModSource::Lfo;
+    ModDestination destination = ModDestination::FilterCutoff;
+    float amount = 0.0f;
+    bool viaWheel = false; // amount is scaled by the modulation wheel
+};
+
+constexpr int MAX_MOD_ROUTES = 16;
+constexpr int NUM_MOD_SOURCES = static_cast<int>(ModSource::NumSources);
+constexpr int NUM_MOD_DESTINATIONS = static_cast<int>(ModDestination::NumDestinations);
+// Destinations are padded to whole vectors so columns add without a tail.
+constexpr int MOD_LANES = 16;
+static_assert(NUM_MOD_DESTINATIONS <= MOD_LANES, "raise MOD_LANES");
+static_assert(static_cast<int>(ModSource::Lfo4) - static_cast<int>(ModSource::Lfo) + 1 == NUM_LFOS,
+              "one ModSource per LFO");
+
+struct alignas(64) ModVector {
+    float lanes[MOD_LANES] = {};
+    float operator[](ModDestination d) const { return lanes[static_cast<int>(d)]; }
+};
+
+// Names used by presets, and the largest amount each destination accepts.
+struct ModDestinationInfo {
+    const char* name;
+    float maxAmount;
+};
+const char* modSourceName(ModSource source);
+const ModDestinationInfo& modDestinationInfo(ModDestination destination);
+// False for routes the voice cannot honour: oscillator B renders after both
+// pitches and its own pulse width are set.
+bool modRouteSupported(const ModRoute& route);
+
+// The patch's modulation compiled to one column of destination amounts per
+// source: the fixed LFO, wheel and poly-mod amounts of the Patch become
+// routes like any other, so evaluation costs one multiply-add per lane for
+// each source in use however many routes there are. Audio thread only.
+class ModMatrix {
+public:
+    // Rebuilds the columns. Run on patch change; allocates nothing.
+    void compile(const Patch& patch);
+    // Folds the wheel into the columns of wheel-scaled routes; free when the
+    // wheel has not moved.
+    void setWheel(float wheel);
+
+    // Once per sample, before the voices run. Per-voice LFOs are skipped.
+    void evaluateGlobal(const LfoValues& lfos, float noise) {
+        global_ = blockBase_;
+        for (int l = 0; l < NUM_LFOS; ++l) {
+            if ((perVoiceLfos_ & (1u << l)) == 0) addColumn(lfoSource(l), lfos.lfo[l], global_);
+        }
+        addColumn(ModSource::Noise, noise, global_);
+    }
+    // global + the voice sources (except OscB), for a voice's control tick.
+    // Only the per-voice entries of `lfos` are read.
+    void evaluateVoice(float filterEnv, float ampEnv, float velocity, const LfoValues& lfos, ModVector& out) const {
+        out = global_;
+        addColumn(ModSource::FilterEnv, filterEnv, out);
+        addColumn(ModSource::AmpEnv, ampEnv, out);
+        addColumn(ModSource::Velocity, velocity, out);
+        for (int l = 0; l < NUM_LFOS; ++l) {
+            if (perVoiceLfos_ & (1u << l)) addColumn(lfoSource(l), lfos.lfo[l], out);
+        }
+    }
+    // Audio-rate oscillator B; reaches the destinations read after it renders.
+    bool hasOscB() const { return (activeSources_ & sourceBit(ModSource::OscB)) != 0; }
+    void addOscB(float oscB, ModVector& out) const { addColumn(ModSource::OscB, oscB, out); }
+
+    bool targets(ModDestination destination) const {
+        return (targeted_ & (1u << static_cast<int>(destination))) != 0;
+    }
+    // Bit n set when LFO n + 1 feeds any route, for LfoBank::configure().
+    unsigned lfosInUse() const { return (activeSources_ >> static_cast<int>(ModSource::Lfo)) & ((1u << NUM_LFOS) - 1); }
+
+private:
+    static unsigned sourceBit(ModSource source) { return 1u << static_cast<int>(source); }
+    static ModSource lfoSource(int lfo) { return static_cast<ModSource>(static_cast<int>(ModSource::Lfo) + lfo); }
+    void addRoute(ModSource source, ModDestination destination, float amount, bool viaWheel);
+    void refreshColumns();
+
+    void addColumn(ModSource source, float value, ModVector& out) const {
+        if ((activeSources_ & sourceBit(source)) == 0) return;
+        const float* column = columns_[static_cast<int>(source)].lanes;
+        for (int i = 0; i < MOD_LANES; ++i) {
+            out.lanes[i] += column[i] * value;
+        }
+    }
+
+    ModVector fixed_[NUM_MOD_SOURCES];    // routes without the wheel
+    ModVector viaWheel_[NUM_MOD_SOURCES]; // routes scaled by the wheel
+    ModVector columns_[NUM_MOD_SOURCES];  // fixed_ + wheel * viaWheel_
+    ModVector blockBase_; // Constant and Wheel sources, fixed for the block
+    ModVector global_;
+    unsigned activeSources_ = 0;
+    unsigned targeted_ = 0;
+    unsigned perVoiceLfos_ = 0; // bit n: LFO n + 1 is evaluated per voice
+    float wheel_ = 0.0f;
+};
@@ -0,0 +1,120 @@
+// synth/multi_timbral_synth.cpp
+#include "multi_timbral_synth.h"
+#include "effects/audio_effect.h"
+#include <algorithm>
+#include <chrono>
+
+MultiTimbralSynth::MultiTimbralSynth(int sampleRate, int numParts, int voicesPerPart, int renderWorkers,
+                                     const RealtimeConfig& workerConfig)
+    : sampleRate_(sampleRate),
+      pool_(renderWorkers, workerConfig),
+      governor_(std::clamp(numParts, 1, MAX_PARTS) * voicesPerPart) {
+    numParts = std::clamp(numParts, 1, MAX_PARTS);
+    parts_.reserve(numParts);
+    for (int i = 0; i < numParts; ++i) {
+        parts_.push_back(std::make_unique<PolySynth>(sampleRate, voicesPerPart));
+    }
+    mix_.resize(numParts);
+    partBuffers_.assign(numParts, std::vector<float>(2 * MAX_BLOCK_FRAMES, 0.0f));
+    sendBuffer_.assign(2 * MAX_BLOCK_FRAMES, 0.0f);
+}
+
+MultiTimbralSynth::~MultiTimbralSynth() = default;
+
+void MultiTimbralSynth::setPartLevel(int part, float level) {
+    if (part < 0 || part >= getNumParts()) return;
+    mix_[part].level = std::clamp(level, 0.0f, 2.0f);
+}
+
+void MultiTimbralSynth::setPartSend(int part, float send) {
+    if (part < 0 || part >= getNumParts()) return;
+    mix_[part].send = std::clamp(send, 0.0f, 1.0f);
+}
+
+void MultiTimbralSynth::addSendEffect(std::unique_ptr<AudioEffect> effect) {
+    sendEffects_.push_back(std::move(effect));
+}
+
+AudioEffect* MultiTimbralSynth::getSendEffect(size_t index) {
+    return index < sendEffects_.size() ? sendEffects_[index].get() : nullptr;
+}
+
+void MultiTimbralSynth::handleMidiMessage(unsigned char status, unsigned char data1, unsigned char data2) {
+    const int channel = status & 0x0F;
+    if (channel >= getNumParts()) return;
+    PolySynth& part = *parts_[channel];
+    switch (status & 0xF0) {
+    case 0x90:
+        if (data2 > 0) {
+            part.noteOn(data1, static_cast<float>(data2));
+        } else {
+            part.noteOff(data1);
+        }
+        break;
+    case 0x80:
+        part.noteOff(data1);
+        break;
+    case 0xE0:
+        part.setPitchBend(static_cast<float>(((data2 << 7) | data1) - 8192) / 8192.0f);
+        break;
+    case 0xB0:
+        if (data1 == 1) part.setModulationWheelValue(static_cast<float>(data2) / 127.0f);
+        break;
+    default:
+        break;
+    }
+}
+
+void MultiTimbralSynth::allNotesOff() {
+    for (auto& part : parts_) {
+        for (int note = 0; note < 128; ++note) {
+            part->noteOff(note);
+        }
+    }
+}
+
+void MultiTimbralSynth::processBlock(float* interleavedStereo, int numFrames) {
+    while (numFrames > 0) {
+        const int chunk = std::min(numFrames, MAX_BLOCK_FRAMES);
+        const auto start = std::chrono::steady_clock::now();
+        renderChunk(interleavedStereo, chunk);
+        const double renderSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        governor_.onBlock(getNumParts(), [this](int index) { return parts_[index].get(); }, renderSeconds,
+                          static_cast<double>(chunk) / sampleRate_);
+        interleavedStereo += 2 * chunk;
+        numFrames -= chunk;
+    }
+}
+
+void MultiTimbralSynth::renderChunk(float* interleavedStereo, int numFrames) {
+    auto renderPart = [this, numFrames](int index) {
+        parts_[index]->processBlock(partBuffers_[index].data(), numFrames);
+    };
+    pool_.parallelFor(getNumParts(), renderPart);
+
+    const size_t samples = 2 * static_cast<size_t>(numFrames);
+    std::fill(interleavedStereo, interleavedStereo + samples, 0.0f);
+    std::fill(sendBuffer_.begin(), sendBuffer_.begin() + samples, 0.0f);
+    for (int p = 0; p < getNumParts(); ++p) {
+        const float* part = partBuffers_[p].data();
+        const PartMix mix = mix_[p];
+        for (size_t i = 0; i < samples; ++i) {
+            interleavedStereo[i] += mix.level * part[i];
+            sendBuffer_[i] += mix.send * part[i];
+        }
+    }
+
+    if (sendEffects_.empty()) return;
+    for (int i = 0; i < numFrames; ++i) {
+        float L = sendBuffer_[2 * i];
+        float R = sendBuffer_[2 * i + 1];
+        for (const auto& effect : sendEffects_) {
+            if (effect && effect->isEnabled()) {
+                effect->processStereoSample(L, R, L, R);
+            }
+        }
+        interleavedStereo[2 * i] += L;
+        interleavedStereo[2 * i + 1] += R;
+    }
+}
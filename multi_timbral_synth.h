@@ -0,0 +1,71 @@
+// synth/multi_timbral_synth.h
+#pragma once
+#include "group_governor.h"
+#include "poly_synth.h"
+#include "render_pool.h"
+#include <memory>
+#include <vector>
+
+class AudioEffect;
+
+// Up to 16 PolySynth parts, one per MIDI channel, each with its own patch,
+// voice pool and insert effects. Parts render in parallel on a RenderPool;
+// the calling thread then sums them into the main bus and, by each part's
+// send level, into a send bus that runs through the shared send effects
+// (which should be set fully wet) before joining the main bus.
+//
+// Parts, send effects and the pool are fixed at construction or set up
+// before audio starts; note and parameter changes may come from a control
+// thread as with a single PolySynth.
+class MultiTimbralSynth {
+public:
+    static constexpr int MAX_PARTS = 16;
+    static constexpr int MAX_BLOCK_FRAMES = 1024; // larger blocks render in chunks
+
+    MultiTimbralSynth(int sampleRate, int numParts, int voicesPerPart, int renderWorkers,
+                      const RealtimeConfig& workerConfig = RealtimeConfig());
+    ~MultiTimbralSynth();
+
+    int getNumParts() const { return static_cast<int>(parts_.size()); }
+    PolySynth& getPart(int index) { return *parts_[index]; }
+    int getSampleRate() const { return sampleRate_; }
+    const RenderPool& getRenderPool() const { return pool_; }
+
+    // Quality tier and voice cap for all parts together, from the time a
+    // whole block takes (see GroupGovernor). Both off by default; leave the
+    // parts' own adaptation and budgets off.
+    void setAdaptiveQuality(bool enabled) { governor_.setAdaptiveQuality(enabled); }
+    void setVoiceBudget(float loadFraction) { governor_.setVoiceBudget(loadFraction); }
+    const QualityGovernor& getQualityGovernor() const { return governor_.getQualityGovernor(); }
+    const VoiceBudget& getVoiceBudget() const { return governor_.getVoiceBudget(); }
+
+    void setPartLevel(int part, float level);
+    void setPartSend(int part, float send);
+
+    void addSendEffect(std::unique_ptr<AudioEffect> effect);
+    AudioEffect* getSendEffect(size_t index);
+
+    // Routes a channel voice message to the part for its channel; channels
+    // without a part are ignored.
+    void handleMidiMessage(unsigned char status, unsigned char data1, unsigned char data2);
+    void allNotesOff();
+
+    void processBlock(float* interleavedStereo, int numFrames);
+
+private:
+    struct PartMix {
+        float level = 1.0f;
+        float send = 0.0f;
+    };
+
+    void renderChunk(float* interleavedStereo, int numFrames);
+
+    int sampleRate_;
+    std::vector<std::unique_ptr<PolySynth>> parts_;
+    std::vector<PartMix> mix_;
+    std::vector<std::vector<float>> partBuffers_;
+    std::vector<float> sendBuffer_;
+    std::vector<std::unique_ptr<AudioEffect>> sendEffects_;
+    RenderPool pool_;
+    GroupGovernor governor_;
+};
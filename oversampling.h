@@ -0,0 +1,89 @@
+// synth/oversampling.h
+#pragma once
+#include <algorithm>
+
+// Oversampling factor of one oscillator (1x, 2x or 4x), chosen from how high
+// its spectrum reaches relative to the sample rate. Sub-samples are decimated
+// by averaging. When the factor changes, the oscillator renders at the larger
+// of the old and new factors for FADE_SAMPLES and crossfades the two averages
+// through the decimation weights, so switching never steps the output.
+class AdaptiveOversampling {
+public:
+    static constexpr int MAX_FACTOR = 4;
+    static constexpr int FADE_SAMPLES = 64;
+
+    // Spectrum reach (Hz, relative to a naive saw at that fundamental) as a
+    // fraction of the sample rate above which 2x and 4x are used. Each
+    // doubling buys a naive saw about 4.5 dB less aliasing, the same as
+    // halving its pitch, so these keep every register near the alias level a
+    // fixed 2x had around middle C. Dropping to a lower factor needs the
+    // reach to fall a further HYSTERESIS (about 4 semitones) below.
+    static constexpr float TWO_X_ABOVE = 1.0f / 256.0f;
+    static constexpr float FOUR_X_ABOVE = 1.0f / 64.0f;
+    static constexpr float HYSTERESIS = 0.8f;
+
+    int getFactor() const { return factor_; }
+
+    // Upper bound from the synth's quality tier; a lower cap fades down like
+    // any other change.
+    void setMaxFactor(int maxFactor) { maxFactor_ = std::clamp(maxFactor, 1, MAX_FACTOR); }
+
+    // The next update() switches immediately, e.g. at note-on where the
+    // phase restarts anyway.
+    void snapNextUpdate() { snap_ = true; }
+
+    void update(float reachOverSampleRate) {
+        const int up = std::min(factorFor(reachOverSampleRate, 1.0f), maxFactor_);
+        int next = factor_;
+        if (up > factor_) {
+            next = up;
+        } else {
+            const int down = std::min(factorFor(reachOverSampleRate, HYSTERESIS), maxFactor_);
+            if (down < factor_) next = down;
+        }
+        if (snap_) {
+            factor_ = next;
+            fadeRemaining_ = 0;
+            snap_ = false;
+        } else if (next != factor_ && fadeRemaining_ == 0) {
+            previous_ = factor_;
+            factor_ = next;
+            fadeRemaining_ = FADE_SAMPLES;
+        }
+    }
+
+    // While fading, every output sample renders at the larger of the two
+    // factors and fadeWeights() gives each sub-sample's weight. Otherwise
+    // getFactor() sub-samples are plainly averaged.
+    bool isFading() const { return fadeRemaining_ != 0; }
+
+    int fadeWeights(float* weights) {
+        const int subSamples = std::max(factor_, previous_);
+        const float oldWeight = static_cast<float>(fadeRemaining_) / static_cast<float>(FADE_SAMPLES + 1);
+        std::fill(weights, weights + subSamples, 0.0f);
+        addAverage(weights, subSamples, previous_, oldWeight);
+        addAverage(weights, subSamples, factor_, 1.0f - oldWeight);
+        --fadeRemaining_;
+        return subSamples;
+    }
+
+private:
+    static int factorFor(float reach, float scale) {
+        if (reach > FOUR_X_ABOVE * scale) return 4;
+        if (reach > TWO_X_ABOVE * scale) return 2;
+        return 1;
+    }
+
+    // A factor-k average is every (subSamples/k)-th of the sub-samples.
+    static void addAverage(float* weights, int subSamples, int k, float gain) {
+        const int stride = subSamples / k;
+        const float w = gain / static_cast<float>(k);
+        for (int i = 0; i < subSamples; i += stride) weights[i] += w;
+    }
+
+    int factor_ = 1;
+    int maxFactor_ = MAX_FACTOR;
+    int previous_ = 1;
+    int fadeRemaining_ = 0;
+    bool snap_ = true;
+};
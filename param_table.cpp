@@ -0,0 +1,123 @@
+// synth/param_table.cpp
+#include "param_table.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using SynthParams::ParamID;
+constexpr ParamRate C = ParamRate::Control;
+constexpr ParamRate A = ParamRate::Audio;
+
+// Ranges match the clamps in the PolySynth and ReverbEffect setters, with a
+// practical limit where a setter has none. Envelope times are in seconds.
+constexpr ParamInfo PARAM_INFO[] = {
+    {ParamID::MasterTuneCents, -1200.0f, 1200.0f, 0.0f, C, false},
+    {ParamID::Osc1Waveform, 0.0f, 5.0f, 0.0f, C, true},
+    {ParamID::Osc2Waveform, 0.0f, 5.0f, 0.0f, C, true},
+    {ParamID::Osc1Level, 0.0f, 1.0f, 1.0f, A, false},
+    {ParamID::Osc2Level, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::NoiseLevel, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::RingModLevel, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::VCOBDetuneCents, -1200.0f, 1200.0f, 0.0f, A, false},
+    {ParamID::SyncEnabled, 0.0f, 1.0f, 0.0f, C, true},
+    {ParamID::VCOBLowFreqEnabled, 0.0f, 1.0f, 0.0f, C, true},
+    {ParamID::VCOBFreqKnob, 0.0f, 1.0f, 0.5f, A, false},
+    {ParamID::FilterEnvVelocitySensitivity, 0.0f, 1.0f, 0.0f, C, false},
+    {ParamID::AmpVelocitySensitivity, 0.0f, 1.0f, 0.0f, C, false},
+    {ParamID::PulseWidth, 0.01f, 0.99f, 0.5f, A, false},
+    {ParamID::PWMDepth, 0.0f, 1.0f, 0.0f, A, false},
+
+    {ParamID::XModOsc2ToOsc1FMAmount, -1.0f, 1.0f, 0.0f, A, false},
+    {ParamID::XModOsc1ToOsc2FMAmount, -1.0f, 1.0f, 0.0f, A, false},
+
+    {ParamID::PMFilterEnvToFreqAAmount, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::PMFilterEnvToPWAAmount, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::PMFilterEnvToFilterCutoffAmount, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::PMOscBToPWAAmount, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::PMOscBToFilterCutoffAmount, 0.0f, 1.0f, 0.0f, A, false},
+
+    {ParamID::FilterType, 0.0f, 4.0f, 0.0f, C, true},
+    {ParamID::VCFBaseCutoff, 20.0f, 20000.0f, 1000.0f, A, false},
+    {ParamID::VCFResonance, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::VCFKeyFollow, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::VCFEnvelopeAmount, -1.0f, 1.0f, 0.0f, A, false},
+
+    {ParamID::MixerDrive, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::MixerPostGain, 0.0f, 4.0f, 1.0f, A, false},
+
+    {ParamID::AmpEnvAttack, 0.0f, 10.0f, 0.01f, C, false},
+    {ParamID::AmpEnvDecay, 0.0f, 10.0f, 0.1f, C, false},
+    {ParamID::AmpEnvSustain, 0.0f, 1.0f, 0.9f, C, false},
+    {ParamID::AmpEnvRelease, 0.0f, 10.0f, 0.2f, C, false},
+    {ParamID::FilterEnvAttack, 0.0f, 10.0f, 0.01f, C, false},
+    {ParamID::FilterEnvDecay, 0.0f, 10.0f, 0.1f, C, false},
+    {ParamID::FilterEnvSustain, 0.0f, 1.0f, 0.7f, C, false},
+    {ParamID::FilterEnvRelease, 0.0f, 10.0f, 0.3f, C, false},
+
+    {ParamID::LfoRate, 0.01f, 50.0f, 1.0f, A, false},
+    {ParamID::LfoWaveform, 0.0f, 4.0f, 0.0f, C, true},
+    {ParamID::LfoAmountToVco1Freq, -24.0f, 24.0f, 0.0f, A, false},
+    {ParamID::LfoAmountToVco2Freq, -24.0f, 24.0f, 0.0f, A, false},
+    {ParamID::LfoAmountToVco1Pw, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::LfoAmountToVco2Pw, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::LfoAmountToVcfCutoff, -10000.0f, 10000.0f, 0.0f, A, false},
+
+    {ParamID::ModulationWheelValue, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::WheelModSource, 0.0f, 1.0f, 0.0f, C, true},
+    {ParamID::WheelModAmountToFreqA, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::WheelModAmountToFreqB, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::WheelModAmountToPWA, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::WheelModAmountToPWB, 0.0f, 1.0f, 0.0f, A, false},
+    {ParamID::WheelModAmountToFilter, 0.0f, 1.0f, 0.0f, A, false},
+
+    {ParamID::UnisonEnabled, 0.0f, 1.0f, 0.0f, C, true},
+    {ParamID::UnisonDetuneCents, 0.0f, 100.0f, 7.0f, A, false},
+    {ParamID::UnisonStereoSpread, 0.0f, 1.0f, 0.7f, A, false},
+
+    {ParamID::GlideEnabled, 0.0f, 1.0f, 0.0f, C, true},
+    {ParamID::GlideTime, 0.0f, 10.0f, 0.05f, C, false},
+
+    {ParamID::AnalogPitchDriftDepth, 0.0f, 100.0f, 0.0f, A, false},
+    {ParamID::AnalogPWDriftDepth, 0.0f, 0.45f, 0.0f, A, false},
+
+    {ParamID::ReverbEnabled, 0.0f, 1.0f, 1.0f, C, true},
+    {ParamID::ReverbDryWetMix, 0.0f, 1.0f, 0.3f, A, false},
+    {ParamID::ReverbRoomSize, 0.0f, 1.0f, 0.5f, A, false},
+    {ParamID::ReverbDamping, 0.0f, 1.0f, 0.5f, A, false},
+    {ParamID::ReverbWetGain, 0.0f, 2.0f, 1.0f, A, false},
+    {ParamID::ReverbRT60, 0.05f, 20.0f, 1.2f, A, false},
+};
+
+constexpr bool infoMatchesIds() {
+    for (int i = 0; i < ParamTable::NUM_PARAMS; ++i) {
+        if (static_cast<int>(PARAM_INFO[i].id) != i) return false;
+    }
+    return true;
+}
+
+static_assert(sizeof(PARAM_INFO) / sizeof(PARAM_INFO[0]) == ParamTable::NUM_PARAMS,
+              "every ParamID needs a PARAM_INFO entry");
+static_assert(infoMatchesIds(), "PARAM_INFO must be in ParamID order");
+
+} // namespace
+
+const ParamInfo& ParamTable::info(SynthParams::ParamID id) {
+    return PARAM_INFO[static_cast<int>(id)];
+}
+
+ParamTable::ParamTable() {
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        values_[i] = PARAM_INFO[i].defaultValue;
+    }
+}
+
+void ParamTable::set(SynthParams::ParamID id, float value) {
+    if (!isValid(id)) return;
+    const int index = static_cast<int>(id);
+    const ParamInfo& param = PARAM_INFO[index];
+    value = std::clamp(value, param.minValue, param.maxValue);
+    if (param.stepped) value = std::round(value);
+    values_[index] = value;
+    dirty_[index / 64] |= uint64_t{1} << (index % 64);
+}
@@ -0,0 +1,68 @@
+// synth/param_table.h
+#pragma once
+#include "synth_parameters.h"
+#include <cstdint>
+
+// Control-rate parameters take effect at discrete points (waveform, filter
+// type, switches, envelope times picked up per stage); audio-rate ones are
+// read every sample and can be automated densely.
+enum class ParamRate { Control, Audio };
+
+struct ParamInfo {
+    SynthParams::ParamID id;
+    float minValue;
+    float maxValue;
+    float defaultValue;
+    ParamRate rate;
+    bool stepped; // integer / enum / switch; values are rounded
+};
+
+// Every SynthParams::ParamID as one flat float array plus a dirty bit per
+// parameter. set() only records the value; the owner applies whatever is
+// dirty in one pass (see PolySynth::commitParams), so a burst of automation
+// costs one patch publish instead of one per change. Control thread only.
+class ParamTable {
+public:
+    static constexpr int NUM_PARAMS = static_cast<int>(SynthParams::ParamID::NumParameters);
+
+    static const ParamInfo& info(SynthParams::ParamID id);
+    static bool isValid(SynthParams::ParamID id) {
+        return static_cast<int>(id) >= 0 && static_cast<int>(id) < NUM_PARAMS;
+    }
+
+    ParamTable();
+
+    // Last value recorded through the table (the default until then).
+    float get(SynthParams::ParamID id) const { return values_[static_cast<int>(id)]; }
+    // Clamps to the parameter's range, rounds stepped parameters and marks
+    // the parameter dirty. Invalid ids are ignored.
+    void set(SynthParams::ParamID id, float value);
+
+    bool hasDirty() const {
+        for (uint64_t word : dirty_) {
+            if (word) return true;
+        }
+        return false;
+    }
+
+    // Calls fn(id, value) once for every dirty parameter, in id order, and
+    // clears the dirty bits.
+    template <typename Fn>
+    void consumeDirty(Fn&& fn) {
+        for (int w = 0; w < DIRTY_WORDS; ++w) {
+            uint64_t bits = dirty_[w];
+            dirty_[w] = 0;
+            while (bits) {
+                const int index = w * 64 + __builtin_ctzll(bits);
+                fn(static_cast<SynthParams::ParamID>(index), values_[index]);
+                bits &= bits - 1;
+            }
+        }
+    }
+
+private:
+    static constexpr int DIRTY_WORDS = (NUM_PARAMS + 63) / 64;
+
+    alignas(64) float values_[NUM_PARAMS];
+    uint64_t dirty_[DIRTY_WORDS] = {};
+};
@@ -0,0 +1,96 @@
+// synth/patch.h
+#pragma once
+#include "envelope.h"
+#include "lfo.h"
+#include "mod_matrix.h"
+#include "vcf.h"
+#include "waveform.h"
+
+enum class LfoDestination {
+  None = 0,
+  VCO1_Freq = 1,
+  VCO2_Freq = 2,
+  VCO1_PW = 3,
+  VCO2_PW = 4,
+  VCF_Cutoff = 5,
+  NumDestinations
+};
+
+enum class WheelModSource { LFO, NOISE };
+
+// Every sound-defining parameter of the synth. One instance is shared by all
+// voices for the duration of a block; voices only keep per-note DSP state.
+// Values are stored already clamped to their valid ranges by PolySynth.
+struct Patch {
+    // --- Per-voice (hot) parameters, read by Voice::process every sample ---
+    Waveform osc1Waveform = Waveform::Sine;
+    Waveform osc2Waveform = Waveform::Sine;
+    float osc1Level = 1.0f;
+    float osc2Level = 0.0f;
+    float noiseLevel = 0.0f;
+    float ringModLevel = 0.0f;
+
+    float pulseWidth = 0.5f;
+    float pwmDepth = 0.0f;
+
+    float vcoBDetuneCents = 0.0f;
+    bool vcoBLowFreqEnabled = false;
+    float vcoBFreqKnob = 0.5f;
+    bool vcoBKeyFollowEnabled = true;
+    bool syncEnabled = false;
+
+    float xmodOsc2ToOsc1FMAmount = 0.0f;
+    float xmodOsc1ToOsc2FMAmount = 0.0f;
+
+    float pmFilterEnvToFreqAAmount = 0.0f;
+    float pmFilterEnvToPWAAmount = 0.0f;
+    float pmFilterEnvToFilterCutoffAmount = 0.0f;
+    float pmOscBToPWAAmount = 0.0f;
+    float pmOscBToFilterCutoffAmount = 0.0f;
+
+    float mixerDrive = 0.0f;
+    float mixerPostGain = 1.0f;
+
+    VCFParams filter;
+
+    EnvelopeParams filterEnv = {0.01f, 0.1f, 0.7f, 0.3f};
+    EnvelopeParams ampEnv = {0.01f, 0.1f, 0.9f, 0.2f};
+    float filterEnvVelocitySensitivity = 0.0f;
+    float ampVelocitySensitivity = 0.0f;
+
+    float analogPitchDriftDepth = 0.0f;
+    float analogPWDriftDepth = 0.0f;
+
+    // --- Synth-wide parameters, read once per sample by PolySynth ---
+    float lfoRate = 1.0f;
+    LfoWaveform lfoWaveform = LfoWaveform::Triangle;
+    float lfoModAmounts[static_cast<int>(LfoDestination::NumDestinations)] = {};
+
+    WheelModSource wheelModSource = WheelModSource::LFO;
+    float wheelModToFreqAAmount = 0.0f;
+    float wheelModToFreqBAmount = 0.0f;
+    float wheelModToPWAAmount = 0.0f;
+    float wheelModToPWBAmount = 0.0f;
+    float wheelModToFilterAmount = 0.0f;
+
+    bool unisonEnabled = false;
+    int unisonVoices = 7; // oscillators stacked inside each voice
+    float unisonDetuneCents = 7.0f;
+    float unisonStereoSpread = 0.7f;
+
+    bool glideEnabled = false;
+    float glideTime = 0.05f;
+
+    float masterTuneCents = 0.0f;
+    float pitchBendRangeSemitones = 2.0f;
+
+    // --- Cold: only touched by the Additive waveform ---
+    float osc1Harmonics[NUM_OSC_HARMONICS] = {1.0f};
+    float osc2Harmonics[NUM_OSC_HARMONICS] = {1.0f};
+
+    // --- Cold: compiled into PolySynth's ModMatrix on patch change, on top
+    // of the LFO, wheel and poly-mod amounts above ---
+    ModRoute modRoutes[MAX_MOD_ROUTES];
+    int numModRoutes = 0;
+    LfoSettings extraLfos[NUM_LFOS - 1]; // LFOs 2..NUM_LFOS, sources only through modRoutes
+};
@@ -0,0 +1,82 @@
+// synth/phase_accumulator.h
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+#ifndef M_PI
+#define M_PI (3.14159265358979323846)
+#endif
+
+// One oscillator cycle mapped onto the full 32-bit range. Wraparound is the
+// natural unsigned overflow, so there is no fmod/floor in the sample loop and
+// the phase never loses precision however long the render runs.
+class PhaseAccumulator {
+public:
+    static constexpr double CYCLE = 4294967296.0; // 2^32
+
+    // Increment per sample for `freqHz`. Negative frequencies clamp to 0 and
+    // anything at or above the sample rate saturates just below one cycle.
+    static uint32_t incrementFor(double freqHz, double sampleRate) {
+        double inc = freqHz / sampleRate * CYCLE;
+        if (!(inc > 0.0)) return 0;
+        if (inc >= CYCLE - 1.0) return 0xFFFFFFFFu;
+        return static_cast<uint32_t>(inc);
+    }
+
+    // Float fast path for per-sample frequency modulation: precompute
+    // incrementPerHz() once per sample rate, then scale by the frequency.
+    static float incrementPerHz(double sampleRate) {
+        return static_cast<float>(CYCLE / sampleRate);
+    }
+    static uint32_t incrementFromHz(float freqHz, float incPerHz) {
+        float inc = freqHz * incPerHz;
+        if (!(inc > 0.0f)) return 0;
+        if (inc >= 4294967040.0f) return 0xFFFFFFFFu; // largest float below 2^32
+        return static_cast<uint32_t>(inc);
+    }
+
+    void reset() { phase_ = 0; }
+    void setIncrement(uint32_t inc) { increment_ = inc; }
+    uint32_t getIncrement() const { return increment_; }
+
+    uint32_t get() const { return phase_; }
+    void advance() { phase_ += increment_; }
+
+    // Phase in [0, 1). Only the top 24 bits are used so the conversion is
+    // exact and can never round up to 1.0f.
+    float normalized() const { return toUnit(phase_); }
+    static float toUnit(uint32_t phase) {
+        return static_cast<float>(phase >> 8) * (1.0f / 16777216.0f);
+    }
+
+private:
+    uint32_t phase_ = 0;
+    uint32_t increment_ = 0;
+};
+
+// Single-cycle sine shared by every oscillator and LFO. Indexed directly from
+// the top bits of a PhaseAccumulator phase, with linear interpolation on the
+// remaining bits (error below -110 dB).
+struct SineTable {
+    static constexpr int INDEX_BITS = 11;
+    static constexpr int SIZE = 1 << INDEX_BITS;
+    static constexpr int FRACTION_BITS = 32 - INDEX_BITS;
+
+    float values[SIZE + 1]; // +1 guard point so interpolation never wraps
+
+    SineTable() {
+        for (int i = 0; i <= SIZE; ++i) {
+            values[i] = static_cast<float>(std::sin(2.0 * M_PI * static_cast<double>(i) / SIZE));
+        }
+    }
+
+    float lookup(uint32_t phase) const {
+        uint32_t index = phase >> FRACTION_BITS;
+        float frac = static_cast<float>(phase & ((1u << FRACTION_BITS) - 1)) *
+                     (1.0f / static_cast<float>(1u << FRACTION_BITS));
+        float a = values[index];
+        return a + (values[index + 1] - a) * frac;
+    }
+};
+
+inline const SineTable SINE_TABLE;
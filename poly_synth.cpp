@@ -1,214 +1,367 @@
 // synth/poly_synth.cpp
 #include "poly_synth.h"
 #include "effects/audio_effect.h" 
+#include "effects/reverb_effect.h"
 #include "voice.h" 
 #include "waveform.h"
 #include "synth_parameters.h" 
+#include "random_seed.h"
+#include "rt_check.h"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 
-#ifndef M_PI_2
-#define M_PI_2 (1.57079632679489661923) 
-#endif
-
 
 PolySynth::PolySynth(int sr, int maxNumVoices)
-    : sampleRate(sr), maxVoices(maxNumVoices), lfo(sr), currentNoteTimestamp(0),
-      modulationWheelValue(0.0f), wheelModSource(WheelModSource::LFO),
-      wheelModToFreqAAmount(0.0f), wheelModToFreqBAmount(0.0f),
-      wheelModToPWAAmount(0.0f), wheelModToPWBAmount(0.0f),
-      wheelModToFilterAmount(0.0f),
-      wheelModNoiseGenerator(std::random_device{}()),
-      wheelModNoiseDistribution(-1.0f, 1.0f), unisonEnabled(false),
-      unisonDetuneCents(7.0f), unisonStereoSpread_(0.7f), 
-      lastUnisonNote(-1), lastUnisonVelocity(0.0f),
-      glideEnabled(false), glideTimeSetting(0.05f),
-      masterTuneCents(0.0f), 
-      analogPitchDriftDepth_(0.0f), 
-      analogPWDriftDepth_(0.0f),
-      pitchBendValue_(0.0f),        
-      pitchBendRangeSemitones_(2.0f) 
+    : sampleRate(sr), maxVoices(maxNumVoices), voiceBudget_(maxNumVoices), lfoBank_(static_cast<float>(sr), maxNumVoices), currentNoteTimestamp(0),
+      modulationWheelValue(0.0f),
+      wheelModNoiseGenerator(nextRandomSeed()),
+      wheelModNoiseDistribution(-1.0f, 1.0f),
+      pitchBendValue_(0.0f)
 {
+  auto constructionStart = std::chrono::steady_clock::now();
+
+  voices.reserve(maxVoices);
   for (int i = 0; i < maxVoices; ++i) {
-    voices.emplace_back(Voice(sampleRate, 16)); 
+    voices.emplace_back(sampleRate); 
   }
-  for (int i = 0; i < static_cast<int>(LfoDestination::NumDestinations); ++i) {
-    lfoModAmounts[i] = 0.0f;
-  }
-  
-  setAnalogPitchDriftDepth(analogPitchDriftDepth_);
-  setAnalogPWDriftDepth(analogPWDriftDepth_);
-}
-
+  additivePool_.reset(new AdditiveVoiceState[maxVoices]);
+  publishPatch();
+  voiceKernel_ = Voice::selectKernel(editPatch_);
+  attachAdditive(voiceKernel_.additive);
+
+  footprint_.bytesPerVoice = sizeof(Voice);
+  footprint_.numVoices = maxVoices;
+  footprint_.voicePoolBytes = sizeof(Voice) * voices.capacity();
+  footprint_.additivePoolBytes = sizeof(AdditiveVoiceState) * maxVoices;
+  footprint_.patchBytes = sizeof(Patch) * 7;
+  footprint_.constructionMicros = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - constructionStart).count();
+}
+
+// Note events arrive on the control thread, so they read the control-side
+// patch; that way a setter immediately followed by a note behaves as expected.
+// While an event source drives the sound they read its patch instead.
 void PolySynth::noteOn(int midiNote, float velocity) {
+  const Patch *notePatch = &editPatch_;
+  if (notePatchRendered_.load(std::memory_order_acquire)) {
+    notePatches_.update();
+    notePatch = &notePatches_.readBuffer();
+  }
+  const Patch &patch = *notePatch;
   
   float tunedFreq =
       440.0f * std::pow(2.0f, ((static_cast<float>(midiNote) - 69.0f) * 100.0f +
-                               masterTuneCents) /
+                               patch.masterTuneCents) /
                                   1200.0f);
 
-  if (unisonEnabled) {
-    lastUnisonNote = midiNote;
-    lastUnisonVelocity = velocity;
-    
-    int numUnisonVoicesToUse = voices.size(); 
+  // Unison is stacked inside a single voice, so notes allocate normally.
+  Voice *voice = findFreeVoice();
+  if (voice) {
+    voice->setPanning(0.0f); 
+    voice->setNoteOnTimestamp(currentNoteTimestamp++);
+    voice->noteOn(patch, tunedFreq, velocity, midiNote);
+  }
+}
+
+void PolySynth::noteOff(int midiNote) {
+  for (auto &voice : voices) {
+    if (voice.isActive() && voice.getNoteNumber() == midiNote) {
+      voice.noteOff();
+    }
+  }
+}
+
+void PolySynth::publishPatch() {
+  if (committingParams_) return;
+  patches_.writeBuffer() = editPatch_;
+  patches_.publish();
+  notePatchRendered_.store(false, std::memory_order_relaxed);
+}
 
-    for (int i = 0; i < numUnisonVoicesToUse; ++i) {
-      float detuneFactor = 0.0f;
-      float panFactor = 0.0f;
+// Presets are validated without knowing the sample rate.
+void PolySynth::clampToSampleRate(Patch &patch) const {
+  patch.filter.baseCutoffHz = std::min(patch.filter.baseCutoffHz, static_cast<float>(sampleRate) * 0.49f);
+}
 
-      if (numUnisonVoicesToUse > 1) {
-        detuneFactor = (static_cast<float>(i) / static_cast<float>(numUnisonVoicesToUse - 1) - 0.5f) * 2.0f;
-        panFactor = detuneFactor; 
-      }
-      
-      if (numUnisonVoicesToUse % 2 == 1 && i == numUnisonVoicesToUse / 2) {
-          detuneFactor = 0.0f;
-          panFactor = 0.0f;
-      }
+void PolySynth::setPatch(const Patch &patch) {
+  editPatch_ = patch;
+  clampToSampleRate(editPatch_);
+  publishPatch();
+}
 
-      float detunedFreq = tunedFreq * std::pow(2.0f, (unisonDetuneCents * detuneFactor) / 1200.0f);
-      float panValue = panFactor * unisonStereoSpread_;
-      
-      voices[i].setPanning(std::clamp(panValue, -1.0f, 1.0f));
-      voices[i].setNoteOnTimestamp(currentNoteTimestamp); 
-      voices[i].noteOn(detunedFreq, velocity, midiNote, glideEnabled, glideTimeSetting);
-    }
-    currentNoteTimestamp++; 
-  } else {
-    Voice *voice = findFreeVoice();
-    if (voice) {
-      voice->setPanning(0.0f); 
-      voice->setNoteOnTimestamp(currentNoteTimestamp++);
-      voice->noteOn(tunedFreq, velocity, midiNote, glideEnabled, glideTimeSetting);
-    }
+// The reader owns patches_.readBuffer() between updates, so the patch is
+// rendered from there. A publish made before this call is taken first so it
+// cannot replace the patch at the next update; later ones do.
+void PolySynth::setRenderedPatch(const Patch &patch) {
+  patches_.update();
+  Patch &rendered = patches_.readBuffer();
+  rendered = patch;
+  clampToSampleRate(rendered);
+  onPatchChanged(rendered);
+  notePatches_.writeBuffer() = rendered;
+  notePatches_.publish();
+  notePatchRendered_.store(true, std::memory_order_release);
+}
+
+void PolySynth::setParams(const SynthParams::ParamID *ids, const float *values, int count) {
+  for (int i = 0; i < count; ++i) {
+    params_.set(ids[i], values[i]);
   }
 }
 
-void PolySynth::noteOff(int midiNote) {
-  if (unisonEnabled) {
-    if (midiNote == lastUnisonNote) { 
-      for (auto &voice : voices) {
-        if (voice.isActive() && voice.getNoteNumber() == lastUnisonNote) {
-          voice.noteOff();
-        }
-      }
-      lastUnisonNote = -1; 
-      lastUnisonVelocity = 0.0f;
-    }
-  } else {
-    for (auto &voice : voices) {
-      if (voice.isActive() && voice.getNoteNumber() == midiNote) {
-        voice.noteOff();
-      }
-    }
+void PolySynth::commitParams() {
+  if (!params_.hasDirty()) return;
+  committingParams_ = true;
+  params_.consumeDirty([this](SynthParams::ParamID id, float value) { applyParam(id, value); });
+  committingParams_ = false;
+  publishPatch();
+}
+
+void PolySynth::applyParam(SynthParams::ParamID id, float value) {
+  using SynthParams::ParamID;
+  const int stepped = static_cast<int>(value);
+  ReverbEffect *reverb = dynamic_cast<ReverbEffect *>(getEffect(0)); // reverb is the first effect
+  switch (id) {
+    case ParamID::MasterTuneCents:    setMasterTuneCents(value); break;
+    case ParamID::Osc1Waveform:       setOsc1Waveform(static_cast<Waveform>(stepped)); break;
+    case ParamID::Osc2Waveform:       setOsc2Waveform(static_cast<Waveform>(stepped)); break;
+    case ParamID::Osc1Level:          setOsc1Level(value); break;
+    case ParamID::Osc2Level:          setOsc2Level(value); break;
+    case ParamID::NoiseLevel:         setNoiseLevel(value); break;
+    case ParamID::RingModLevel:       setRingModLevel(value); break;
+    case ParamID::VCOBDetuneCents:    setVCOBDetuneCents(value); break;
+    case ParamID::SyncEnabled:        setSyncEnabled(stepped != 0); break;
+    case ParamID::VCOBLowFreqEnabled: setVCOBLowFreqEnabled(stepped != 0); break;
+    case ParamID::VCOBFreqKnob:       setVCOBFreqKnob(value); break;
+    case ParamID::FilterEnvVelocitySensitivity: setFilterEnvVelocitySensitivity(value); break;
+    case ParamID::AmpVelocitySensitivity: setAmpVelocitySensitivity(value); break;
+    case ParamID::PulseWidth:         setPulseWidth(value); break;
+    case ParamID::PWMDepth:           setPWMDepth(value); break;
+    case ParamID::XModOsc2ToOsc1FMAmount: setXModOsc2ToOsc1FMAmount(value); break;
+    case ParamID::XModOsc1ToOsc2FMAmount: setXModOsc1ToOsc2FMAmount(value); break;
+    case ParamID::PMFilterEnvToFreqAAmount: setPMFilterEnvToFreqAAmount(value); break;
+    case ParamID::PMFilterEnvToPWAAmount: setPMFilterEnvToPWAAmount(value); break;
+    case ParamID::PMFilterEnvToFilterCutoffAmount: setPMFilterEnvToFilterCutoffAmount(value); break;
+    case ParamID::PMOscBToPWAAmount:  setPMOscBToPWAAmount(value); break;
+    case ParamID::PMOscBToFilterCutoffAmount: setPMOscBToFilterCutoffAmount(value); break;
+    case ParamID::FilterType:         setFilterType(static_cast<SynthParams::FilterType>(stepped)); break;
+    case ParamID::VCFBaseCutoff:      setVCFBaseCutoff(value); break;
+    case ParamID::VCFResonance:       setVCFResonance(value); break;
+    case ParamID::VCFKeyFollow:       setVCFKeyFollow(value); break;
+    case ParamID::VCFEnvelopeAmount:  setVCFEnvelopeAmount(value); break;
+    case ParamID::MixerDrive:         setMixerDrive(value); break;
+    case ParamID::MixerPostGain:      setMixerPostGain(value); break;
+    case ParamID::AmpEnvAttack:       editPatch_.ampEnv.attack = value; publishPatch(); break;
+    case ParamID::AmpEnvDecay:        editPatch_.ampEnv.decay = value; publishPatch(); break;
+    case ParamID::AmpEnvSustain:      editPatch_.ampEnv.sustain = value; publishPatch(); break;
+    case ParamID::AmpEnvRelease:      editPatch_.ampEnv.release = value; publishPatch(); break;
+    case ParamID::FilterEnvAttack:    editPatch_.filterEnv.attack = value; publishPatch(); break;
+    case ParamID::FilterEnvDecay:     editPatch_.filterEnv.decay = value; publishPatch(); break;
+    case ParamID::FilterEnvSustain:   editPatch_.filterEnv.sustain = value; publishPatch(); break;
+    case ParamID::FilterEnvRelease:   editPatch_.filterEnv.release = value; publishPatch(); break;
+    case ParamID::LfoRate:            setLfoRate(value); break;
+    case ParamID::LfoWaveform:        setLfoWaveform(static_cast<LfoWaveform>(stepped)); break;
+    case ParamID::LfoAmountToVco1Freq: setLfoAmountToVco1Freq(value); break;
+    case ParamID::LfoAmountToVco2Freq: setLfoAmountToVco2Freq(value); break;
+    case ParamID::LfoAmountToVco1Pw:  setLfoAmountToVco1Pw(value); break;
+    case ParamID::LfoAmountToVco2Pw:  setLfoAmountToVco2Pw(value); break;
+    case ParamID::LfoAmountToVcfCutoff: setLfoAmountToVcfCutoff(value); break;
+    case ParamID::ModulationWheelValue: setModulationWheelValue(value); break;
+    case ParamID::WheelModSource:     setWheelModSource(static_cast<WheelModSource>(stepped)); break;
+    case ParamID::WheelModAmountToFreqA: setWheelModAmountToFreqA(value); break;
+    case ParamID::WheelModAmountToFreqB: setWheelModAmountToFreqB(value); break;
+    case ParamID::WheelModAmountToPWA: setWheelModAmountToPWA(value); break;
+    case ParamID::WheelModAmountToPWB: setWheelModAmountToPWB(value); break;
+    case ParamID::WheelModAmountToFilter: setWheelModAmountToFilter(value); break;
+    case ParamID::UnisonEnabled:      setUnisonEnabled(stepped != 0); break;
+    case ParamID::UnisonDetuneCents:  setUnisonDetuneCents(value); break;
+    case ParamID::UnisonStereoSpread: setUnisonStereoSpread(value); break;
+    case ParamID::GlideEnabled:       setGlideEnabled(stepped != 0); break;
+    case ParamID::GlideTime:          setGlideTime(value); break;
+    case ParamID::AnalogPitchDriftDepth: setAnalogPitchDriftDepth(value); break;
+    case ParamID::AnalogPWDriftDepth: setAnalogPWDriftDepth(value); break;
+    case ParamID::ReverbEnabled:      if (reverb) reverb->setEnabled(stepped != 0); break;
+    case ParamID::ReverbDryWetMix:    if (reverb) reverb->setDryWetMix(value); break;
+    case ParamID::ReverbRoomSize:     if (reverb) reverb->setRoomSize(value); break;
+    case ParamID::ReverbDamping:      if (reverb) reverb->setDamping(value); break;
+    case ParamID::ReverbWetGain:      if (reverb) reverb->setWetGain(value); break;
+    case ParamID::ReverbRT60:         if (reverb) reverb->setRT60(value); break;
+    default: break;
   }
 }
 
+// Runs on the audio thread whenever a new patch has been picked up.
+void PolySynth::onPatchChanged(const Patch &patch) {
+  modMatrix_.compile(patch);
+  lfoBank_.configure(patch, modMatrix_.lfosInUse());
+  const VoiceKernel previous = voiceKernel_;
+  voiceKernel_ = Voice::selectKernel(patch);
+  attachAdditive(voiceKernel_.additive);
+  // Most publishes only move parameter values, which leave what a voice
+  // costs alone.
+  if (!voiceKernel_.sameWorkAs(previous)) voiceBudget_.restartEstimate();
+}
+
+void PolySynth::attachAdditive(bool attach) {
+  if (attach == additiveAttached_) return;
+  for (int i = 0; i < maxVoices; ++i) {
+    voices[i].attachAdditive(attach ? &additivePool_[i] : nullptr);
+  }
+  additiveAttached_ = attach;
+}
+
 StereoSample PolySynth::process() {
+  StereoSample sample = renderVoices();
+  applyEffects(sample.L, sample.R);
+  return sample;
+}
+
+StereoSample PolySynth::renderVoices() {
+  if (patches_.update()) {
+    onPatchChanged(patches_.readBuffer());
+  }
+  const Patch &patch = patches_.readBuffer();
+
   float mixedL = 0.0f;
   float mixedR = 0.0f;
   int activeVoiceCount = 0;
 
-  float lfoValue = lfo.step();
+  const LfoValues &lfos = lfoBank_.next();
 
   float wheelModNoiseValue = wheelModNoiseDistribution(wheelModNoiseGenerator);
-  float activeWheelModSourceValue = 0.0f;
-  if (wheelModSource == WheelModSource::LFO) {
-    activeWheelModSourceValue = lfoValue;
-  } else {
-    activeWheelModSourceValue = wheelModNoiseValue;
-  }
-
-  float wheel_mod_freqA_semitones = activeWheelModSourceValue *
-                                    modulationWheelValue *
-                                    wheelModToFreqAAmount * 12.0f;
-  float wheel_mod_freqB_semitones = activeWheelModSourceValue *
-                                    modulationWheelValue *
-                                    wheelModToFreqBAmount * 12.0f;
-  float wheel_mod_pwA_offset = activeWheelModSourceValue *
-                               modulationWheelValue * wheelModToPWAAmount *
-                               0.49f;
-  float wheel_mod_pwB_offset = activeWheelModSourceValue *
-                               modulationWheelValue * wheelModToPWBAmount *
-                               0.49f;
-  float wheel_mod_filter_hz_offset = activeWheelModSourceValue *
-                                     modulationWheelValue *
-                                     wheelModToFilterAmount * 2000.0f;
-
-  LfoModulationValues currentLfoModulations;
-  currentLfoModulations.osc1FreqMod =
-      lfoValue * lfoModAmounts[static_cast<int>(LfoDestination::VCO1_Freq)];
-  currentLfoModulations.osc2FreqMod =
-      lfoValue * lfoModAmounts[static_cast<int>(LfoDestination::VCO2_Freq)];
-  currentLfoModulations.osc1PwMod =
-      lfoValue * lfoModAmounts[static_cast<int>(LfoDestination::VCO1_PW)];
-  currentLfoModulations.osc2PwMod =
-      lfoValue * lfoModAmounts[static_cast<int>(LfoDestination::VCO2_PW)];
-  currentLfoModulations.vcfCutoffMod =
-      lfoValue * lfoModAmounts[static_cast<int>(LfoDestination::VCF_Cutoff)];
-
-  currentLfoModulations.osc1FreqMod += wheel_mod_freqA_semitones;
-  currentLfoModulations.osc2FreqMod += wheel_mod_freqB_semitones;
-  currentLfoModulations.wheelOsc1PwOffset = wheel_mod_pwA_offset;
-  currentLfoModulations.wheelOsc2PwOffset = wheel_mod_pwB_offset;
-  currentLfoModulations.vcfCutoffMod += wheel_mod_filter_hz_offset;
-
+  modMatrix_.setWheel(modulationWheelValue);
+  modMatrix_.evaluateGlobal(lfos, wheelModNoiseValue);
 
   for (int i = 0; i < voices.size(); ++i) {
     if (voices[i].isActive()) {
-      float monoVoiceOutput = voices[i].process(currentLfoModulations, pitchBendValue_, pitchBendRangeSemitones_);
-      
-      float pan = voices[i].getPanning(); 
-      float panAngle = (pan + 1.0f) * 0.5f * static_cast<float>(M_PI_2);
-      float gainL = std::cos(panAngle);
-      float gainR = std::sin(panAngle);
-
-      mixedL += monoVoiceOutput * gainL;
-      mixedR += monoVoiceOutput * gainR;
+      const LfoValues &voiceLfos =
+          lfoBank_.hasPerVoice() ? lfoBank_.voiceValues(i, voices[i].getNoteOnTimestamp()) : lfos;
+      StereoSample voiceOutput = voices[i].process(patch, voiceKernel_, modMatrix_, voiceLfos, pitchBendValue_);
+      mixedL += voiceOutput.L;
+      mixedR += voiceOutput.R;
       activeVoiceCount++;
     }
   }
+  voiceSamplesInBlock_ += activeVoiceCount;
+  activeVoices_ = activeVoiceCount;
   
   StereoSample outputSample;
   if (activeVoiceCount == 0) {
     outputSample.L = 0.0f;
     outputSample.R = 0.0f;
   } else {
-    float normalizationFactor;
-    if (unisonEnabled) {
-        int numUnisonVoicesToUse = voices.size(); 
-        normalizationFactor = static_cast<float>(std::max(1, numUnisonVoicesToUse / 2)) * 1.5f; 
-        if (normalizationFactor < 1.0f) normalizationFactor = 1.0f;
-
-    } else {
-        normalizationFactor = static_cast<float>(std::max(1, maxVoices / 2));
-        if (normalizationFactor < 1.0f) normalizationFactor = 1.0f;
-    }
-    
+    float normalizationFactor = static_cast<float>(std::max(1, maxVoices / 2));
     outputSample.L = mixedL / normalizationFactor;
     outputSample.R = mixedR / normalizationFactor;
   }
+  return outputSample;
+}
 
-  
-  float effectedL = outputSample.L;
-  float effectedR = outputSample.R;
+void PolySynth::applyEffects(float &L, float &R) {
   for (const auto &effect : effectsChain) {
     if (effect && effect->isEnabled()) {
-      effect->processStereoSample(effectedL, effectedR, effectedL, effectedR);
+      effect->processStereoSample(L, R, L, R);
     }
   }
-  outputSample.L = effectedL;
-  outputSample.R = effectedR;
+}
 
-  return outputSample;
+void PolySynth::processBlock(float *interleavedStereo, int numFrames, BlockEventSource *events) {
+  renderBlock(interleavedStereo, interleavedStereo + 1, 2, numFrames, events);
 }
 
-Voice *PolySynth::findFreeVoice() {
+void PolySynth::processBlock(float *left, float *right, int numFrames, BlockEventSource *events) {
+  renderBlock(left, right, 1, numFrames, events);
+}
+
+void PolySynth::renderBlock(float *left, float *right, int stride, int numFrames, BlockEventSource *events) {
+  RtCheck::RenderScope rtCheckScope;
+  const auto start = std::chrono::steady_clock::now();
+  voiceSamplesInBlock_ = 0;
+  int nextEvent = events ? events->dispatch(0) : numFrames;
+  if (effectsPipeline_ && effectsPipeline_->accepts(numFrames)) {
+    float *dry = effectsPipeline_->beginBlock(numFrames);
+    for (int i = 0; i < numFrames; ++i) {
+      if (i >= nextEvent) nextEvent = events->dispatch(i);
+      StereoSample sample = renderVoices();
+      dry[2 * i] = sample.L;
+      dry[2 * i + 1] = sample.R;
+    }
+    effectsPipeline_->endBlock(left, right, stride, numFrames);
+  } else {
+    for (int i = 0; i < numFrames; ++i) {
+      if (i >= nextEvent) nextEvent = events->dispatch(i);
+      StereoSample sample = process();
+      left[stride * i] = sample.L;
+      right[stride * i] = sample.R;
+    }
+  }
+  const double renderSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const double blockSeconds = static_cast<double>(numFrames) / sampleRate;
+  if (numFrames > 0) {
+    blockVoices_ = static_cast<double>(voiceSamplesInBlock_) / numFrames;
+    voiceBudget_.onBlock(renderSeconds, blockSeconds, blockVoices_);
+  }
+  if (quality_.onBlock(renderSeconds, blockSeconds)) {
+    applyQualityTier(quality_.getTier());
+  }
+}
+
+void PolySynth::applyQualityTier(int tier) {
+  const QualitySettings &settings = QualityGovernor::settingsFor(tier);
   for (auto &voice : voices) {
-    if (voice.isTrulyIdle()) {
-      return &voice;
+    voice.setQuality(settings);
+  }
+  if (effectsPipeline_) {
+    effectsTier_.store(tier, std::memory_order_relaxed);
+  } else {
+    for (const auto &effect : effectsChain) {
+      if (effect) effect->setQualityTier(tier);
+    }
+  }
+  voiceBudget_.restartEstimate();
+}
+
+// Runs on the pipeline worker.
+void PolySynth::processEffectsBlock(float *interleavedStereo, int numFrames) {
+  const int tier = effectsTier_.load(std::memory_order_relaxed);
+  if (tier != appliedEffectsTier_) {
+    for (const auto &effect : effectsChain) {
+      if (effect) effect->setQualityTier(tier);
+    }
+    appliedEffectsTier_ = tier;
+  }
+  for (int i = 0; i < numFrames; ++i) {
+    applyEffects(interleavedStereo[2 * i], interleavedStereo[2 * i + 1]);
+  }
+}
+
+bool PolySynth::setPipelinedEffects(bool enabled, int maxBlockFrames, const RealtimeConfig &workerConfig) {
+  effectsPipeline_.reset();
+  if (!enabled) return true;
+  effectsTier_.store(quality_.getTier(), std::memory_order_relaxed);
+  appliedEffectsTier_ = quality_.getTier();
+  effectsPipeline_ = std::make_unique<EffectsPipeline>(
+      [this](float *interleavedStereo, int numFrames) { processEffectsBlock(interleavedStereo, numFrames); },
+      maxBlockFrames, workerConfig);
+  return effectsPipeline_->start();
+}
+
+// Past the voice cap (the synth's own or the host's) an idle voice is not used
+// even if one is free; the new note steals instead, so the number of sounding
+// voices stays within budget.
+Voice *PolySynth::findFreeVoice() {
+  int sounding = 0;
+  for (const auto &voice : voices) {
+    if (voice.isActive()) ++sounding;
+  }
+  if (sounding < std::min(voiceBudget_.getCap(), hostVoiceCap_.load(std::memory_order_relaxed))) {
+    for (auto &voice : voices) {
+      if (voice.isTrulyIdle()) {
+        return &voice;
+      }
     }
   }
 
@@ -232,7 +385,7 @@ Voice *PolySynth::findFreeVoice() {
   unsigned long long oldestTimestamp = currentNoteTimestamp; 
 
   for (auto &voice : voices) {
-      if (voice.getNoteOnTimestamp() < oldestTimestamp) {
+      if (voice.isActive() && voice.getNoteOnTimestamp() < oldestTimestamp) {
           oldestTimestamp = voice.getNoteOnTimestamp();
           oldestSustainingVoice = &voice;
       }
@@ -254,147 +407,157 @@ Voice *PolySynth::findVoiceForNote(int midiNote) {
 }
 
 void PolySynth::setOsc1Waveform(Waveform wf) {
-  for (auto &voice : voices)
-    voice.setOsc1Waveform(wf);
+  editPatch_.osc1Waveform = wf;
+  publishPatch();
 }
 void PolySynth::setOsc2Waveform(Waveform wf) {
-  for (auto &voice : voices)
-    voice.setOsc2Waveform(wf);
+  editPatch_.osc2Waveform = wf;
+  publishPatch();
 }
 void PolySynth::setNoiseLevel(float level) {
-  for (auto &voice : voices)
-    voice.setNoiseLevel(level);
+  editPatch_.noiseLevel = std::clamp(level, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setRingModLevel(float level) {
-  for (auto &voice : voices)
-    voice.setRingModLevel(level);
+  editPatch_.ringModLevel = std::clamp(level, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setOsc1Level(float level) {
-  for (auto &voice : voices)
-    voice.setOsc1Level(level);
+  editPatch_.osc1Level = std::clamp(level, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setOsc2Level(float level) {
-  for (auto &voice : voices)
-    voice.setOsc2Level(level);
+  editPatch_.osc2Level = std::clamp(level, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setVCOBDetuneCents(float cents) {
-  for (auto &voice : voices)
-    voice.setVCOBDetuneCents(cents);
+  editPatch_.vcoBDetuneCents = cents;
+  publishPatch();
 }
 void PolySynth::setVCOBLowFreqEnabled(bool enabled) {
-  for (auto &voice : voices)
-    voice.setVCOBLowFreqEnabled(enabled);
+  editPatch_.vcoBLowFreqEnabled = enabled;
+  publishPatch();
 }
 void PolySynth::setVCOBFreqKnob(float value) {
-  for (auto &voice : voices)
-    voice.setVCOBFreqKnob(value);
+  editPatch_.vcoBFreqKnob = std::clamp(value, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setVCOBKeyFollowEnabled(bool enabled) {
-  for (auto &voice : voices)
-    voice.setVCOBKeyFollowEnabled(enabled);
+  editPatch_.vcoBKeyFollowEnabled = enabled;
+  publishPatch();
 }
 void PolySynth::setFilterEnvVelocitySensitivity(float amount) {
-  for (auto &voice : voices)
-    voice.setFilterEnvVelocitySensitivity(amount);
+  editPatch_.filterEnvVelocitySensitivity = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 
 void PolySynth::setAmpVelocitySensitivity(float amount) {
-  for (auto &voice : voices)
-    voice.setAmpVelocitySensitivity(amount);
+  editPatch_.ampVelocitySensitivity = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 
 void PolySynth::setSyncEnabled(bool enabled) {
-  for (auto &voice : voices)
-    voice.setSyncEnabled(enabled);
+  editPatch_.syncEnabled = enabled;
+  publishPatch();
 }
 
 void PolySynth::setXModOsc2ToOsc1FMAmount(float amount) {
-    for (auto &voice : voices)
-        voice.setXModOsc2ToOsc1FMAmount(amount);
+  editPatch_.xmodOsc2ToOsc1FMAmount = std::clamp(amount, -1.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setXModOsc1ToOsc2FMAmount(float amount) {
-    for (auto &voice : voices)
-        voice.setXModOsc1ToOsc2FMAmount(amount);
+  editPatch_.xmodOsc1ToOsc2FMAmount = std::clamp(amount, -1.0f, 1.0f);
+  publishPatch();
 }
 
 void PolySynth::setPMFilterEnvToFreqAAmount(float amount) {
-  for (auto &voice : voices)
-    voice.setPMFilterEnvToFreqAAmount(amount);
+  editPatch_.pmFilterEnvToFreqAAmount = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setPMFilterEnvToPWAAmount(float amount) {
-  for (auto &voice : voices)
-    voice.setPMFilterEnvToPWAAmount(amount);
+  editPatch_.pmFilterEnvToPWAAmount = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setPMFilterEnvToFilterCutoffAmount(float amount) {
-  for (auto &voice : voices)
-    voice.setPMFilterEnvToFilterCutoffAmount(amount);
+  editPatch_.pmFilterEnvToFilterCutoffAmount = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setPMOscBToPWAAmount(float amount) {
-  for (auto &voice : voices)
-    voice.setPMOscBToPWAAmount(amount);
+  editPatch_.pmOscBToPWAAmount = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setPMOscBToFilterCutoffAmount(float amount) {
-  for (auto &voice : voices)
-    voice.setPMOscBToFilterCutoffAmount(amount);
+  editPatch_.pmOscBToFilterCutoffAmount = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 
 void PolySynth::setFilterType(SynthParams::FilterType type) {
-    for (auto &voice : voices) {
-        voice.setFilterType(type);
-    }
+  editPatch_.filter.type = type;
+  publishPatch();
 }
 void PolySynth::setVCFBaseCutoff(float hz) {
-  for (auto &voice : voices)
-    voice.setVCFBaseCutoff(hz);
+  editPatch_.filter.baseCutoffHz = std::clamp(hz, 20.0f, static_cast<float>(sampleRate) * 0.49f);
+  publishPatch();
 }
 void PolySynth::setVCFResonance(float q) {
-  for (auto &voice : voices)
-    voice.setVCFResonance(q);
+  editPatch_.filter.resonance = std::clamp(q, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setVCFKeyFollow(float f) {
-  for (auto &voice : voices)
-    voice.setVCFKeyFollow(f);
+  editPatch_.filter.keyFollow = std::clamp(f, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setVCFEnvelopeAmount(float amt) {
-  for (auto &voice : voices)
-    voice.setVCFEnvelopeAmount(amt);
+  editPatch_.filter.envModAmount = std::clamp(amt, -1.0f, 1.0f);
+  publishPatch();
 }
 
 
 void PolySynth::setAmpEnvelope(const EnvelopeParams &p) {
-  for (auto &voice : voices)
-    voice.setAmpEnvelope(p);
+  editPatch_.ampEnv = p;
+  publishPatch();
 }
 void PolySynth::setFilterEnvelope(const EnvelopeParams &p) {
-  for (auto &voice : voices)
-    voice.setFilterEnvelope(p);
+  editPatch_.filterEnv = p;
+  publishPatch();
 }
 void PolySynth::setPulseWidth(float width) {
-  for (auto &voice : voices)
-    voice.setPulseWidth(width);
+  editPatch_.pulseWidth = std::clamp(width, 0.01f, 0.99f);
+  publishPatch();
 }
 void PolySynth::setPWMDepth(float depth) {
-  for (auto &voice : voices)
-    voice.setPWMDepth(depth);
+  editPatch_.pwmDepth = std::clamp(depth, 0.0f, 1.0f);
+  publishPatch();
+}
+void PolySynth::setLfoRate(float rateHz) {
+  editPatch_.lfoRate = std::max(0.01f, rateHz);
+  publishPatch();
+}
+void PolySynth::setLfoWaveform(LfoWaveform wf) {
+  editPatch_.lfoWaveform = wf;
+  publishPatch();
 }
-void PolySynth::setLfoRate(float rateHz) { lfo.setRate(rateHz); }
-void PolySynth::setLfoWaveform(LfoWaveform wf) { lfo.setWaveform(wf); }
 void PolySynth::setLfoAmountToVco1Freq(float semitones) {
-  lfoModAmounts[static_cast<int>(LfoDestination::VCO1_Freq)] = semitones;
+  editPatch_.lfoModAmounts[static_cast<int>(LfoDestination::VCO1_Freq)] = semitones;
+  publishPatch();
 }
 void PolySynth::setLfoAmountToVco2Freq(float semitones) {
-  lfoModAmounts[static_cast<int>(LfoDestination::VCO2_Freq)] = semitones;
+  editPatch_.lfoModAmounts[static_cast<int>(LfoDestination::VCO2_Freq)] = semitones;
+  publishPatch();
 }
 void PolySynth::setLfoAmountToVco1Pw(float normalizedAmount) {
-  lfoModAmounts[static_cast<int>(LfoDestination::VCO1_PW)] =
+  editPatch_.lfoModAmounts[static_cast<int>(LfoDestination::VCO1_PW)] =
       std::clamp(normalizedAmount, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setLfoAmountToVco2Pw(float normalizedAmount) {
-  lfoModAmounts[static_cast<int>(LfoDestination::VCO2_PW)] =
+  editPatch_.lfoModAmounts[static_cast<int>(LfoDestination::VCO2_PW)] =
       std::clamp(normalizedAmount, 0.0f, 1.0f);
+  publishPatch();
 }
 void PolySynth::setLfoAmountToVcfCutoff(float hzOffset) {
-  lfoModAmounts[static_cast<int>(LfoDestination::VCF_Cutoff)] = hzOffset;
+  editPatch_.lfoModAmounts[static_cast<int>(LfoDestination::VCF_Cutoff)] = hzOffset;
+  publishPatch();
 }
 
 
@@ -403,58 +566,69 @@ void PolySynth::setModulationWheelValue(float value) {
 }
 
 void PolySynth::setWheelModSource(WheelModSource source) {
-  wheelModSource = source;
+  editPatch_.wheelModSource = source;
+  publishPatch();
 }
 
 void PolySynth::setWheelModAmountToFreqA(float amount) {
-  wheelModToFreqAAmount = std::clamp(amount, 0.0f, 1.0f);
+  editPatch_.wheelModToFreqAAmount = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 
 void PolySynth::setWheelModAmountToFreqB(float amount) {
-  wheelModToFreqBAmount = std::clamp(amount, 0.0f, 1.0f);
+  editPatch_.wheelModToFreqBAmount = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 
 void PolySynth::setWheelModAmountToPWA(float amount) {
-  wheelModToPWAAmount = std::clamp(amount, 0.0f, 1.0f);
+  editPatch_.wheelModToPWAAmount = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 
 void PolySynth::setWheelModAmountToPWB(float amount) {
-  wheelModToPWBAmount = std::clamp(amount, 0.0f, 1.0f);
+  editPatch_.wheelModToPWBAmount = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 
 void PolySynth::setWheelModAmountToFilter(float amount) {
-  wheelModToFilterAmount = std::clamp(amount, 0.0f, 1.0f);
+  editPatch_.wheelModToFilterAmount = std::clamp(amount, 0.0f, 1.0f);
+  publishPatch();
 }
 
 void PolySynth::setUnisonEnabled(bool enabled) {
-  if (unisonEnabled && !enabled) { 
-    for (auto &voice : voices) {
-        if (voice.isActive()) {
-             voice.setPanning(0.0f);
-        }
-    }
-    lastUnisonNote = -1; 
-  }
-  unisonEnabled = enabled;
+  editPatch_.unisonEnabled = enabled;
+  publishPatch();
+}
+
+void PolySynth::setUnisonVoices(int count) {
+  editPatch_.unisonVoices = std::clamp(count, 1, UnisonLayout::MAX_MEMBERS);
+  publishPatch();
 }
 
 void PolySynth::setUnisonDetuneCents(float cents) {
-  unisonDetuneCents = std::max(0.0f, cents);
+  editPatch_.unisonDetuneCents = std::max(0.0f, cents);
+  publishPatch();
 }
 
 void PolySynth::setUnisonStereoSpread(float spread) {
-    unisonStereoSpread_ = std::clamp(spread, 0.0f, 1.0f);
+  editPatch_.unisonStereoSpread = std::clamp(spread, 0.0f, 1.0f);
+  publishPatch();
 }
 
 
-void PolySynth::setGlideEnabled(bool enabled) { glideEnabled = enabled; }
+void PolySynth::setGlideEnabled(bool enabled) {
+  editPatch_.glideEnabled = enabled;
+  publishPatch();
+}
 
 void PolySynth::setGlideTime(float timeSeconds) {
-  glideTimeSetting = std::max(0.0f, timeSeconds);
+  editPatch_.glideTime = std::max(0.0f, timeSeconds);
+  publishPatch();
 }
 
 void PolySynth::setMasterTuneCents(float cents) {
-  masterTuneCents = cents;
+  editPatch_.masterTuneCents = cents;
+  publishPatch();
 }
 
 void PolySynth::setPitchBend(float value) {
@@ -462,10 +636,12 @@ void PolySynth::setPitchBend(float value) {
 }
 
 void PolySynth::setPitchBendRange(float semitones) {
-    pitchBendRangeSemitones_ = std::max(0.0f, semitones); 
+  editPatch_.pitchBendRangeSemitones = std::max(0.0f, semitones); 
+  publishPatch();
 }
 
 void PolySynth::addEffect(std::unique_ptr<AudioEffect> effect) {
+  if (effect) effect->setQualityTier(quality_.getTier());
   effectsChain.push_back(std::move(effect));
 }
 
@@ -480,42 +656,91 @@ AudioEffect* PolySynth::getEffect(size_t index) {
 
 
 void PolySynth::setAnalogPitchDriftDepth(float cents) {
-    analogPitchDriftDepth_ = std::max(0.0f, cents); 
-    for (auto& voice : voices) {
-        voice.setPitchDriftDepth(analogPitchDriftDepth_);
-    }
+  editPatch_.analogPitchDriftDepth = std::max(0.0f, cents); 
+  publishPatch();
 }
 
 void PolySynth::setAnalogPWDriftDepth(float depth) {
-    analogPWDriftDepth_ = std::clamp(depth, 0.0f, 0.45f); 
-    for (auto& voice : voices) {
-        voice.setPWDriftDepth(analogPWDriftDepth_);
-    }
+  editPatch_.analogPWDriftDepth = std::clamp(depth, 0.0f, 0.45f); 
+  publishPatch();
 }
 
 void PolySynth::setOscHarmonicAmplitude(int oscNum, int harmonicIndex, float amplitude) {
-    if (harmonicIndex < 0 || harmonicIndex >= 16) { 
+    if (harmonicIndex < 0 || harmonicIndex >= NUM_OSC_HARMONICS) { 
         std::cerr << "PolySynth::setOscHarmonicAmplitude: Harmonic index " << harmonicIndex << " out of range." << std::endl;
         return;
     }
 
-    for (auto& voice : voices) {
-        if (oscNum == 1) {
-            voice.setOsc1HarmonicAmplitude(harmonicIndex, amplitude);
-        } else if (oscNum == 2) {
-            voice.setOsc2HarmonicAmplitude(harmonicIndex, amplitude);
+    float clampedAmplitude = std::clamp(amplitude, 0.0f, 1.0f);
+    if (oscNum == 1) {
+        editPatch_.osc1Harmonics[harmonicIndex] = clampedAmplitude;
+    } else if (oscNum == 2) {
+        editPatch_.osc2Harmonics[harmonicIndex] = clampedAmplitude;
+    } else {
+        return;
+    }
+    publishPatch();
+}
+
+void PolySynth::setOscHarmonics(int oscNum, const float* amplitudes, int count) {
+    float* harmonics = nullptr;
+    if (oscNum == 1) {
+        harmonics = editPatch_.osc1Harmonics;
+    } else if (oscNum == 2) {
+        harmonics = editPatch_.osc2Harmonics;
+    } else {
+        return;
+    }
+    if (count > NUM_OSC_HARMONICS) {
+        std::cerr << "PolySynth::setOscHarmonics: " << count << " harmonics given, only the first "
+                  << NUM_OSC_HARMONICS << " are used." << std::endl;
+    }
+    count = std::clamp(count, 0, NUM_OSC_HARMONICS);
+    for (int i = 0; i < NUM_OSC_HARMONICS; ++i) {
+        harmonics[i] = (i < count && amplitudes) ? std::clamp(amplitudes[i], 0.0f, 1.0f) : 0.0f;
+    }
+    publishPatch();
+}
+
+void PolySynth::setModRoutes(const ModRoute* routes, int count) {
+    if (count > MAX_MOD_ROUTES) {
+        std::cerr << "PolySynth::setModRoutes: " << count << " routes given, only the first "
+                  << MAX_MOD_ROUTES << " are used." << std::endl;
+    }
+    count = routes ? std::clamp(count, 0, MAX_MOD_ROUTES) : 0;
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        const ModRoute& route = routes[i];
+        if (static_cast<int>(route.source) < 0 || route.source >= ModSource::NumSources ||
+            static_cast<int>(route.destination) < 0 || route.destination >= ModDestination::NumDestinations) {
+            continue;
         }
+        const float maxAmount = modDestinationInfo(route.destination).maxAmount;
+        ModRoute& stored = editPatch_.modRoutes[kept++];
+        stored = route;
+        stored.amount = std::clamp(route.amount, -maxAmount, maxAmount);
+    }
+    for (int i = kept; i < MAX_MOD_ROUTES; ++i) {
+        editPatch_.modRoutes[i] = ModRoute();
     }
+    editPatch_.numModRoutes = kept;
+    publishPatch();
+}
+
+void PolySynth::setLfoSettings(int lfoNum, const LfoSettings& settings) {
+    if (lfoNum < 2 || lfoNum > NUM_LFOS) return;
+    LfoSettings& lfo = editPatch_.extraLfos[lfoNum - 2];
+    lfo = settings;
+    lfo.rate = std::max(0.01f, settings.rate);
+    publishPatch();
 }
 
 void PolySynth::setMixerDrive(float drive) {
-    for (auto& voice : voices) {
-        voice.setMixerDrive(drive);
-    }
+  editPatch_.mixerDrive = std::clamp(drive, 0.0f, 1.0f);
+  publishPatch();
 }
 
 void PolySynth::setMixerPostGain(float gain) {
-    for (auto& voice : voices) {
-        voice.setMixerPostGain(gain);
-    }
-}
\ No newline at end of file
+  editPatch_.mixerPostGain = std::max(0.0f, gain); 
+  publishPatch();
+}
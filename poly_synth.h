@@ -5,27 +5,40 @@
 #include "voice.h" 
 #include "waveform.h" 
 #include "synth_parameters.h" 
+#include "patch.h"
+#include "mod_matrix.h"
+#include "param_table.h"
+#include "triple_buffer.h"
+#include "stereo_sample.h"
+#include "quality_governor.h"
+#include "voice_budget.h"
+#include "effects_pipeline.h"
+#include <atomic>
+#include <climits>
 #include <memory>     
 #include <vector>
 #include <utility> 
 
-enum class LfoDestination {
-  None = 0,
-  VCO1_Freq = 1,
-  VCO2_Freq = 2,
-  VCO1_PW = 3,
-  VCO2_PW = 4,
-  VCF_Cutoff = 5,
-  NumDestinations 
-};
-
-enum class WheelModSource { LFO, NOISE };
-
 class AudioEffect; 
 
-struct StereoSample {
-    float L = 0.0f;
-    float R = 0.0f;
+// Timestamped events for one block of processBlock(). dispatch(frame) is
+// called on the audio thread before frame `frame` renders; it applies every
+// event due at or before that frame and returns the frame of the next one
+// (the block length or more when none is left).
+class BlockEventSource {
+public:
+  virtual ~BlockEventSource() = default;
+  virtual int dispatch(int frame) = 0;
+};
+
+// Memory/startup cost of one synth instance, for sizing render farms.
+struct SynthFootprint {
+    size_t bytesPerVoice = 0;
+    int numVoices = 0;
+    size_t voicePoolBytes = 0;
+    size_t additivePoolBytes = 0; // AdditiveVoiceState per voice, outside the voices
+    size_t patchBytes = 0;      // control copy plus the published and note-side slots
+    double constructionMicros = 0.0;
 };
 
 class PolySynth {
@@ -34,6 +47,15 @@ public:
   void noteOn(int midiNote, float velocity);
   void noteOff(int midiNote);
   StereoSample process(); 
+  // Renders a block of interleaved stereo frames and times it against the
+  // block's duration to drive the quality governor. Audio callbacks should
+  // use this rather than calling process() per frame. With an event source,
+  // events are applied at their frame within the block; the audio thread then
+  // acts as the control thread, so do not call the setters from elsewhere at
+  // the same time.
+  void processBlock(float* interleavedStereo, int numFrames, BlockEventSource* events = nullptr);
+  // Planar variant.
+  void processBlock(float* left, float* right, int numFrames, BlockEventSource* events = nullptr);
 
   void setOsc1Waveform(Waveform wf);
   void setOsc2Waveform(Waveform wf);
@@ -85,7 +107,16 @@ public:
   void setWheelModAmountToPWB(float amount);    
   void setWheelModAmountToFilter(float amount); 
 
+  // Replaces the patch's modulation matrix routes (see ModMatrix) with one
+  // publish. Routes past MAX_MOD_ROUTES are dropped, amounts are clamped to
+  // the destination's range.
+  void setModRoutes(const ModRoute* routes, int count);
+  // LFOs 2..NUM_LFOS (LFO 1 is setLfoRate/setLfoWaveform). They only act
+  // through mod routes with the matching source.
+  void setLfoSettings(int lfoNum, const LfoSettings& settings);
+
   void setUnisonEnabled(bool enabled);
+  void setUnisonVoices(int count); // oscillators stacked per note, 1..8
   void setUnisonDetuneCents(float cents);
   void setUnisonStereoSpread(float spread); 
 
@@ -101,55 +132,134 @@ public:
   void clearEffects();
   AudioEffect* getEffect(size_t index); // To get reverb for parameter setting
 
+  // Runs the effects chain on a worker thread one block behind the voices
+  // (see EffectsPipeline), for one block of extra latency. Blocks larger than
+  // maxBlockFrames are still processed serially. Like addEffect(), call this
+  // while audio is stopped. Returns false if the worker could not be given
+  // its real-time configuration; it runs regardless.
+  bool setPipelinedEffects(bool enabled, int maxBlockFrames = 4096,
+                           const RealtimeConfig &workerConfig = RealtimeConfig());
+  const EffectsPipeline* getEffectsPipeline() const { return effectsPipeline_.get(); }
+
 
   void setAnalogPitchDriftDepth(float cents); 
   void setAnalogPWDriftDepth(float depth);    
 
   void setOscHarmonicAmplitude(int oscNum, int harmonicIndex, float amplitude); 
+  // Replaces the whole harmonic table of an oscillator with one publish;
+  // harmonics past `count` are silenced.
+  void setOscHarmonics(int oscNum, const float* amplitudes, int count);
 
   void setMixerDrive(float drive);
   void setMixerPostGain(float gain);
   int getSampleRate() const { return sampleRate; }
+  int getMaxVoices() const { return maxVoices; }
+
+  // Replaces the whole patch in one step. Like the individual setters this is
+  // meant to be called from a single control thread; the audio thread picks
+  // the new patch up at its next process() call.
+  void setPatch(const Patch& patch);
+  const Patch& getPatch() const { return editPatch_; }
+
+  // For event sources that own the sound while they run (PresetMorph,
+  // PresetWatcher): renders `patch` from the next sample on without touching
+  // the control-side patch, and hands it to noteOn() for the notes that
+  // follow. Audio thread, from BlockEventSource::dispatch(). The next patch
+  // the control thread publishes takes over again.
+  void setRenderedPatch(const Patch& patch);
+
+  // Parameters by id (see ParamTable). setParam()/setParams() only record
+  // values; commitParams() applies everything recorded since the last commit
+  // through the setters above and publishes a single patch.
+  void setParam(SynthParams::ParamID id, float value) { params_.set(id, value); }
+  void setParams(const SynthParams::ParamID* ids, const float* values, int count);
+  void commitParams();
+  const ParamTable& getParams() const { return params_; }
+
+  const SynthFootprint& getFootprint() const { return footprint_; }
+
+  // CPU-load-adaptive quality (see QualityGovernor). Off by default; real-time
+  // hosts turn it on. setQualityTier() forces a tier, which adaptation then
+  // continues from.
+  void setAdaptiveQuality(bool enabled) { quality_.setAdaptive(enabled); }
+  void setQualityTier(int tier) { quality_.requestTier(tier); }
+  const QualityGovernor& getQualityGovernor() const { return quality_; }
+
+  // Dynamic polyphony limit (see VoiceBudget). Notes past the cap steal the
+  // quietest releasing voice, then the oldest one. 0, the default, means no
+  // cap; real-time hosts set a budget such as VoiceBudget::LIVE_BUDGET.
+  void setVoiceBudget(float loadFraction) { voiceBudget_.setBudget(loadFraction); }
+  const VoiceBudget& getVoiceBudget() const { return voiceBudget_; }
+
+  // For hosts that adapt several synths together (see GroupGovernor): a cap
+  // on sounding voices on top of the synth's own budget, and the average
+  // number of voices the last block rendered and how many were still
+  // sounding at its end. The getters are for the audio thread between blocks.
+  void setHostVoiceCap(int cap) { hostVoiceCap_.store(cap, std::memory_order_relaxed); }
+  double getBlockVoices() const { return blockVoices_; }
+  int getActiveVoices() const { return activeVoices_; }
   
 private:
   std::vector<Voice> voices;
   int sampleRate;
   int maxVoices;
 
-  LFO lfo; 
-
-  float lfoModAmounts[static_cast<int>(LfoDestination::NumDestinations)];
+  // Control-thread copy that the setters modify; publishPatch() hands a
+  // snapshot of it to the audio thread, which renders from patches_.readBuffer().
+  Patch editPatch_;
+  TripleBuffer<Patch> patches_;
+  // setRenderedPatch()'s patch on its way back to noteOn(), which reads it
+  // instead of editPatch_ while notePatchRendered_ is set.
+  TripleBuffer<Patch> notePatches_;
+  std::atomic<bool> notePatchRendered_{false};
+  void clampToSampleRate(Patch& patch) const;
+  VoiceKernel voiceKernel_;
+  // One AdditiveVoiceState per voice, reserved up front so attaching never
+  // allocates on the audio thread; only attached while voiceKernel_.additive.
+  std::unique_ptr<AdditiveVoiceState[]> additivePool_;
+  bool additiveAttached_ = false;
+  void attachAdditive(bool attach);
+
+  void publishPatch();
+  void onPatchChanged(const Patch& patch);
+
+  ParamTable params_;
+  bool committingParams_ = false; // publishPatch() waits for the end of the commit
+  void applyParam(SynthParams::ParamID id, float value);
+
+  SynthFootprint footprint_;
+
+  QualityGovernor quality_;
+  void applyQualityTier(int tier);
+
+  VoiceBudget voiceBudget_;
+  long voiceSamplesInBlock_ = 0;
+  double blockVoices_ = 0.0;
+  int activeVoices_ = 0;
+  std::atomic<int> hostVoiceCap_{INT_MAX};
+
+  LfoBank lfoBank_;
+  ModMatrix modMatrix_;
 
   float modulationWheelValue = 0.0f;
-  WheelModSource wheelModSource = WheelModSource::LFO;
-  float wheelModToFreqAAmount = 0.0f;
-  float wheelModToFreqBAmount = 0.0f;
-  float wheelModToPWAAmount = 0.0f;
-  float wheelModToPWBAmount = 0.0f;
-  float wheelModToFilterAmount = 0.0f;
 
   std::default_random_engine wheelModNoiseGenerator;
   std::uniform_real_distribution<float> wheelModNoiseDistribution;
 
-  bool unisonEnabled = false;
-  float unisonDetuneCents = 7.0f;
-  float unisonStereoSpread_ = 0.5f; 
-  int lastUnisonNote = -1;
-  float lastUnisonVelocity = 0.0f;
-
-  bool glideEnabled = false;
-  float glideTimeSetting = 0.05f;
-
-  float analogPitchDriftDepth_; 
-  float analogPWDriftDepth_;   
-
-  float masterTuneCents = 0.0f; 
-
   float pitchBendValue_; 
-  float pitchBendRangeSemitones_; 
 
   std::vector<std::unique_ptr<AudioEffect>> effectsChain;
 
+  void renderBlock(float *left, float *right, int stride, int numFrames, BlockEventSource *events);
+  StereoSample renderVoices();
+  void applyEffects(float &L, float &R);
+
+  std::unique_ptr<EffectsPipeline> effectsPipeline_;
+  // With the pipeline on, tier changes reach the effects on the worker.
+  std::atomic<int> effectsTier_{0};
+  int appliedEffectsTier_ = 0; // worker only
+  void processEffectsBlock(float *interleavedStereo, int numFrames);
+
   unsigned long long currentNoteTimestamp = 0;
 
   Voice *findFreeVoice();
@@ -1,22 +1,15 @@
 #include "polysynth_c_api.h"
 #include "poly_synth.h" 
+#include "synth_engine.h"
 #include "waveform.h"   
 #include "envelope.h"   
 #include "synth_parameters.h" 
 #include "lfo.h" 
 #include "effects/reverb_effect.h" // For casting to ReverbEffect
+#include <climits>
 
-
-LfoWaveform map_ps_lfo_waveform_to_cpp(PS_LfoWaveform wf_c) {
-    switch (wf_c) {
-        case PS_LFO_WAVEFORM_TRIANGLE:   return LfoWaveform::Triangle;
-        case PS_LFO_WAVEFORM_SAW_UP:     return LfoWaveform::SawUp;
-        case PS_LFO_WAVEFORM_SQUARE:     return LfoWaveform::Square;
-        case PS_LFO_WAVEFORM_SINE:       return LfoWaveform::Sine;
-        case PS_LFO_WAVEFORM_RANDOM_STEP:return LfoWaveform::RandomStep;
-        default:                         return LfoWaveform::Triangle;
-    }
-}
+static_assert(PS_MAX_OSC_HARMONICS == NUM_OSC_HARMONICS, "C API harmonic count out of sync");
+static_assert(PS_QUALITY_TIERS == QualityGovernor::NUM_TIERS, "C API quality tiers out of sync");
 
 
 Waveform map_ps_waveform_to_cpp(PS_Waveform wf_c) {
@@ -44,13 +37,67 @@ SynthParams::FilterType map_ps_filter_type_to_cpp(SynthParams::PS_FilterType typ
 }
 
 
+// C_ParamID has an extra C_PARAM_WAVEFORM (an alias for the first
+// oscillator's waveform) ahead of the ParamID order; past it the ids are off
+// by one. Unknown ids map to NumParameters, which the table ignores.
 SynthParams::ParamID map_c_param_id_to_cpp(SynthParams::C_ParamID c_id) {
-    if (static_cast<int>(c_id) >= 0 && static_cast<int>(c_id) < static_cast<int>(SynthParams::ParamID::NumParameters)) {
-         return static_cast<SynthParams::ParamID>(c_id);
-    }
-    return SynthParams::ParamID::MasterTuneCents; 
+    const int id = static_cast<int>(c_id);
+    if (id < 0 || id >= SynthParams::C_PARAM_NUM_PARAMETERS) return SynthParams::ParamID::NumParameters;
+    if (id <= SynthParams::C_PARAM_WAVEFORM) return static_cast<SynthParams::ParamID>(id);
+    return static_cast<SynthParams::ParamID>(id - 1);
 }
 
+static_assert(SynthParams::C_PARAM_WAVEFORM == static_cast<int>(SynthParams::ParamID::Osc1Waveform),
+              "C_ParamID and ParamID out of sync");
+static_assert(SynthParams::C_PARAM_NUM_PARAMETERS - 1 == static_cast<int>(SynthParams::ParamID::NumParameters),
+              "C_ParamID and ParamID out of sync");
+static_assert(SynthParams::C_PARAM_REVERB_RT60 - 1 == static_cast<int>(SynthParams::ParamID::ReverbRT60),
+              "C_ParamID and ParamID out of sync");
+// Int parameters are passed through the table as the enum's value.
+static_assert(PS_WAVEFORM_ADDITIVE == static_cast<int>(Waveform::Additive), "PS_Waveform out of sync");
+static_assert(PS_LFO_WAVEFORM_RANDOM_STEP == static_cast<int>(LfoWaveform::RandomStep), "PS_LfoWaveform out of sync");
+static_assert(SynthParams::PS_FILTER_TYPE_NOTCH == static_cast<int>(SynthParams::FilterType::NOTCH), "PS_FilterType out of sync");
+
+
+static void fillQualityStatus(const QualityGovernor& governor, PS_QualityStatus* out_status) {
+    out_status->tier = governor.getTier();
+    out_status->adaptive = governor.isAdaptive() ? 1 : 0;
+    out_status->transitions = governor.getTransitions();
+    out_status->load = governor.getLoad();
+    out_status->peak_load = governor.getPeakLoad();
+}
+
+static void fillVoiceBudgetStatus(const VoiceBudget& budget, PS_VoiceBudgetStatus* out_status) {
+    out_status->voice_cap = budget.getCap();
+    out_status->budget = budget.getBudget();
+    out_status->voice_load = budget.getVoiceLoad();
+}
+
+
+// Feeds a PS_Event array to PolySynth::processBlock().
+class CEventSource : public BlockEventSource {
+public:
+    CEventSource(PolySynthHandle handle, const PS_Event* events, int numEvents)
+        : handle_(handle), events_(events), numEvents_(events ? numEvents : 0) {}
+
+    // Parameter events due at the same frame are committed together.
+    int dispatch(int frame) override {
+        while (next_ < numEvents_ && events_[next_].frame <= frame) {
+            apply(events_[next_++]);
+        }
+        static_cast<PolySynth*>(handle_)->commitParams();
+        return next_ < numEvents_ ? events_[next_].frame : INT_MAX;
+    }
+
+private:
+    void apply(const PS_Event& event);
+
+    PolySynthHandle handle_;
+    const PS_Event* events_;
+    int numEvents_;
+    int next_ = 0;
+};
+
 
 extern "C" {
 
@@ -65,11 +112,107 @@ void ps_destroy_synth(PolySynthHandle handle) {
 void ps_process_audio(PolySynthHandle handle, float* output_buffer, int num_frames) {
     if (!handle || !output_buffer) return;
     PolySynth* synth = static_cast<PolySynth*>(handle);
-    for (int i = 0; i < num_frames; ++i) {
-        StereoSample sample = synth->process();
-        output_buffer[2 * i] = sample.L;
-        output_buffer[2 * i + 1] = sample.R;
-    }
+    synth->commitParams();
+    synth->processBlock(output_buffer, num_frames);
+}
+
+void ps_process_block(PolySynthHandle handle, const PS_Event* events, int num_events,
+                      float** outputs, int num_frames) {
+    if (!handle || !outputs || !outputs[0] || !outputs[1]) return;
+    CEventSource source(handle, events, num_events);
+    static_cast<PolySynth*>(handle)->processBlock(outputs[0], outputs[1], num_frames, &source);
+    source.dispatch(INT_MAX);
+}
+
+void ps_get_footprint(PolySynthHandle handle, PS_Footprint* out_footprint) {
+    if (!handle || !out_footprint) return;
+    const SynthFootprint& fp = static_cast<PolySynth*>(handle)->getFootprint();
+    out_footprint->bytes_per_voice = static_cast<int>(fp.bytesPerVoice);
+    out_footprint->num_voices = fp.numVoices;
+    out_footprint->voice_pool_bytes = static_cast<int>(fp.voicePoolBytes + fp.additivePoolBytes);
+    out_footprint->patch_bytes = static_cast<int>(fp.patchBytes);
+    out_footprint->construction_us = fp.constructionMicros;
+}
+
+void ps_get_quality_status(PolySynthHandle handle, PS_QualityStatus* out_status) {
+    if (!handle || !out_status) return;
+    fillQualityStatus(static_cast<PolySynth*>(handle)->getQualityGovernor(), out_status);
+}
+
+void ps_set_adaptive_quality(PolySynthHandle handle, int enabled) {
+    if (!handle) return;
+    static_cast<PolySynth*>(handle)->setAdaptiveQuality(enabled != 0);
+}
+
+void ps_set_quality_tier(PolySynthHandle handle, int tier) {
+    if (!handle) return;
+    static_cast<PolySynth*>(handle)->setQualityTier(tier);
+}
+
+void ps_get_voice_budget_status(PolySynthHandle handle, PS_VoiceBudgetStatus* out_status) {
+    if (!handle || !out_status) return;
+    fillVoiceBudgetStatus(static_cast<PolySynth*>(handle)->getVoiceBudget(), out_status);
+}
+
+void ps_set_voice_budget(PolySynthHandle handle, float budget) {
+    if (!handle) return;
+    static_cast<PolySynth*>(handle)->setVoiceBudget(budget);
+}
+
+PS_EngineHandle ps_engine_create(int num_workers, int max_block_frames, int rt_priority, int first_cpu) {
+    RealtimeConfig config;
+    config.priority = rt_priority;
+    config.cpu = first_cpu;
+    return new SynthEngine(num_workers, max_block_frames, config);
+}
+
+void ps_engine_destroy(PS_EngineHandle engine) {
+    delete static_cast<SynthEngine*>(engine);
+}
+
+int ps_engine_add_instance(PS_EngineHandle engine, PolySynthHandle handle) {
+    if (!engine) return -1;
+    return static_cast<SynthEngine*>(engine)->addInstance(static_cast<PolySynth*>(handle));
+}
+
+void ps_engine_remove_instance(PS_EngineHandle engine, PolySynthHandle handle) {
+    if (!engine) return;
+    static_cast<SynthEngine*>(engine)->removeInstance(static_cast<PolySynth*>(handle));
+}
+
+int ps_engine_num_instances(PS_EngineHandle engine) {
+    if (!engine) return 0;
+    return static_cast<SynthEngine*>(engine)->getNumInstances();
+}
+
+int ps_engine_process(PS_EngineHandle engine, int num_frames) {
+    if (!engine) return 0;
+    return static_cast<SynthEngine*>(engine)->process(num_frames);
+}
+
+const float* ps_engine_get_output(PS_EngineHandle engine, int slot, int channel) {
+    if (!engine) return nullptr;
+    return static_cast<SynthEngine*>(engine)->getOutput(slot, channel);
+}
+
+void ps_engine_get_quality_status(PS_EngineHandle engine, PS_QualityStatus* out_status) {
+    if (!engine || !out_status) return;
+    fillQualityStatus(static_cast<SynthEngine*>(engine)->getQualityGovernor(), out_status);
+}
+
+void ps_engine_set_adaptive_quality(PS_EngineHandle engine, int enabled) {
+    if (!engine) return;
+    static_cast<SynthEngine*>(engine)->setAdaptiveQuality(enabled != 0);
+}
+
+void ps_engine_get_voice_budget_status(PS_EngineHandle engine, PS_VoiceBudgetStatus* out_status) {
+    if (!engine || !out_status) return;
+    fillVoiceBudgetStatus(static_cast<SynthEngine*>(engine)->getVoiceBudget(), out_status);
+}
+
+void ps_engine_set_voice_budget(PS_EngineHandle engine, float budget) {
+    if (!engine) return;
+    static_cast<SynthEngine*>(engine)->setVoiceBudget(budget);
 }
 
 void ps_note_on(PolySynthHandle handle, int midi_note, float velocity) {
@@ -84,145 +227,36 @@ void ps_note_off(PolySynthHandle handle, int midi_note) {
 
 void ps_set_float_param(PolySynthHandle handle, SynthParams::C_ParamID param_id_c, float value) {
     if (!handle) return;
+    static_cast<PolySynth*>(handle)->setParam(map_c_param_id_to_cpp(param_id_c), value);
+}
+
+void ps_set_int_param(PolySynthHandle handle, SynthParams::C_ParamID param_id_c, int value) {
+    ps_set_float_param(handle, param_id_c, static_cast<float>(value));
+}
+
+void ps_set_params(PolySynthHandle handle, const SynthParams::C_ParamID* param_ids, const float* values, int count) {
+    if (!handle || !param_ids || !values) return;
     PolySynth* synth = static_cast<PolySynth*>(handle);
-    SynthParams::ParamID param_id_cpp = map_c_param_id_to_cpp(param_id_c);
-
-    switch (param_id_cpp) {
-        case SynthParams::ParamID::MasterTuneCents:    synth->setMasterTuneCents(value); break;
-        case SynthParams::ParamID::Osc1Level:          synth->setOsc1Level(value); break;
-        case SynthParams::ParamID::Osc2Level:          synth->setOsc2Level(value); break;
-        case SynthParams::ParamID::NoiseLevel:         synth->setNoiseLevel(value); break;
-        case SynthParams::ParamID::RingModLevel:       synth->setRingModLevel(value); break;
-        case SynthParams::ParamID::VCOBDetuneCents:    synth->setVCOBDetuneCents(value); break;
-        case SynthParams::ParamID::VCOBFreqKnob:       synth->setVCOBFreqKnob(value); break;
-        case SynthParams::ParamID::FilterEnvVelocitySensitivity: synth->setFilterEnvVelocitySensitivity(value); break;
-        case SynthParams::ParamID::AmpVelocitySensitivity: synth->setAmpVelocitySensitivity(value); break;
-        case SynthParams::ParamID::PulseWidth:         synth->setPulseWidth(value); break;
-        case SynthParams::ParamID::PWMDepth:           synth->setPWMDepth(value); break;
-        case SynthParams::ParamID::XModOsc2ToOsc1FMAmount: synth->setXModOsc2ToOsc1FMAmount(value); break;
-        case SynthParams::ParamID::XModOsc1ToOsc2FMAmount: synth->setXModOsc1ToOsc2FMAmount(value); break;
-        case SynthParams::ParamID::PMFilterEnvToFreqAAmount: synth->setPMFilterEnvToFreqAAmount(value); break;
-        case SynthParams::ParamID::PMFilterEnvToPWAAmount: synth->setPMFilterEnvToPWAAmount(value); break;
-        case SynthParams::ParamID::PMFilterEnvToFilterCutoffAmount: synth->setPMFilterEnvToFilterCutoffAmount(value); break;
-        case SynthParams::ParamID::PMOscBToPWAAmount:  synth->setPMOscBToPWAAmount(value); break;
-        case SynthParams::ParamID::PMOscBToFilterCutoffAmount: synth->setPMOscBToFilterCutoffAmount(value); break;
-        case SynthParams::ParamID::VCFBaseCutoff:      synth->setVCFBaseCutoff(value); break;
-        case SynthParams::ParamID::VCFResonance:       synth->setVCFResonance(value); break;
-        case SynthParams::ParamID::VCFKeyFollow:       synth->setVCFKeyFollow(value); break;
-        case SynthParams::ParamID::VCFEnvelopeAmount:  synth->setVCFEnvelopeAmount(value); break;
-        case SynthParams::ParamID::MixerDrive:         synth->setMixerDrive(value); break;         
-        case SynthParams::ParamID::MixerPostGain:      synth->setMixerPostGain(value); break;      
-        case SynthParams::ParamID::AmpEnvAttack:       
-        case SynthParams::ParamID::AmpEnvDecay:        
-        case SynthParams::ParamID::AmpEnvSustain:
-        case SynthParams::ParamID::AmpEnvRelease:
-        case SynthParams::ParamID::FilterEnvAttack:    
-        case SynthParams::ParamID::FilterEnvDecay:     
-        case SynthParams::ParamID::FilterEnvSustain:
-        case SynthParams::ParamID::FilterEnvRelease:
-            break; 
-        case SynthParams::ParamID::LfoRate:            synth->setLfoRate(value); break;
-        case SynthParams::ParamID::LfoAmountToVco1Freq: synth->setLfoAmountToVco1Freq(value); break;
-        case SynthParams::ParamID::LfoAmountToVco2Freq: synth->setLfoAmountToVco2Freq(value); break;
-        case SynthParams::ParamID::LfoAmountToVco1Pw:  synth->setLfoAmountToVco1Pw(value); break;
-        case SynthParams::ParamID::LfoAmountToVco2Pw:  synth->setLfoAmountToVco2Pw(value); break;
-        case SynthParams::ParamID::LfoAmountToVcfCutoff: synth->setLfoAmountToVcfCutoff(value); break;
-        case SynthParams::ParamID::ModulationWheelValue: synth->setModulationWheelValue(value); break;
-        case SynthParams::ParamID::WheelModAmountToFreqA: synth->setWheelModAmountToFreqA(value); break;
-        case SynthParams::ParamID::WheelModAmountToFreqB: synth->setWheelModAmountToFreqB(value); break;
-        case SynthParams::ParamID::WheelModAmountToPWA: synth->setWheelModAmountToPWA(value); break;
-        case SynthParams::ParamID::WheelModAmountToPWB: synth->setWheelModAmountToPWB(value); break;
-        case SynthParams::ParamID::WheelModAmountToFilter: synth->setWheelModAmountToFilter(value); break;
-        case SynthParams::ParamID::UnisonDetuneCents:  synth->setUnisonDetuneCents(value); break;
-        case SynthParams::ParamID::UnisonStereoSpread: synth->setUnisonStereoSpread(value); break;
-        case SynthParams::ParamID::GlideTime:          synth->setGlideTime(value); break;
-        case SynthParams::ParamID::AnalogPitchDriftDepth: synth->setAnalogPitchDriftDepth(value); break;
-        case SynthParams::ParamID::AnalogPWDriftDepth: synth->setAnalogPWDriftDepth(value); break;
-        
-        // Reverb params (generic setter)
-        case SynthParams::ParamID::ReverbDryWetMix: {
-            AudioEffect* effect = synth->getEffect(0); // Assuming reverb is the first effect
-            if (ReverbEffect* reverb = dynamic_cast<ReverbEffect*>(effect)) {
-                reverb->setDryWetMix(value);
-            }
-            break;
-        }
-        case SynthParams::ParamID::ReverbRoomSize: {
-            AudioEffect* effect = synth->getEffect(0);
-            if (ReverbEffect* reverb = dynamic_cast<ReverbEffect*>(effect)) {
-                reverb->setRoomSize(value);
-            }
-            break;
-        }
-        case SynthParams::ParamID::ReverbDamping: {
-            AudioEffect* effect = synth->getEffect(0);
-            if (ReverbEffect* reverb = dynamic_cast<ReverbEffect*>(effect)) {
-                reverb->setDamping(value);
-            }
-            break;
-        }
-        case SynthParams::ParamID::ReverbWetGain: {
-            AudioEffect* effect = synth->getEffect(0);
-            if (ReverbEffect* reverb = dynamic_cast<ReverbEffect*>(effect)) {
-                reverb->setWetGain(value);
-            }
-            break;
-        }
-        case SynthParams::ParamID::ReverbRT60: {
-            AudioEffect* effect = synth->getEffect(0);
-            if (ReverbEffect* reverb = dynamic_cast<ReverbEffect*>(effect)) {
-                reverb->setRT60(value);
-            }
-            break;
-        }
-        default:
-            break;
+    for (int i = 0; i < count; ++i) {
+        synth->setParam(map_c_param_id_to_cpp(param_ids[i]), values[i]);
     }
 }
 
-void ps_set_int_param(PolySynthHandle handle, SynthParams::C_ParamID param_id_c, int value) {
+void ps_commit_params(PolySynthHandle handle) {
     if (!handle) return;
-    PolySynth* synth = static_cast<PolySynth*>(handle);
-    SynthParams::ParamID param_id_cpp = map_c_param_id_to_cpp(param_id_c);
+    static_cast<PolySynth*>(handle)->commitParams();
+}
 
-    switch (param_id_cpp) {
-        case SynthParams::ParamID::Osc1Waveform:
-            synth->setOsc1Waveform(map_ps_waveform_to_cpp(static_cast<PS_Waveform>(value)));
-            break;
-        case SynthParams::ParamID::Osc2Waveform:
-            synth->setOsc2Waveform(map_ps_waveform_to_cpp(static_cast<PS_Waveform>(value)));
-            break;
-        case SynthParams::ParamID::SyncEnabled:        
-            synth->setSyncEnabled(static_cast<bool>(value)); 
-            break;
-        case SynthParams::ParamID::VCOBLowFreqEnabled: 
-            synth->setVCOBLowFreqEnabled(static_cast<bool>(value)); 
-            break;
-        case SynthParams::ParamID::FilterType:     
-            synth->setFilterType(map_ps_filter_type_to_cpp(static_cast<SynthParams::PS_FilterType>(value))); 
-            break; 
-        case SynthParams::ParamID::LfoWaveform:
-            synth->setLfoWaveform(map_ps_lfo_waveform_to_cpp(static_cast<PS_LfoWaveform>(value)));
-            break;
-        case SynthParams::ParamID::WheelModSource: 
-            synth->setWheelModSource(static_cast<WheelModSource>(value));
-            break;
-        case SynthParams::ParamID::UnisonEnabled:
-            synth->setUnisonEnabled(static_cast<bool>(value));
-            break;
-        case SynthParams::ParamID::GlideEnabled:
-            synth->setGlideEnabled(static_cast<bool>(value));
-            break;
-        case SynthParams::ParamID::ReverbEnabled: {
-             AudioEffect* effect = synth->getEffect(0); // Assuming reverb is the first effect
-            if (effect) { // Check if effect exists
-                effect->setEnabled(static_cast<bool>(value));
-            }
-            break;
-        }
-        default:
-            break;
-    }
+int ps_get_param_info(SynthParams::C_ParamID param_id, PS_ParamInfo* out_info) {
+    const SynthParams::ParamID id = map_c_param_id_to_cpp(param_id);
+    if (!out_info || !ParamTable::isValid(id)) return 0;
+    const ParamInfo& info = ParamTable::info(id);
+    out_info->min_value = info.minValue;
+    out_info->max_value = info.maxValue;
+    out_info->default_value = info.defaultValue;
+    out_info->audio_rate = info.rate == ParamRate::Audio ? 1 : 0;
+    out_info->stepped = info.stepped ? 1 : 0;
+    return 1;
 }
 
 
@@ -312,6 +346,10 @@ void ps_set_unison_enabled(PolySynthHandle handle, int enabled) {
     if (!handle) return;
     static_cast<PolySynth*>(handle)->setUnisonEnabled(static_cast<bool>(enabled));
 }
+void ps_set_unison_voices(PolySynthHandle handle, int count) {
+    if (!handle) return;
+    static_cast<PolySynth*>(handle)->setUnisonVoices(count);
+}
 void ps_set_unison_detune_cents(PolySynthHandle handle, float cents) {
     if (!handle) return;
     static_cast<PolySynth*>(handle)->setUnisonDetuneCents(cents);
@@ -325,6 +363,10 @@ void ps_set_osc_harmonic_amplitude(PolySynthHandle handle, int osc_num, int harm
     if (!handle) return;
     static_cast<PolySynth*>(handle)->setOscHarmonicAmplitude(osc_num, harmonic_index, amplitude);
 }
+void ps_set_osc_harmonics(PolySynthHandle handle, int osc_num, const float* amplitudes, int count) {
+    if (!handle) return;
+    static_cast<PolySynth*>(handle)->setOscHarmonics(osc_num, amplitudes, count);
+}
 
 // Reverb specific C API
 void ps_reverb_set_enabled(PolySynthHandle handle, int effect_index, int enabled) {
@@ -382,4 +424,27 @@ void ps_reverb_set_rt60(PolySynthHandle handle, int effect_index, float rt60) {
 }
 
 
-} // extern "C"
\ No newline at end of file
+} // extern "C"
+
+
+void CEventSource::apply(const PS_Event& event) {
+    PolySynth* synth = static_cast<PolySynth*>(handle_);
+    switch (event.type) {
+        case PS_EVENT_NOTE_ON:
+            synth->commitParams(); // notes read the patch as of their frame
+            synth->noteOn(event.id, event.value);
+            break;
+        case PS_EVENT_NOTE_OFF:
+            synth->noteOff(event.id);
+            break;
+        case PS_EVENT_FLOAT_PARAM:
+        case PS_EVENT_INT_PARAM:
+            synth->setParam(map_c_param_id_to_cpp(static_cast<SynthParams::C_ParamID>(event.id)), event.value);
+            break;
+        case PS_EVENT_PITCH_BEND:
+            synth->setPitchBend(event.value);
+            break;
+        default:
+            break;
+    }
+}
\ No newline at end of file
@@ -9,6 +9,8 @@ extern "C" {
 
 typedef void* PolySynthHandle;
 
+#define PS_MAX_OSC_HARMONICS 256
+
 typedef enum {
     PS_WAVEFORM_SINE = 0,
     PS_WAVEFORM_SAW,
@@ -32,11 +34,119 @@ void ps_destroy_synth(PolySynthHandle handle);
 
 void ps_process_audio(PolySynthHandle handle, float* output_buffer, int num_frames);
 
+typedef enum {
+    PS_EVENT_NOTE_ON = 0,
+    PS_EVENT_NOTE_OFF,
+    PS_EVENT_FLOAT_PARAM,
+    PS_EVENT_INT_PARAM,
+    PS_EVENT_PITCH_BEND
+} PS_EventType;
+
+typedef struct {
+    int frame;         // offset into the block
+    PS_EventType type;
+    int id;            // MIDI note, or SynthParams::C_ParamID for parameter events
+    float value;       // velocity, parameter value or pitch bend in [-1, 1]
+} PS_Event;
+
+// Renders num_frames frames into the planar buffers outputs[0] (left) and
+// outputs[1] (right), applying each event at its frame. Events must be sorted
+// by frame; events at or past num_frames are applied after the block. Meant
+// for hosts that deliver every note and parameter change as events: the
+// setters below must not be called concurrently with it.
+void ps_process_block(PolySynthHandle handle, const PS_Event* events, int num_events,
+                      float** outputs, int num_frames);
+
+typedef struct {
+    int bytes_per_voice;
+    int num_voices;
+    int voice_pool_bytes;
+    int patch_bytes;
+    double construction_us;
+} PS_Footprint;
+void ps_get_footprint(PolySynthHandle handle, PS_Footprint* out_footprint);
+
+// CPU-load-adaptive quality. Tier 0 is full quality, PS_QUALITY_TIERS - 1 the
+// cheapest. Load is render time over block duration, as measured by
+// ps_process_audio. Adaptation is off until ps_set_adaptive_quality(h, 1).
+#define PS_QUALITY_TIERS 4
+typedef struct {
+    int tier;
+    int adaptive;
+    unsigned int transitions; // tier changes since creation
+    float load;               // smoothed
+    float peak_load;          // worst single block since creation
+} PS_QualityStatus;
+void ps_get_quality_status(PolySynthHandle handle, PS_QualityStatus* out_status);
+void ps_set_adaptive_quality(PolySynthHandle handle, int enabled);
+void ps_set_quality_tier(PolySynthHandle handle, int tier);
+
+// Dynamic polyphony limit. budget is the fraction of each block's duration the
+// synth may use, 0.7 being typical for live playback; 0, the default, means no
+// cap (voice_cap is then the whole pool). voice_load is the measured cost of
+// one voice with the current patch in the same units.
+typedef struct {
+    int voice_cap;
+    float budget;
+    float voice_load;
+} PS_VoiceBudgetStatus;
+void ps_get_voice_budget_status(PolySynthHandle handle, PS_VoiceBudgetStatus* out_status);
+void ps_set_voice_budget(PolySynthHandle handle, float budget);
+
+// Engine: renders many synth instances per block on a shared worker pool.
+// num_workers threads are started in addition to the thread calling
+// ps_engine_process; with rt_priority > 0 they run SCHED_FIFO, and with
+// first_cpu >= 0 worker i is pinned to core first_cpu + i. The engine does
+// not own its instances: remove an instance before destroying it, and do not
+// add or remove instances while ps_engine_process is running.
+typedef void* PS_EngineHandle;
+PS_EngineHandle ps_engine_create(int num_workers, int max_block_frames, int rt_priority, int first_cpu);
+void ps_engine_destroy(PS_EngineHandle engine);
+// Returns the instance's slot, or -1 if it is already registered or invalid.
+int ps_engine_add_instance(PS_EngineHandle engine, PolySynthHandle handle);
+// Slots above the removed instance move down by one.
+void ps_engine_remove_instance(PS_EngineHandle engine, PolySynthHandle handle);
+int ps_engine_num_instances(PS_EngineHandle engine);
+// Renders every instance for min(num_frames, max_block_frames) frames and
+// returns that count.
+int ps_engine_process(PS_EngineHandle engine, int num_frames);
+// Planar output of an instance from the last ps_engine_process (channel 0
+// left, 1 right), owned by the engine; NULL for a bad slot or channel.
+const float* ps_engine_get_output(PS_EngineHandle engine, int slot, int channel);
+// Adaptive quality and voice budget for all instances together, driven by the
+// time each ps_engine_process call takes; off by default like the
+// per-instance ones, which should stay off when these are used. voice_cap
+// and voice_load count the voices of all instances.
+void ps_engine_get_quality_status(PS_EngineHandle engine, PS_QualityStatus* out_status);
+void ps_engine_set_adaptive_quality(PS_EngineHandle engine, int enabled);
+void ps_engine_get_voice_budget_status(PS_EngineHandle engine, PS_VoiceBudgetStatus* out_status);
+void ps_engine_set_voice_budget(PS_EngineHandle engine, float budget);
+
 void ps_note_on(PolySynthHandle handle, int midi_note, float velocity);
 void ps_note_off(PolySynthHandle handle, int midi_note);
 
+// Parameter changes are only recorded here. Everything recorded since the
+// last block is applied together, with one patch update, at the start of the
+// next ps_process_audio, ps_process_block or, for an instance registered
+// with an engine, ps_engine_process call, so dense automation costs
+// one update per block rather than one per call. ps_commit_params applies
+// them right away, e.g. while audio is not running. As the commit happens on
+// the rendering thread, do not record parameters while a process call is
+// running on another thread.
 void ps_set_float_param(PolySynthHandle handle, SynthParams::C_ParamID param_id, float value);
 void ps_set_int_param(PolySynthHandle handle, SynthParams::C_ParamID param_id, int value); 
+void ps_set_params(PolySynthHandle handle, const SynthParams::C_ParamID* param_ids, const float* values, int count);
+void ps_commit_params(PolySynthHandle handle);
+
+typedef struct {
+    float min_value;
+    float max_value;
+    float default_value;
+    int audio_rate; // read every sample; otherwise picked up at notes or envelope stages
+    int stepped;    // integer, enum or switch; values are rounded
+} PS_ParamInfo;
+// Returns 0 for an unknown id.
+int ps_get_param_info(SynthParams::C_ParamID param_id, PS_ParamInfo* out_info);
 
 
 void ps_set_waveform_c(PolySynthHandle handle, PS_Waveform wf); 
@@ -66,10 +176,13 @@ void ps_set_amp_envelope(PolySynthHandle handle, PS_EnvelopeParams params);
 void ps_set_filter_envelope(PolySynthHandle handle, PS_EnvelopeParams params);
 
 void ps_set_unison_enabled(PolySynthHandle handle, int enabled); 
+void ps_set_unison_voices(PolySynthHandle handle, int count);
 void ps_set_unison_detune_cents(PolySynthHandle handle, float cents);
 void ps_set_unison_stereo_spread(PolySynthHandle handle, float spread);
 
 void ps_set_osc_harmonic_amplitude(PolySynthHandle handle, int osc_num, int harmonic_index, float amplitude);
+// Sets harmonics 1..count in one go (up to PS_MAX_OSC_HARMONICS), silencing the rest.
+void ps_set_osc_harmonics(PolySynthHandle handle, int osc_num, const float* amplitudes, int count);
 
 // Reverb specific C API (could also be part of ps_set_float_param with C_PARAM_REVERB_... IDs)
 void ps_reverb_set_enabled(PolySynthHandle handle, int effect_index, int enabled);
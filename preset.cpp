@@ -0,0 +1,342 @@
+// synth/preset.cpp
+#include "preset.h"
+#include "param_table.h"
+#include "poly_synth.h"
+#include "unison_stack.h"
+#include "effects/reverb_effect.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace PresetFile {
+
+namespace {
+
+// A bool read from a file may hold any byte; look at the byte itself.
+bool validFlag(const bool& flag) {
+    unsigned char byte;
+    std::memcpy(&byte, &flag, 1);
+    return byte <= 1;
+}
+
+template <typename Enum>
+bool validEnum(Enum value, int count) {
+    return static_cast<int>(value) >= 0 && static_cast<int>(value) < count;
+}
+
+bool inRange(float value, float minValue, float maxValue) {
+    return std::isfinite(value) && value >= minValue && value <= maxValue;
+}
+
+constexpr int NUM_WAVEFORMS = static_cast<int>(Waveform::Additive) + 1;
+constexpr int NUM_LFO_WAVEFORMS = static_cast<int>(LfoWaveform::RandomStep) + 1;
+constexpr int NUM_FILTER_TYPES = static_cast<int>(SynthParams::FilterType::NOTCH) + 1;
+constexpr int NUM_WHEEL_MOD_SOURCES = static_cast<int>(WheelModSource::NOISE) + 1;
+
+} // namespace
+
+uint32_t checksum(const void* data, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+Header makeHeader(const Preset& preset) {
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.presetBytes = sizeof(Preset);
+    header.checksum = checksum(&preset, sizeof(Preset));
+    return header;
+}
+
+bool validate(const Header& header, const void* presetBytes, size_t available, std::string& error) {
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = "not a compiled preset";
+        return false;
+    }
+    if (header.version != FORMAT_VERSION || header.presetBytes != sizeof(Preset)) {
+        error = "compiled for preset format " + std::to_string(header.version) + " (" +
+                std::to_string(header.presetBytes) + " bytes), this build reads format " +
+                std::to_string(FORMAT_VERSION) + " (" + std::to_string(sizeof(Preset)) +
+                " bytes); recompile it from JSON";
+        return false;
+    }
+    if (available < sizeof(Preset)) {
+        error = "truncated";
+        return false;
+    }
+    if (checksum(presetBytes, sizeof(Preset)) != header.checksum) {
+        error = "checksum mismatch";
+        return false;
+    }
+    return checkValues(*static_cast<const Preset*>(presetBytes), error);
+}
+
+bool checkValues(const Preset& preset, std::string& error) {
+    const Patch& p = preset.patch;
+    const bool flags[] = {
+        validFlag(p.vcoBLowFreqEnabled), validFlag(p.vcoBKeyFollowEnabled), validFlag(p.syncEnabled),
+        validFlag(p.unisonEnabled), validFlag(p.glideEnabled), validFlag(preset.reverb.enabled),
+    };
+    for (bool valid : flags) {
+        if (!valid) {
+            error = "switch out of range";
+            return false;
+        }
+    }
+    if (!validEnum(p.osc1Waveform, NUM_WAVEFORMS) || !validEnum(p.osc2Waveform, NUM_WAVEFORMS) ||
+        !validEnum(p.filter.type, NUM_FILTER_TYPES) || !validEnum(p.lfoWaveform, NUM_LFO_WAVEFORMS) ||
+        !validEnum(p.wheelModSource, NUM_WHEEL_MOD_SOURCES)) {
+        error = "waveform, filter type or wheel source out of range";
+        return false;
+    }
+    // With the switches and enums known good, every parameter reads back
+    // through presetParam() and has the range the JSON compiler clamps to.
+    for (int i = 0; i < ParamTable::NUM_PARAMS; ++i) {
+        const auto id = static_cast<SynthParams::ParamID>(i);
+        const ParamInfo& info = ParamTable::info(id);
+        if (!inRange(presetParam(preset, id), info.minValue, info.maxValue)) {
+            error = "parameter " + std::to_string(i) + " out of range";
+            return false;
+        }
+    }
+    if (!inRange(p.pitchBendRangeSemitones, 0.0f, 48.0f) || p.unisonVoices < 1 ||
+        p.unisonVoices > UnisonLayout::MAX_MEMBERS) {
+        error = "pitch bend range or unison voices out of range";
+        return false;
+    }
+    for (int h = 0; h < NUM_OSC_HARMONICS; ++h) {
+        if (!inRange(p.osc1Harmonics[h], 0.0f, 1.0f) || !inRange(p.osc2Harmonics[h], 0.0f, 1.0f)) {
+            error = "harmonic " + std::to_string(h + 1) + " out of range";
+            return false;
+        }
+    }
+    const ParamInfo& lfoRate = ParamTable::info(SynthParams::ParamID::LfoRate);
+    for (const LfoSettings& lfo : p.extraLfos) {
+        if (!validFlag(lfo.perVoice) || !validEnum(lfo.waveform, NUM_LFO_WAVEFORMS) ||
+            !inRange(lfo.rate, lfoRate.minValue, lfoRate.maxValue)) {
+            error = "LFO settings out of range";
+            return false;
+        }
+    }
+    if (p.numModRoutes < 0 || p.numModRoutes > MAX_MOD_ROUTES) {
+        error = "mod route count out of range";
+        return false;
+    }
+    for (int i = 0; i < p.numModRoutes; ++i) {
+        const ModRoute& route = p.modRoutes[i];
+        if (!validFlag(route.viaWheel) || !validEnum(route.source, NUM_MOD_SOURCES) ||
+            !validEnum(route.destination, NUM_MOD_DESTINATIONS) || !modRouteSupported(route)) {
+            error = "mod route " + std::to_string(i) + " is invalid";
+            return false;
+        }
+        const float maxAmount = modDestinationInfo(route.destination).maxAmount;
+        if (!inRange(route.amount, -maxAmount, maxAmount)) {
+            error = "mod route " + std::to_string(i) + " amount out of range";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool save(const Preset& preset, const std::string& path, std::string& error) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+    const Header header = makeHeader(preset);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&preset), sizeof(preset));
+    if (!out) {
+        error = "write to " + path + " failed";
+        return false;
+    }
+    return true;
+}
+
+bool load(const std::string& path, Preset& preset, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    Header header;
+    Preset loaded;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (in.gcount() != static_cast<std::streamsize>(sizeof(header))) {
+        error = "truncated";
+        return false;
+    }
+    in.read(reinterpret_cast<char*>(&loaded), sizeof(loaded));
+    if (!validate(header, &loaded, static_cast<size_t>(in.gcount()), error)) return false;
+    preset = loaded;
+    return true;
+}
+
+} // namespace PresetFile
+
+void applyPreset(PolySynth& synth, ReverbEffect* reverb, const Preset& preset) {
+    synth.setPatch(preset.patch);
+    synth.setModulationWheelValue(preset.modulationWheelValue);
+    if (reverb) {
+        const ReverbSettings& settings = preset.reverb;
+        reverb->setEnabled(settings.enabled);
+        reverb->setDryWetMix(settings.dryWetMix);
+        reverb->setRoomSize(settings.roomSize);
+        reverb->setDamping(settings.damping);
+        reverb->setWetGain(settings.wetGain);
+        reverb->setRT60(settings.rt60);
+    }
+}
+
+float presetParam(const Preset& preset, SynthParams::ParamID id) {
+    using SynthParams::ParamID;
+    const Patch& p = preset.patch;
+    const ReverbSettings& r = preset.reverb;
+    switch (id) {
+    case ParamID::MasterTuneCents:    return p.masterTuneCents;
+    case ParamID::Osc1Waveform:       return static_cast<float>(p.osc1Waveform);
+    case ParamID::Osc2Waveform:       return static_cast<float>(p.osc2Waveform);
+    case ParamID::Osc1Level:          return p.osc1Level;
+    case ParamID::Osc2Level:          return p.osc2Level;
+    case ParamID::NoiseLevel:         return p.noiseLevel;
+    case ParamID::RingModLevel:       return p.ringModLevel;
+    case ParamID::VCOBDetuneCents:    return p.vcoBDetuneCents;
+    case ParamID::SyncEnabled:        return p.syncEnabled ? 1.0f : 0.0f;
+    case ParamID::VCOBLowFreqEnabled: return p.vcoBLowFreqEnabled ? 1.0f : 0.0f;
+    case ParamID::VCOBFreqKnob:       return p.vcoBFreqKnob;
+    case ParamID::FilterEnvVelocitySensitivity: return p.filterEnvVelocitySensitivity;
+    case ParamID::AmpVelocitySensitivity: return p.ampVelocitySensitivity;
+    case ParamID::PulseWidth:         return p.pulseWidth;
+    case ParamID::PWMDepth:           return p.pwmDepth;
+    case ParamID::XModOsc2ToOsc1FMAmount: return p.xmodOsc2ToOsc1FMAmount;
+    case ParamID::XModOsc1ToOsc2FMAmount: return p.xmodOsc1ToOsc2FMAmount;
+    case ParamID::PMFilterEnvToFreqAAmount: return p.pmFilterEnvToFreqAAmount;
+    case ParamID::PMFilterEnvToPWAAmount: return p.pmFilterEnvToPWAAmount;
+    case ParamID::PMFilterEnvToFilterCutoffAmount: return p.pmFilterEnvToFilterCutoffAmount;
+    case ParamID::PMOscBToPWAAmount:  return p.pmOscBToPWAAmount;
+    case ParamID::PMOscBToFilterCutoffAmount: return p.pmOscBToFilterCutoffAmount;
+    case ParamID::FilterType:         return static_cast<float>(p.filter.type);
+    case ParamID::VCFBaseCutoff:      return p.filter.baseCutoffHz;
+    case ParamID::VCFResonance:       return p.filter.resonance;
+    case ParamID::VCFKeyFollow:       return p.filter.keyFollow;
+    case ParamID::VCFEnvelopeAmount:  return p.filter.envModAmount;
+    case ParamID::MixerDrive:         return p.mixerDrive;
+    case ParamID::MixerPostGain:      return p.mixerPostGain;
+    case ParamID::AmpEnvAttack:       return p.ampEnv.attack;
+    case ParamID::AmpEnvDecay:        return p.ampEnv.decay;
+    case ParamID::AmpEnvSustain:      return p.ampEnv.sustain;
+    case ParamID::AmpEnvRelease:      return p.ampEnv.release;
+    case ParamID::FilterEnvAttack:    return p.filterEnv.attack;
+    case ParamID::FilterEnvDecay:     return p.filterEnv.decay;
+    case ParamID::FilterEnvSustain:   return p.filterEnv.sustain;
+    case ParamID::FilterEnvRelease:   return p.filterEnv.release;
+    case ParamID::LfoRate:            return p.lfoRate;
+    case ParamID::LfoWaveform:        return static_cast<float>(p.lfoWaveform);
+    case ParamID::LfoAmountToVco1Freq: return p.lfoModAmounts[static_cast<int>(LfoDestination::VCO1_Freq)];
+    case ParamID::LfoAmountToVco2Freq: return p.lfoModAmounts[static_cast<int>(LfoDestination::VCO2_Freq)];
+    case ParamID::LfoAmountToVco1Pw:  return p.lfoModAmounts[static_cast<int>(LfoDestination::VCO1_PW)];
+    case ParamID::LfoAmountToVco2Pw:  return p.lfoModAmounts[static_cast<int>(LfoDestination::VCO2_PW)];
+    case ParamID::LfoAmountToVcfCutoff: return p.lfoModAmounts[static_cast<int>(LfoDestination::VCF_Cutoff)];
+    case ParamID::ModulationWheelValue: return preset.modulationWheelValue;
+    case ParamID::WheelModSource:     return static_cast<float>(p.wheelModSource);
+    case ParamID::WheelModAmountToFreqA: return p.wheelModToFreqAAmount;
+    case ParamID::WheelModAmountToFreqB: return p.wheelModToFreqBAmount;
+    case ParamID::WheelModAmountToPWA: return p.wheelModToPWAAmount;
+    case ParamID::WheelModAmountToPWB: return p.wheelModToPWBAmount;
+    case ParamID::WheelModAmountToFilter: return p.wheelModToFilterAmount;
+    case ParamID::UnisonEnabled:      return p.unisonEnabled ? 1.0f : 0.0f;
+    case ParamID::UnisonDetuneCents:  return p.unisonDetuneCents;
+    case ParamID::UnisonStereoSpread: return p.unisonStereoSpread;
+    case ParamID::GlideEnabled:       return p.glideEnabled ? 1.0f : 0.0f;
+    case ParamID::GlideTime:          return p.glideTime;
+    case ParamID::AnalogPitchDriftDepth: return p.analogPitchDriftDepth;
+    case ParamID::AnalogPWDriftDepth: return p.analogPWDriftDepth;
+    case ParamID::ReverbEnabled:      return r.enabled ? 1.0f : 0.0f;
+    case ParamID::ReverbDryWetMix:    return r.dryWetMix;
+    case ParamID::ReverbRoomSize:     return r.roomSize;
+    case ParamID::ReverbDamping:      return r.damping;
+    case ParamID::ReverbWetGain:      return r.wetGain;
+    case ParamID::ReverbRT60:         return r.rt60;
+    default:                          return 0.0f;
+    }
+}
+
+void setPresetParam(Preset& preset, SynthParams::ParamID id, float value) {
+    using SynthParams::ParamID;
+    Patch& p = preset.patch;
+    ReverbSettings& r = preset.reverb;
+    const int stepped = static_cast<int>(value);
+    switch (id) {
+    case ParamID::MasterTuneCents:    p.masterTuneCents = value; break;
+    case ParamID::Osc1Waveform:       p.osc1Waveform = static_cast<Waveform>(stepped); break;
+    case ParamID::Osc2Waveform:       p.osc2Waveform = static_cast<Waveform>(stepped); break;
+    case ParamID::Osc1Level:          p.osc1Level = value; break;
+    case ParamID::Osc2Level:          p.osc2Level = value; break;
+    case ParamID::NoiseLevel:         p.noiseLevel = value; break;
+    case ParamID::RingModLevel:       p.ringModLevel = value; break;
+    case ParamID::VCOBDetuneCents:    p.vcoBDetuneCents = value; break;
+    case ParamID::SyncEnabled:        p.syncEnabled = stepped != 0; break;
+    case ParamID::VCOBLowFreqEnabled: p.vcoBLowFreqEnabled = stepped != 0; break;
+    case ParamID::VCOBFreqKnob:       p.vcoBFreqKnob = value; break;
+    case ParamID::FilterEnvVelocitySensitivity: p.filterEnvVelocitySensitivity = value; break;
+    case ParamID::AmpVelocitySensitivity: p.ampVelocitySensitivity = value; break;
+    case ParamID::PulseWidth:         p.pulseWidth = value; break;
+    case ParamID::PWMDepth:           p.pwmDepth = value; break;
+    case ParamID::XModOsc2ToOsc1FMAmount: p.xmodOsc2ToOsc1FMAmount = value; break;
+    case ParamID::XModOsc1ToOsc2FMAmount: p.xmodOsc1ToOsc2FMAmount = value; break;
+    case ParamID::PMFilterEnvToFreqAAmount: p.pmFilterEnvToFreqAAmount = value; break;
+    case ParamID::PMFilterEnvToPWAAmount: p.pmFilterEnvToPWAAmount = value; break;
+    case ParamID::PMFilterEnvToFilterCutoffAmount: p.pmFilterEnvToFilterCutoffAmount = value; break;
+    case ParamID::PMOscBToPWAAmount:  p.pmOscBToPWAAmount = value; break;
+    case ParamID::PMOscBToFilterCutoffAmount: p.pmOscBToFilterCutoffAmount = value; break;
+    case ParamID::FilterType:         p.filter.type = static_cast<SynthParams::FilterType>(stepped); break;
+    case ParamID::VCFBaseCutoff:      p.filter.baseCutoffHz = value; break;
+    case ParamID::VCFResonance:       p.filter.resonance = value; break;
+    case ParamID::VCFKeyFollow:       p.filter.keyFollow = value; break;
+    case ParamID::VCFEnvelopeAmount:  p.filter.envModAmount = value; break;
+    case ParamID::MixerDrive:         p.mixerDrive = value; break;
+    case ParamID::MixerPostGain:      p.mixerPostGain = value; break;
+    case ParamID::AmpEnvAttack:       p.ampEnv.attack = value; break;
+    case ParamID::AmpEnvDecay:        p.ampEnv.decay = value; break;
+    case ParamID::AmpEnvSustain:      p.ampEnv.sustain = value; break;
+    case ParamID::AmpEnvRelease:      p.ampEnv.release = value; break;
+    case ParamID::FilterEnvAttack:    p.filterEnv.attack = value; break;
+    case ParamID::FilterEnvDecay:     p.filterEnv.decay = value; break;
+    case ParamID::FilterEnvSustain:   p.filterEnv.sustain = value; break;
+    case ParamID::FilterEnvRelease:   p.filterEnv.release = value; break;
+    case ParamID::LfoRate:            p.lfoRate = value; break;
+    case ParamID::LfoWaveform:        p.lfoWaveform = static_cast<LfoWaveform>(stepped); break;
+    case ParamID::LfoAmountToVco1Freq: p.lfoModAmounts[static_cast<int>(LfoDestination::VCO1_Freq)] = value; break;
+    case ParamID::LfoAmountToVco2Freq: p.lfoModAmounts[static_cast<int>(LfoDestination::VCO2_Freq)] = value; break;
+    case ParamID::LfoAmountToVco1Pw:  p.lfoModAmounts[static_cast<int>(LfoDestination::VCO1_PW)] = value; break;
+    case ParamID::LfoAmountToVco2Pw:  p.lfoModAmounts[static_cast<int>(LfoDestination::VCO2_PW)] = value; break;
+    case ParamID::LfoAmountToVcfCutoff: p.lfoModAmounts[static_cast<int>(LfoDestination::VCF_Cutoff)] = value; break;
+    case ParamID::ModulationWheelValue: preset.modulationWheelValue = value; break;
+    case ParamID::WheelModSource:     p.wheelModSource = static_cast<WheelModSource>(stepped); break;
+    case ParamID::WheelModAmountToFreqA: p.wheelModToFreqAAmount = value; break;
+    case ParamID::WheelModAmountToFreqB: p.wheelModToFreqBAmount = value; break;
+    case ParamID::WheelModAmountToPWA: p.wheelModToPWAAmount = value; break;
+    case ParamID::WheelModAmountToPWB: p.wheelModToPWBAmount = value; break;
+    case ParamID::WheelModAmountToFilter: p.wheelModToFilterAmount = value; break;
+    case ParamID::UnisonEnabled:      p.unisonEnabled = stepped != 0; break;
+    case ParamID::UnisonDetuneCents:  p.unisonDetuneCents = value; break;
+    case ParamID::UnisonStereoSpread: p.unisonStereoSpread = value; break;
+    case ParamID::GlideEnabled:       p.glideEnabled = stepped != 0; break;
+    case ParamID::GlideTime:          p.glideTime = value; break;
+    case ParamID::AnalogPitchDriftDepth: p.analogPitchDriftDepth = value; break;
+    case ParamID::AnalogPWDriftDepth: p.analogPWDriftDepth = value; break;
+    case ParamID::ReverbEnabled:      r.enabled = stepped != 0; break;
+    case ParamID::ReverbDryWetMix:    r.dryWetMix = value; break;
+    case ParamID::ReverbRoomSize:     r.roomSize = value; break;
+    case ParamID::ReverbDamping:      r.damping = value; break;
+    case ParamID::ReverbWetGain:      r.wetGain = value; break;
+    case ParamID::ReverbRT60:         r.rt60 = value; break;
+    default:                          break;
+    }
+}
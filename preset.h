@@ -0,0 +1,75 @@
+// synth/preset.h
+#pragma once
+#include "patch.h"
+#include "synth_parameters.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+class PolySynth;
+class ReverbEffect;
+
+struct ReverbSettings {
+    bool enabled = true;
+    float dryWetMix = 0.3f;
+    float roomSize = 0.5f;
+    float damping = 0.5f;
+    float wetGain = 1.0f;
+    float rt60 = 1.2f;
+};
+
+// A complete, validated sound: everything a JSON preset can set, already
+// clamped to range. Applying one is a single patch publish plus the reverb
+// settings, so presets can be switched mid-performance.
+struct Preset {
+    Patch patch;
+    ReverbSettings reverb;
+    float modulationWheelValue = 0.0f;
+};
+
+// Compiled preset file: a fixed header followed by the Preset as laid out in
+// memory, so loading is one read and a checksum. The layout is tied to this
+// build's Patch; FORMAT_VERSION must be bumped whenever Preset or Patch
+// changes, and files from another version are rejected (recompile them from
+// JSON).
+namespace PresetFile {
+
+static_assert(std::is_trivially_copyable<Preset>::value, "Preset is stored as raw bytes");
+
+constexpr char MAGIC[4] = {'P', 'S', 'P', 'T'};
+constexpr uint32_t FORMAT_VERSION = 3;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t presetBytes; // sizeof(Preset) when written
+    uint32_t checksum;    // FNV-1a of the preset bytes
+};
+
+uint32_t checksum(const void* data, size_t size);
+// Fills a header for `preset`.
+Header makeHeader(const Preset& preset);
+// Checks a header and the preset bytes that follow it, including
+// checkValues().
+bool validate(const Header& header, const void* presetBytes, size_t available, std::string& error);
+// Checks that every enum, switch, count and number of a preset read back
+// from raw bytes is one the JSON compiler could have produced, so a damaged
+// file cannot reach the voices.
+bool checkValues(const Preset& preset, std::string& error);
+
+bool save(const Preset& preset, const std::string& path, std::string& error);
+bool load(const std::string& path, Preset& preset, std::string& error);
+
+} // namespace PresetFile
+
+// Publishes the preset's patch in one step and applies its reverb settings
+// to `reverb` (may be null). Control thread, like the individual setters.
+void applyPreset(PolySynth& synth, ReverbEffect* reverb, const Preset& preset);
+
+// Value of `id` in `preset`, in the units PolySynth::setParam() takes
+// (enums and switches as their number). Lets two presets be compared, or one
+// be applied, parameter by parameter.
+float presetParam(const Preset& preset, SynthParams::ParamID id);
+// The reverse of presetParam(); `value` is taken as given, not clamped.
+void setPresetParam(Preset& preset, SynthParams::ParamID id, float value);
@@ -0,0 +1,204 @@
+// synth/preset_bank.cpp
+#include "preset_bank.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace PresetBankFile {
+
+namespace {
+
+constexpr size_t PRESET_ALIGNMENT = 64;
+
+size_t tablesEnd(size_t count) {
+    return sizeof(Header) + count * (sizeof(Entry) + sizeof(NameIndex));
+}
+
+size_t presetsOffset(size_t count) {
+    return (tablesEnd(count) + PRESET_ALIGNMENT - 1) / PRESET_ALIGNMENT * PRESET_ALIGNMENT;
+}
+
+uint32_t tableChecksum(const void* tables, size_t count) {
+    return PresetFile::checksum(tables, count * (sizeof(Entry) + sizeof(NameIndex)));
+}
+
+} // namespace
+
+uint64_t hashName(const char* name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (; *name; ++name) {
+        hash = (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool write(const std::vector<std::pair<std::string, Preset>>& presets, const std::string& path,
+           std::string& error) {
+    const size_t count = presets.size();
+    std::vector<Entry> entries(count);
+    std::vector<NameIndex> index(count);
+    for (size_t i = 0; i < count; ++i) {
+        const std::string& name = presets[i].first;
+        if (name.empty() || name.size() >= NAME_BYTES) {
+            error = "preset name '" + name + "' must be 1 to " + std::to_string(NAME_BYTES - 1) + " characters";
+            return false;
+        }
+        std::memcpy(entries[i].name, name.c_str(), name.size() + 1);
+        entries[i].checksum = PresetFile::checksum(&presets[i].second, sizeof(Preset));
+        index[i] = {hashName(entries[i].name), static_cast<uint32_t>(i), 0};
+    }
+    std::sort(index.begin(), index.end(),
+              [](const NameIndex& a, const NameIndex& b) { return a.hash < b.hash; });
+    for (size_t i = 1; i < count; ++i) {
+        if (index[i].hash == index[i - 1].hash) {
+            error = "preset names '" + presets[index[i - 1].program].first + "' and '" +
+                    presets[index[i].program].first + "' collide";
+            return false;
+        }
+    }
+
+    // Entries and index are checksummed as one contiguous block, as they sit
+    // in the file.
+    std::vector<char> tables(count * (sizeof(Entry) + sizeof(NameIndex)));
+    if (count > 0) {
+        std::memcpy(tables.data(), entries.data(), count * sizeof(Entry));
+        std::memcpy(tables.data() + count * sizeof(Entry), index.data(), count * sizeof(NameIndex));
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.presetFormatVersion = PresetFile::FORMAT_VERSION;
+    header.presetBytes = sizeof(Preset);
+    header.count = static_cast<uint32_t>(count);
+    header.presetsOffset = static_cast<uint32_t>(presetsOffset(count));
+    header.tableChecksum = tableChecksum(tables.data(), count);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot open " + path + " for writing";
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(tables.data(), static_cast<std::streamsize>(tables.size()));
+    const std::vector<char> padding(header.presetsOffset - tablesEnd(count), 0);
+    out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    for (const auto& preset : presets) {
+        out.write(reinterpret_cast<const char*>(&preset.second), sizeof(Preset));
+    }
+    if (!out) {
+        error = "write to " + path + " failed";
+        return false;
+    }
+    return true;
+}
+
+} // namespace PresetBankFile
+
+PresetBank::~PresetBank() {
+    close();
+}
+
+bool PresetBank::open(const std::string& path, std::string& error, std::vector<std::string>& skipped) {
+    using namespace PresetBankFile;
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        ::close(fd);
+        error = "not a preset bank";
+        return false;
+    }
+    const size_t bytes = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        error = "cannot map " + path;
+        return false;
+    }
+    data_ = data;
+    bytes_ = bytes;
+
+    const auto* base = static_cast<const char*>(data);
+    const auto* header = reinterpret_cast<const Header*>(base);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != FORMAT_VERSION) {
+        error = "not a preset bank, or one from another bank format";
+    } else if (header->presetFormatVersion != PresetFile::FORMAT_VERSION || header->presetBytes != sizeof(Preset)) {
+        error = "presets compiled for preset format " + std::to_string(header->presetFormatVersion) +
+                ", this build reads format " + std::to_string(PresetFile::FORMAT_VERSION) + "; rebuild the bank";
+    } else if (header->presetsOffset != presetsOffset(header->count) ||
+               bytes < header->presetsOffset + static_cast<size_t>(header->count) * sizeof(Preset)) {
+        error = "truncated";
+    } else if (tableChecksum(base + sizeof(Header), header->count) != header->tableChecksum) {
+        error = "checksum mismatch";
+    } else {
+        count_ = static_cast<int>(header->count);
+        entries_ = reinterpret_cast<const Entry*>(base + sizeof(Header));
+        index_ = reinterpret_cast<const NameIndex*>(entries_ + count_);
+        presets_ = reinterpret_cast<const Preset*>(base + header->presetsOffset);
+        usable_.assign(count_, 0);
+        for (int program = 0; program < count_; ++program) {
+            std::string presetError;
+            if (verify(program, presetError)) {
+                usable_[program] = 1;
+            } else {
+                skipped.push_back("program " + std::to_string(program) + ": " + presetError);
+            }
+        }
+        return true;
+    }
+    close();
+    return false;
+}
+
+void PresetBank::close() {
+    if (data_) munmap(data_, bytes_);
+    data_ = nullptr;
+    bytes_ = 0;
+    count_ = 0;
+    entries_ = nullptr;
+    index_ = nullptr;
+    presets_ = nullptr;
+    usable_.clear();
+}
+
+int PresetBank::findProgram(const char* name) const {
+    const uint64_t hash = PresetBankFile::hashName(name);
+    const auto* end = index_ + count_;
+    const auto* it = std::lower_bound(index_, end, hash,
+                                      [](const PresetBankFile::NameIndex& entry, uint64_t h) { return entry.hash < h; });
+    if (it == end || it->hash != hash) return -1;
+    const int program = static_cast<int>(it->program);
+    if (program >= count_ || std::strncmp(entries_[program].name, name, PresetBankFile::NAME_BYTES) != 0) return -1;
+    return program;
+}
+
+bool PresetBank::verify(int program, std::string& error) const {
+    if (program < 0 || program >= count_) {
+        error = "no such program";
+        return false;
+    }
+    const PresetBankFile::Entry& entry = entries_[program];
+    if (std::memchr(entry.name, '\0', PresetBankFile::NAME_BYTES) == nullptr) {
+        error = "name not terminated";
+        return false;
+    }
+    const Preset& preset = presets_[program];
+    if (PresetFile::checksum(&preset, sizeof(Preset)) != entry.checksum) {
+        error = std::string(entry.name) + ": checksum mismatch";
+        return false;
+    }
+    if (!PresetFile::checkValues(preset, error)) {
+        error = std::string(entry.name) + ": " + error;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+// synth/preset_bank.h
+#pragma once
+#include "preset.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Bank file: many compiled presets in one file that is mapped read-only, so
+// processes using the same bank share its pages and selecting a preset is a
+// lookup into the mapping, with no parsing or allocation.
+//
+// Layout: Header, Entry[count] in program order, NameIndex[count] sorted by
+// name hash, then Preset[count] in program order starting at presetsOffset.
+// Like single .psp files, the presets are raw bytes of this build's Preset and
+// carry the preset format version.
+namespace PresetBankFile {
+
+constexpr char MAGIC[4] = {'P', 'S', 'B', 'K'};
+constexpr uint32_t FORMAT_VERSION = 1;
+constexpr int NAME_BYTES = 32; // including the terminating NUL
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t presetFormatVersion; // PresetFile::FORMAT_VERSION when written
+    uint32_t presetBytes;         // sizeof(Preset) when written
+    uint32_t count;
+    uint32_t presetsOffset;       // from the start of the file, aligned to 64
+    uint32_t tableChecksum;       // FNV-1a of the entries and the name index
+    uint32_t reserved;
+};
+
+struct Entry {
+    char name[NAME_BYTES];
+    uint32_t checksum; // FNV-1a of the preset bytes
+    uint32_t reserved;
+};
+
+struct NameIndex {
+    uint64_t hash;
+    uint32_t program;
+    uint32_t reserved;
+};
+
+uint64_t hashName(const char* name);
+
+// Writes `presets` (name, preset) as a bank, in the given program order.
+// Names must be unique and shorter than NAME_BYTES.
+bool write(const std::vector<std::pair<std::string, Preset>>& presets, const std::string& path,
+           std::string& error);
+
+} // namespace PresetBankFile
+
+class PresetBank {
+public:
+    PresetBank() = default;
+    ~PresetBank();
+    PresetBank(const PresetBank&) = delete;
+    PresetBank& operator=(const PresetBank&) = delete;
+
+    // Maps the bank and checks its header and tables, then every preset with
+    // verify(). Presets that fail are reported in `skipped` and cannot be
+    // selected. Replaces any bank already open.
+    bool open(const std::string& path, std::string& error, std::vector<std::string>& skipped);
+    void close();
+    bool isOpen() const { return data_ != nullptr; }
+
+    int size() const { return count_; }
+    // Null if `program` is out of range or was skipped. Valid until close().
+    const Preset* getPreset(int program) const {
+        return program >= 0 && program < count_ && usable_[program] ? &presets_[program] : nullptr;
+    }
+    const char* getName(int program) const {
+        return program >= 0 && program < count_ ? entries_[program].name : nullptr;
+    }
+    // Program number for `name`, or -1. Binary search over the name hashes.
+    int findProgram(const char* name) const;
+    // Checks one preset's name, checksum and values (see
+    // PresetFile::checkValues); reads every byte of it.
+    bool verify(int program, std::string& error) const;
+
+private:
+    void* data_ = nullptr;
+    size_t bytes_ = 0;
+    int count_ = 0;
+    const PresetBankFile::Entry* entries_ = nullptr;
+    const PresetBankFile::NameIndex* index_ = nullptr;
+    const Preset* presets_ = nullptr;
+    std::vector<char> usable_;
+};
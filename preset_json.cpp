@@ -0,0 +1,379 @@
+// synth/preset_json.cpp
+#include "preset_json.h"
+#include "param_table.h"
+#include "unison_stack.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+using SynthParams::ParamID;
+using nlohmann::json;
+
+template <typename Enum>
+using NamedValue = std::pair<const char*, Enum>;
+
+const NamedValue<Waveform> WAVEFORM_NAMES[] = {
+    {"Sine", Waveform::Sine}, {"Saw", Waveform::Saw}, {"Square", Waveform::Square},
+    {"Triangle", Waveform::Triangle}, {"Pulse", Waveform::Pulse}, {"Additive", Waveform::Additive},
+};
+const NamedValue<LfoWaveform> LFO_WAVEFORM_NAMES[] = {
+    {"Triangle", LfoWaveform::Triangle}, {"SawUp", LfoWaveform::SawUp}, {"Square", LfoWaveform::Square},
+    {"Sine", LfoWaveform::Sine}, {"RandomStep", LfoWaveform::RandomStep},
+};
+const NamedValue<SynthParams::FilterType> FILTER_TYPE_NAMES[] = {
+    {"LPF24", SynthParams::FilterType::LPF24}, {"LPF12", SynthParams::FilterType::LPF12},
+    {"HPF12", SynthParams::FilterType::HPF12}, {"BPF12", SynthParams::FilterType::BPF12},
+    {"NOTCH", SynthParams::FilterType::NOTCH},
+};
+const NamedValue<WheelModSource> WHEEL_MOD_SOURCE_NAMES[] = {
+    {"LFO", WheelModSource::LFO}, {"NOISE", WheelModSource::NOISE},
+};
+
+std::string formatNumber(float x) {
+    std::ostringstream out;
+    out << x;
+    return out.str();
+}
+
+// Reads the fields of one JSON object, remembering which keys were used so
+// the rest can be reported as unknown.
+class FieldReader {
+public:
+    FieldReader(const json& object, std::string prefix, std::vector<std::string>& errors)
+        : object_(object), prefix_(std::move(prefix)), errors_(errors) {}
+
+    bool has(const char* key) const { return object_.contains(key); }
+
+    float number(const char* key, float minValue, float maxValue, float fallback) {
+        const json* value = find(key);
+        if (!value) return fallback;
+        if (!value->is_number()) {
+            error(key, "expected a number");
+            return fallback;
+        }
+        const float x = value->get<float>();
+        if (x < minValue || x > maxValue) {
+            error(key, formatNumber(x) + " is outside [" + formatNumber(minValue) + ", " +
+                           formatNumber(maxValue) + "], clamped");
+            return std::clamp(x, minValue, maxValue);
+        }
+        return x;
+    }
+
+    float param(const char* key, ParamID id, float fallback) {
+        const ParamInfo& info = ParamTable::info(id);
+        return number(key, info.minValue, info.maxValue, fallback);
+    }
+
+    bool flag(const char* key, bool fallback) {
+        const json* value = find(key);
+        if (!value) return fallback;
+        if (!value->is_boolean()) {
+            error(key, "expected true or false");
+            return fallback;
+        }
+        return value->get<bool>();
+    }
+
+    template <typename Enum, size_t N>
+    Enum choice(const char* key, const NamedValue<Enum> (&names)[N], Enum fallback) {
+        const json* value = find(key);
+        if (!value) return fallback;
+        if (value->is_string()) {
+            const std::string name = value->get<std::string>();
+            for (const auto& entry : names) {
+                if (name == entry.first) return entry.second;
+            }
+            error(key, "unknown name '" + name + "'");
+        } else {
+            error(key, "expected a name");
+        }
+        return fallback;
+    }
+
+    // Amplitudes 1..n; harmonics past the end of the array are silent.
+    void harmonics(const char* key, float* amplitudes) {
+        const json* value = find(key);
+        if (!value) return;
+        if (!value->is_array()) {
+            error(key, "expected an array");
+            return;
+        }
+        if (value->size() > NUM_OSC_HARMONICS) {
+            error(key, std::to_string(value->size()) + " harmonics given, only the first " +
+                           std::to_string(NUM_OSC_HARMONICS) + " are used");
+        }
+        std::fill(amplitudes, amplitudes + NUM_OSC_HARMONICS, 0.0f);
+        for (size_t i = 0; i < value->size() && i < NUM_OSC_HARMONICS; ++i) {
+            const json& amplitude = (*value)[i];
+            if (!amplitude.is_number()) {
+                error(key, "entry " + std::to_string(i) + " is not a number");
+                continue;
+            }
+            const float x = amplitude.get<float>();
+            if (x < 0.0f || x > 1.0f) {
+                error(key, "entry " + std::to_string(i) + " is outside [0, 1], clamped");
+            }
+            amplitudes[i] = std::clamp(x, 0.0f, 1.0f);
+        }
+    }
+
+    // For enums named by a function rather than a table. The key is
+    // required; returns false, with the reason reported, if it is missing or
+    // names nothing.
+    template <typename Enum, typename NameOf>
+    bool named(const char* key, int count, NameOf nameOf, Enum& out) {
+        const json* value = find(key);
+        if (!value) {
+            error(key, "missing");
+            return false;
+        }
+        if (!value->is_string()) {
+            error(key, "expected a name");
+            return false;
+        }
+        const std::string name = value->get<std::string>();
+        for (int i = 0; i < count; ++i) {
+            if (name == nameOf(static_cast<Enum>(i))) {
+                out = static_cast<Enum>(i);
+                return true;
+            }
+        }
+        error(key, "unknown name '" + name + "'");
+        return false;
+    }
+
+    const json* array(const char* key) {
+        const json* value = find(key);
+        if (value && !value->is_array()) {
+            error(key, "expected an array");
+            return nullptr;
+        }
+        return value;
+    }
+
+    const json* object(const char* key) {
+        const json* value = find(key);
+        if (value && !value->is_object()) {
+            error(key, "expected an object");
+            return nullptr;
+        }
+        return value;
+    }
+
+    void reportUnknownKeys() {
+        for (const auto& item : object_.items()) {
+            if (std::find(used_.begin(), used_.end(), item.key()) == used_.end()) {
+                errors_.push_back(prefix_ + item.key() + ": unknown key, ignored");
+            }
+        }
+    }
+
+private:
+    const json* find(const char* key) {
+        used_.emplace_back(key);
+        auto it = object_.find(key);
+        return it == object_.end() ? nullptr : &*it;
+    }
+
+    void error(const char* key, const std::string& message) {
+        errors_.push_back(prefix_ + key + ": " + message);
+    }
+
+    const json& object_;
+    std::string prefix_;
+    std::vector<std::string>& errors_;
+    std::vector<std::string> used_;
+};
+
+EnvelopeParams readEnvelope(const json& object, const std::string& name, EnvelopeParams fallback,
+                            ParamID attackId, std::vector<std::string>& errors) {
+    FieldReader env(object, name + ".", errors);
+    const int first = static_cast<int>(attackId);
+    EnvelopeParams p;
+    p.attack = env.param("attack", static_cast<ParamID>(first), fallback.attack);
+    p.decay = env.param("decay", static_cast<ParamID>(first + 1), fallback.decay);
+    p.sustain = env.param("sustain", static_cast<ParamID>(first + 2), fallback.sustain);
+    p.release = env.param("release", static_cast<ParamID>(first + 3), fallback.release);
+    env.reportUnknownKeys();
+    return p;
+}
+
+// "modMatrix": [{"source": "lfo", "destination": "filterCutoff", "amount": 800,
+// "viaWheel": false}, ...]. Routes that cannot be used are dropped.
+void readModRoutes(const json& routes, Patch& p, std::vector<std::string>& errors) {
+    if (routes.size() > MAX_MOD_ROUTES) {
+        errors.push_back("modMatrix: " + std::to_string(routes.size()) + " routes given, only the first " +
+                         std::to_string(MAX_MOD_ROUTES) + " are used");
+    }
+    p.numModRoutes = 0;
+    for (size_t i = 0; i < routes.size() && i < MAX_MOD_ROUTES; ++i) {
+        const std::string name = "modMatrix[" + std::to_string(i) + "]";
+        if (!routes[i].is_object()) {
+            errors.push_back(name + ": expected an object, ignored");
+            continue;
+        }
+        FieldReader r(routes[i], name + ".", errors);
+        ModRoute route;
+        bool usable = r.named("source", NUM_MOD_SOURCES, modSourceName, route.source);
+        usable = r.named("destination", NUM_MOD_DESTINATIONS,
+                         [](ModDestination d) { return modDestinationInfo(d).name; }, route.destination) &&
+                 usable;
+        // The route is dropped anyway when the destination is unknown.
+        const float maxAmount =
+            usable ? modDestinationInfo(route.destination).maxAmount : std::numeric_limits<float>::max();
+        route.amount = r.number("amount", -maxAmount, maxAmount, 0.0f);
+        route.viaWheel = r.flag("viaWheel", false);
+        r.reportUnknownKeys();
+        if (usable && !modRouteSupported(route)) {
+            errors.push_back(name + ": oscB cannot modulate " + modDestinationInfo(route.destination).name +
+                             ", ignored");
+            usable = false;
+        }
+        if (usable) p.modRoutes[p.numModRoutes++] = route;
+    }
+}
+
+} // namespace
+
+bool compilePresetJson(const json& j, Preset& preset, std::vector<std::string>& errors) {
+    if (!j.is_object()) {
+        errors.push_back("preset is not a JSON object");
+        return false;
+    }
+    Preset compiled;
+    Patch& p = compiled.patch;
+    FieldReader r(j, "", errors);
+
+    p.masterTuneCents = r.param("masterTuneCents", ParamID::MasterTuneCents, 0.0f);
+    // "waveform" is the deprecated name for both oscillators' waveform.
+    const Waveform legacyWaveform = r.choice("waveform", WAVEFORM_NAMES, p.osc1Waveform);
+    if (r.has("waveform")) errors.push_back("waveform: deprecated, use osc1Waveform and osc2Waveform");
+    p.osc1Waveform = r.choice("osc1Waveform", WAVEFORM_NAMES, legacyWaveform);
+    p.osc2Waveform = r.choice("osc2Waveform", WAVEFORM_NAMES, legacyWaveform);
+    p.osc1Level = r.param("osc1Level", ParamID::Osc1Level, 1.0f);
+    p.osc2Level = r.param("osc2Level", ParamID::Osc2Level, 0.0f);
+    p.noiseLevel = r.param("noiseLevel", ParamID::NoiseLevel, 0.0f);
+    p.ringModLevel = r.param("ringModLevel", ParamID::RingModLevel, 0.0f);
+    p.vcoBDetuneCents = r.param("vcoBDetuneCents", ParamID::VCOBDetuneCents, 0.0f);
+    p.syncEnabled = r.flag("syncEnabled", false);
+    p.pulseWidth = r.param("pulseWidth", ParamID::PulseWidth, 0.5f);
+    p.pwmDepth = r.param("pwmDepth", ParamID::PWMDepth, 0.0f);
+    p.vcoBLowFreqEnabled = r.flag("vcoBLowFreqEnabled", false);
+    p.vcoBFreqKnob = r.param("vcoBFreqKnob", ParamID::VCOBFreqKnob, 0.5f);
+    p.vcoBKeyFollowEnabled = r.flag("vcoBKeyFollowEnabled", true);
+    p.filterEnvVelocitySensitivity =
+        r.param("filterEnvVelocitySensitivity", ParamID::FilterEnvVelocitySensitivity, 0.0f);
+    p.ampVelocitySensitivity = r.param("ampVelocitySensitivity", ParamID::AmpVelocitySensitivity, 0.7f);
+    p.xmodOsc2ToOsc1FMAmount = r.param("xmodOsc2ToOsc1FMAmount", ParamID::XModOsc2ToOsc1FMAmount, 0.0f);
+    p.xmodOsc1ToOsc2FMAmount = r.param("xmodOsc1ToOsc2FMAmount", ParamID::XModOsc1ToOsc2FMAmount, 0.0f);
+    p.pmFilterEnvToFreqAAmount = r.param("pmFilterEnvToFreqAAmount", ParamID::PMFilterEnvToFreqAAmount, 0.0f);
+    p.pmFilterEnvToPWAAmount = r.param("pmFilterEnvToPWAAmount", ParamID::PMFilterEnvToPWAAmount, 0.0f);
+    p.pmFilterEnvToFilterCutoffAmount =
+        r.param("pmFilterEnvToFilterCutoffAmount", ParamID::PMFilterEnvToFilterCutoffAmount, 0.0f);
+    p.pmOscBToPWAAmount = r.param("pmOscBToPWAAmount", ParamID::PMOscBToPWAAmount, 0.0f);
+    p.pmOscBToFilterCutoffAmount = r.param("pmOscBToFilterCutoffAmount", ParamID::PMOscBToFilterCutoffAmount, 0.0f);
+
+    p.filter.type = r.choice("filterType", FILTER_TYPE_NAMES, p.filter.type);
+    p.filter.baseCutoffHz = r.param("vcfBaseCutoff", ParamID::VCFBaseCutoff, 5000.0f);
+    p.filter.resonance = r.param("vcfResonance", ParamID::VCFResonance, 0.1f);
+    p.filter.keyFollow = r.param("vcfKeyFollow", ParamID::VCFKeyFollow, 0.0f);
+    p.filter.envModAmount = r.param("vcfEnvelopeAmount", ParamID::VCFEnvelopeAmount, 0.5f);
+
+    p.mixerDrive = r.param("mixerDrive", ParamID::MixerDrive, 0.0f);
+    p.mixerPostGain = r.param("mixerPostGain", ParamID::MixerPostGain, 1.0f);
+
+    if (const json* env = r.object("ampEnv")) {
+        p.ampEnv = readEnvelope(*env, "ampEnv", {0.01f, 0.1f, 0.7f, 0.2f}, ParamID::AmpEnvAttack, errors);
+    }
+    if (const json* env = r.object("filterEnv")) {
+        p.filterEnv = readEnvelope(*env, "filterEnv", {0.05f, 0.2f, 0.5f, 0.3f}, ParamID::FilterEnvAttack, errors);
+    }
+
+    p.lfoRate = r.param("lfoRate", ParamID::LfoRate, 1.0f);
+    p.lfoWaveform = r.choice("lfoWaveform", LFO_WAVEFORM_NAMES, p.lfoWaveform);
+    float* lfoAmounts = p.lfoModAmounts;
+    lfoAmounts[static_cast<int>(LfoDestination::VCO1_Freq)] =
+        r.param("lfoAmountToVco1Freq", ParamID::LfoAmountToVco1Freq, 0.0f);
+    lfoAmounts[static_cast<int>(LfoDestination::VCO2_Freq)] =
+        r.param("lfoAmountToVco2Freq", ParamID::LfoAmountToVco2Freq, 0.0f);
+    lfoAmounts[static_cast<int>(LfoDestination::VCO1_PW)] =
+        r.param("lfoAmountToVco1Pw", ParamID::LfoAmountToVco1Pw, 0.0f);
+    lfoAmounts[static_cast<int>(LfoDestination::VCO2_PW)] =
+        r.param("lfoAmountToVco2Pw", ParamID::LfoAmountToVco2Pw, 0.0f);
+    lfoAmounts[static_cast<int>(LfoDestination::VCF_Cutoff)] =
+        r.param("lfoAmountToVcfCutoff", ParamID::LfoAmountToVcfCutoff, 0.0f);
+
+    compiled.modulationWheelValue = r.param("modulationWheelValue", ParamID::ModulationWheelValue, 0.0f);
+    p.wheelModSource = r.choice("wheelModSource", WHEEL_MOD_SOURCE_NAMES, p.wheelModSource);
+    p.wheelModToFreqAAmount = r.param("wheelModAmountToFreqA", ParamID::WheelModAmountToFreqA, 0.0f);
+    p.wheelModToFreqBAmount = r.param("wheelModAmountToFreqB", ParamID::WheelModAmountToFreqB, 0.0f);
+    p.wheelModToPWAAmount = r.param("wheelModAmountToPWA", ParamID::WheelModAmountToPWA, 0.0f);
+    p.wheelModToPWBAmount = r.param("wheelModAmountToPWB", ParamID::WheelModAmountToPWB, 0.0f);
+    p.wheelModToFilterAmount = r.param("wheelModAmountToFilter", ParamID::WheelModAmountToFilter, 0.0f);
+
+    p.unisonEnabled = r.flag("unisonEnabled", false);
+    p.unisonVoices = static_cast<int>(r.number("unisonVoices", 1.0f, static_cast<float>(UnisonLayout::MAX_MEMBERS), 7.0f));
+    p.unisonDetuneCents = r.param("unisonDetuneCents", ParamID::UnisonDetuneCents, 7.0f);
+    p.unisonStereoSpread = r.param("unisonStereoSpread", ParamID::UnisonStereoSpread, 0.7f);
+
+    p.glideEnabled = r.flag("glideEnabled", false);
+    p.glideTime = r.param("glideTime", ParamID::GlideTime, 0.05f);
+
+    p.analogPitchDriftDepth = r.param("analogPitchDriftDepth", ParamID::AnalogPitchDriftDepth, 0.0f);
+    p.analogPWDriftDepth = r.param("analogPWDriftDepth", ParamID::AnalogPWDriftDepth, 0.0f);
+
+    p.pitchBendRangeSemitones = r.number("pitchBendRangeSemitones", 0.0f, 48.0f, 2.0f);
+
+    r.harmonics("osc1Harmonics", p.osc1Harmonics);
+    r.harmonics("osc2Harmonics", p.osc2Harmonics);
+
+    for (int l = 2; l <= NUM_LFOS; ++l) {
+        const std::string key = "lfo" + std::to_string(l);
+        if (const json* lfoJson = r.object(key.c_str())) {
+            FieldReader lfo(*lfoJson, key + ".", errors);
+            LfoSettings& s = p.extraLfos[l - 2];
+            s.rate = lfo.param("rate", ParamID::LfoRate, s.rate);
+            s.waveform = lfo.choice("waveform", LFO_WAVEFORM_NAMES, s.waveform);
+            s.perVoice = lfo.flag("perVoice", s.perVoice);
+            lfo.reportUnknownKeys();
+        }
+    }
+    if (const json* routes = r.array("modMatrix")) readModRoutes(*routes, p, errors);
+
+    if (const json* reverbJson = r.object("reverb")) {
+        FieldReader rev(*reverbJson, "reverb.", errors);
+        ReverbSettings& reverb = compiled.reverb;
+        reverb.enabled = rev.flag("enabled", false);
+        reverb.dryWetMix = rev.param("dryWetMix", ParamID::ReverbDryWetMix, 0.3f);
+        reverb.roomSize = rev.param("roomSize", ParamID::ReverbRoomSize, 0.5f);
+        reverb.damping = rev.param("damping", ParamID::ReverbDamping, 0.5f);
+        reverb.wetGain = rev.param("wetGain", ParamID::ReverbWetGain, 1.0f);
+        reverb.rt60 = rev.param("rt60", ParamID::ReverbRT60, 1.2f);
+        rev.reportUnknownKeys();
+    }
+
+    r.reportUnknownKeys();
+    preset = compiled;
+    return true;
+}
+
+bool compilePresetFile(const std::string& path, Preset& preset, std::vector<std::string>& errors) {
+    std::ifstream in(path);
+    if (!in) {
+        errors.push_back("cannot open " + path);
+        return false;
+    }
+    json j;
+    try {
+        in >> j;
+    } catch (const json::parse_error& e) {
+        errors.push_back(std::string("not valid JSON: ") + e.what());
+        return false;
+    }
+    return compilePresetJson(j, preset, errors);
+}
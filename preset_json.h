@@ -0,0 +1,16 @@
+// synth/preset_json.h
+#pragma once
+#include "preset.h"
+#include "nlohmann/json.hpp"
+#include <string>
+#include <vector>
+
+// JSON front end for presets (the synth_params.json format). Compiling
+// validates every field once: unknown keys, wrong types, unknown names and
+// out-of-range values are reported in `errors` and replaced by the default
+// or clamped, so the result is always a usable preset. Missing keys take
+// their defaults silently.
+bool compilePresetJson(const nlohmann::json& j, Preset& preset, std::vector<std::string>& errors);
+// Returns false, with the reason in `errors`, if the file cannot be read or
+// is not valid JSON.
+bool compilePresetFile(const std::string& path, Preset& preset, std::vector<std::string>& errors);
@@ -0,0 +1,166 @@
+// synth/preset_morph.cpp
+#include "preset_morph.h"
+#include "effects/reverb_effect.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+float lerp(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+// Equal steps in ratio, for values heard on a log scale. Falls back to linear
+// when either end is not positive.
+float lerpLog(float a, float b, float t) {
+    if (a <= 0.0f || b <= 0.0f) return lerp(a, b, t);
+    return a * std::pow(b / a, t);
+}
+
+void lerpEnvelope(const EnvelopeParams& a, const EnvelopeParams& b, float t, EnvelopeParams& out) {
+    out.attack = lerpLog(a.attack, b.attack, t);
+    out.decay = lerpLog(a.decay, b.decay, t);
+    out.sustain = lerp(a.sustain, b.sustain, t);
+    out.release = lerpLog(a.release, b.release, t);
+}
+
+} // namespace
+
+void morphPresets(const Preset& a, const Preset& b, float position, float threshold, Preset& out) {
+    const float t = std::clamp(position, 0.0f, 1.0f);
+    // Start from whichever side owns the discrete parameters, so anything not
+    // listed below switches rather than going stale.
+    out = t < threshold ? a : b;
+
+    const Patch& pa = a.patch;
+    const Patch& pb = b.patch;
+    Patch& p = out.patch;
+    p.osc1Level = lerp(pa.osc1Level, pb.osc1Level, t);
+    p.osc2Level = lerp(pa.osc2Level, pb.osc2Level, t);
+    p.noiseLevel = lerp(pa.noiseLevel, pb.noiseLevel, t);
+    p.ringModLevel = lerp(pa.ringModLevel, pb.ringModLevel, t);
+    p.pulseWidth = lerp(pa.pulseWidth, pb.pulseWidth, t);
+    p.pwmDepth = lerp(pa.pwmDepth, pb.pwmDepth, t);
+    p.vcoBDetuneCents = lerp(pa.vcoBDetuneCents, pb.vcoBDetuneCents, t);
+    p.vcoBFreqKnob = lerp(pa.vcoBFreqKnob, pb.vcoBFreqKnob, t);
+    p.xmodOsc2ToOsc1FMAmount = lerp(pa.xmodOsc2ToOsc1FMAmount, pb.xmodOsc2ToOsc1FMAmount, t);
+    p.xmodOsc1ToOsc2FMAmount = lerp(pa.xmodOsc1ToOsc2FMAmount, pb.xmodOsc1ToOsc2FMAmount, t);
+    p.pmFilterEnvToFreqAAmount = lerp(pa.pmFilterEnvToFreqAAmount, pb.pmFilterEnvToFreqAAmount, t);
+    p.pmFilterEnvToPWAAmount = lerp(pa.pmFilterEnvToPWAAmount, pb.pmFilterEnvToPWAAmount, t);
+    p.pmFilterEnvToFilterCutoffAmount =
+        lerp(pa.pmFilterEnvToFilterCutoffAmount, pb.pmFilterEnvToFilterCutoffAmount, t);
+    p.pmOscBToPWAAmount = lerp(pa.pmOscBToPWAAmount, pb.pmOscBToPWAAmount, t);
+    p.pmOscBToFilterCutoffAmount = lerp(pa.pmOscBToFilterCutoffAmount, pb.pmOscBToFilterCutoffAmount, t);
+    p.mixerDrive = lerp(pa.mixerDrive, pb.mixerDrive, t);
+    p.mixerPostGain = lerp(pa.mixerPostGain, pb.mixerPostGain, t);
+
+    p.filter.baseCutoffHz = lerpLog(pa.filter.baseCutoffHz, pb.filter.baseCutoffHz, t);
+    p.filter.resonance = lerp(pa.filter.resonance, pb.filter.resonance, t);
+    p.filter.keyFollow = lerp(pa.filter.keyFollow, pb.filter.keyFollow, t);
+    p.filter.envModAmount = lerp(pa.filter.envModAmount, pb.filter.envModAmount, t);
+
+    lerpEnvelope(pa.filterEnv, pb.filterEnv, t, p.filterEnv);
+    lerpEnvelope(pa.ampEnv, pb.ampEnv, t, p.ampEnv);
+    p.filterEnvVelocitySensitivity = lerp(pa.filterEnvVelocitySensitivity, pb.filterEnvVelocitySensitivity, t);
+    p.ampVelocitySensitivity = lerp(pa.ampVelocitySensitivity, pb.ampVelocitySensitivity, t);
+    p.analogPitchDriftDepth = lerp(pa.analogPitchDriftDepth, pb.analogPitchDriftDepth, t);
+    p.analogPWDriftDepth = lerp(pa.analogPWDriftDepth, pb.analogPWDriftDepth, t);
+
+    p.lfoRate = lerpLog(pa.lfoRate, pb.lfoRate, t);
+    for (int i = 0; i < NUM_LFOS - 1; ++i) {
+        p.extraLfos[i].rate = lerpLog(pa.extraLfos[i].rate, pb.extraLfos[i].rate, t);
+    }
+    for (int i = 0; i < static_cast<int>(LfoDestination::NumDestinations); ++i) {
+        p.lfoModAmounts[i] = lerp(pa.lfoModAmounts[i], pb.lfoModAmounts[i], t);
+    }
+    p.wheelModToFreqAAmount = lerp(pa.wheelModToFreqAAmount, pb.wheelModToFreqAAmount, t);
+    p.wheelModToFreqBAmount = lerp(pa.wheelModToFreqBAmount, pb.wheelModToFreqBAmount, t);
+    p.wheelModToPWAAmount = lerp(pa.wheelModToPWAAmount, pb.wheelModToPWAAmount, t);
+    p.wheelModToPWBAmount = lerp(pa.wheelModToPWBAmount, pb.wheelModToPWBAmount, t);
+    p.wheelModToFilterAmount = lerp(pa.wheelModToFilterAmount, pb.wheelModToFilterAmount, t);
+
+    p.unisonDetuneCents = lerp(pa.unisonDetuneCents, pb.unisonDetuneCents, t);
+    p.unisonStereoSpread = lerp(pa.unisonStereoSpread, pb.unisonStereoSpread, t);
+    p.glideTime = lerpLog(pa.glideTime, pb.glideTime, t);
+    p.masterTuneCents = lerp(pa.masterTuneCents, pb.masterTuneCents, t);
+    p.pitchBendRangeSemitones = lerp(pa.pitchBendRangeSemitones, pb.pitchBendRangeSemitones, t);
+
+    // Matrix routes are discrete unless both presets route the same sources
+    // to the same destinations, in which case only the amounts move.
+    bool sameRoutes = pa.numModRoutes == pb.numModRoutes;
+    for (int i = 0; sameRoutes && i < pa.numModRoutes; ++i) {
+        const ModRoute& ra = pa.modRoutes[i];
+        const ModRoute& rb = pb.modRoutes[i];
+        sameRoutes = ra.source == rb.source && ra.destination == rb.destination && ra.viaWheel == rb.viaWheel;
+    }
+    for (int i = 0; sameRoutes && i < pa.numModRoutes; ++i) {
+        p.modRoutes[i].amount = lerp(pa.modRoutes[i].amount, pb.modRoutes[i].amount, t);
+    }
+
+    for (int i = 0; i < NUM_OSC_HARMONICS; ++i) {
+        p.osc1Harmonics[i] = lerp(pa.osc1Harmonics[i], pb.osc1Harmonics[i], t);
+        p.osc2Harmonics[i] = lerp(pa.osc2Harmonics[i], pb.osc2Harmonics[i], t);
+    }
+
+    ReverbSettings& r = out.reverb;
+    r.dryWetMix = lerp(a.reverb.dryWetMix, b.reverb.dryWetMix, t);
+    r.roomSize = lerp(a.reverb.roomSize, b.reverb.roomSize, t);
+    r.damping = lerp(a.reverb.damping, b.reverb.damping, t);
+    r.wetGain = lerp(a.reverb.wetGain, b.reverb.wetGain, t);
+    r.rt60 = lerpLog(a.reverb.rt60, b.reverb.rt60, t);
+    out.modulationWheelValue = lerp(a.modulationWheelValue, b.modulationWheelValue, t);
+}
+
+PresetMorph::PresetMorph(PolySynth& synth, ReverbEffect* reverb) : synth_(synth), reverb_(reverb) {}
+
+void PresetMorph::setPresets(const Preset& a, const Preset& b) {
+    Endpoints& endpoints = endpoints_.writeBuffer();
+    endpoints.a = a;
+    endpoints.b = b;
+    endpoints_.publish();
+}
+
+void PresetMorph::setPosition(float position) {
+    target_.store(std::clamp(position, 0.0f, 1.0f), std::memory_order_relaxed);
+}
+
+int PresetMorph::dispatch(int frame) {
+    if (frame != 0) return INT_MAX;
+    if (endpoints_.update()) {
+        haveEndpoints_ = true;
+        dirty_ = true;
+        reverbStale_ = true;
+    }
+    if (!haveEndpoints_) return INT_MAX;
+
+    const float target = target_.load(std::memory_order_relaxed);
+    if (position_ != target) {
+        const float step = (target - position_) * smoothing_.load(std::memory_order_relaxed);
+        position_ = std::fabs(target - position_) < 1e-4f || std::fabs(step) >= std::fabs(target - position_)
+                        ? target
+                        : position_ + step;
+        dirty_ = true;
+    }
+    if (!dirty_) return INT_MAX;
+    dirty_ = false;
+
+    const Endpoints& endpoints = endpoints_.readBuffer();
+    morphPresets(endpoints.a, endpoints.b, position_, threshold_.load(std::memory_order_relaxed), morphed_);
+    synth_.setRenderedPatch(morphed_.patch);
+    if (reverb_) {
+        // Only what changed: room size, damping and RT60 each recompute the
+        // comb filters. New endpoints resend everything.
+        const ReverbSettings& r = morphed_.reverb;
+        const bool all = reverbStale_;
+        if (all || r.enabled != appliedReverb_.enabled) reverb_->setEnabled(r.enabled);
+        if (all || r.dryWetMix != appliedReverb_.dryWetMix) reverb_->setDryWetMix(r.dryWetMix);
+        if (all || r.wetGain != appliedReverb_.wetGain) reverb_->setWetGain(r.wetGain);
+        if (all || r.roomSize != appliedReverb_.roomSize) reverb_->setRoomSize(r.roomSize);
+        if (all || r.damping != appliedReverb_.damping) reverb_->setDamping(r.damping);
+        if (all || r.rt60 != appliedReverb_.rt60) reverb_->setRT60(r.rt60);
+        appliedReverb_ = r;
+        reverbStale_ = false;
+    }
+    return INT_MAX;
+}
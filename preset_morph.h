@@ -0,0 +1,64 @@
+// synth/preset_morph.h
+#pragma once
+#include "poly_synth.h"
+#include "preset.h"
+#include "triple_buffer.h"
+#include <atomic>
+
+// Blends two presets. Continuous parameters are interpolated: frequencies
+// and times (cutoff, envelope times, LFO rates, glide, RT60) geometrically,
+// everything else linearly, including harmonic amplitudes and reverb
+// settings. Discrete ones (waveforms, filter type, switches) come from `a`
+// below `threshold` and from `b` at or above it.
+void morphPresets(const Preset& a, const Preset& b, float position, float threshold, Preset& out);
+
+// Morphs a synth between two presets at control rate. Pass it as the event
+// source of PolySynth::processBlock(): at the start of every block it moves
+// the position a step towards the target and, if the position moved, hands
+// the blended patch straight to the renderer (PolySynth::setRenderedPatch)
+// and applies the reverb settings. The control-side patch is never touched
+// from the audio thread, and nothing is allocated after construction.
+//
+// The morph owns the sound while it runs: a patch setter used meanwhile
+// takes over until the position next moves. The modulation wheel is left to
+// the player.
+class PresetMorph : public BlockEventSource {
+public:
+    PresetMorph(PolySynth& synth, ReverbEffect* reverb);
+
+    // Control thread. Takes effect at the next block.
+    void setPresets(const Preset& a, const Preset& b);
+
+    // Any thread. 0 is preset a, 1 is preset b.
+    void setPosition(float position);
+    void setPositionFromController(int value) { setPosition(static_cast<float>(value) / 127.0f); }
+    float getPosition() const { return target_.load(std::memory_order_relaxed); }
+
+    void setThreshold(float threshold) { threshold_.store(threshold, std::memory_order_relaxed); }
+    // Fraction of the remaining distance covered per block; 1 jumps.
+    void setSmoothing(float perBlock) { smoothing_.store(perBlock, std::memory_order_relaxed); }
+
+    // Audio thread.
+    int dispatch(int frame) override;
+
+private:
+    struct Endpoints {
+        Preset a;
+        Preset b;
+    };
+
+    PolySynth& synth_;
+    ReverbEffect* reverb_;
+    TripleBuffer<Endpoints> endpoints_;
+    std::atomic<float> target_{0.0f};
+    std::atomic<float> threshold_{0.5f};
+    std::atomic<float> smoothing_{0.25f};
+
+    // Audio thread only.
+    bool haveEndpoints_ = false;
+    bool dirty_ = false;
+    bool reverbStale_ = false;
+    float position_ = 0.0f;
+    Preset morphed_;
+    ReverbSettings appliedReverb_;
+};
@@ -0,0 +1,188 @@
+// synth/preset_watcher.cpp
+#include "preset_watcher.h"
+#include "preset_json.h"
+#include "effects/reverb_effect.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr int POLL_MILLIS = 100; // how quickly stop() is noticed
+
+bool harmonicsDiffer(const float* a, const float* b) {
+    return std::memcmp(a, b, sizeof(float) * NUM_OSC_HARMONICS) != 0;
+}
+
+bool routesDiffer(const Patch& a, const Patch& b) {
+    if (a.numModRoutes != b.numModRoutes) return true;
+    for (int i = 0; i < a.numModRoutes; ++i) {
+        const ModRoute& x = a.modRoutes[i];
+        const ModRoute& y = b.modRoutes[i];
+        if (x.source != y.source || x.destination != y.destination || x.amount != y.amount ||
+            x.viaWheel != y.viaWheel) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool lfoDiffers(const LfoSettings& a, const LfoSettings& b) {
+    return a.rate != b.rate || a.waveform != b.waveform || a.perVoice != b.perVoice;
+}
+
+// Copies everything that differs between `a` and `b` from `b` into `out`
+// and returns how many parameters that was.
+int applyChanges(const Preset& a, const Preset& b, Preset& out) {
+    int changed = 0;
+    for (int i = 0; i < ParamTable::NUM_PARAMS; ++i) {
+        const auto id = static_cast<SynthParams::ParamID>(i);
+        const float value = presetParam(b, id);
+        if (presetParam(a, id) != value) {
+            setPresetParam(out, id, value);
+            ++changed;
+        }
+    }
+    const Patch& pa = a.patch;
+    const Patch& pb = b.patch;
+    Patch& p = out.patch;
+    if (pa.vcoBKeyFollowEnabled != pb.vcoBKeyFollowEnabled) {
+        p.vcoBKeyFollowEnabled = pb.vcoBKeyFollowEnabled;
+        ++changed;
+    }
+    if (pa.unisonVoices != pb.unisonVoices) {
+        p.unisonVoices = pb.unisonVoices;
+        ++changed;
+    }
+    if (pa.pitchBendRangeSemitones != pb.pitchBendRangeSemitones) {
+        p.pitchBendRangeSemitones = pb.pitchBendRangeSemitones;
+        ++changed;
+    }
+    if (harmonicsDiffer(pa.osc1Harmonics, pb.osc1Harmonics)) {
+        std::memcpy(p.osc1Harmonics, pb.osc1Harmonics, sizeof(p.osc1Harmonics));
+        ++changed;
+    }
+    if (harmonicsDiffer(pa.osc2Harmonics, pb.osc2Harmonics)) {
+        std::memcpy(p.osc2Harmonics, pb.osc2Harmonics, sizeof(p.osc2Harmonics));
+        ++changed;
+    }
+    if (routesDiffer(pa, pb)) {
+        std::copy(pb.modRoutes, pb.modRoutes + MAX_MOD_ROUTES, p.modRoutes);
+        p.numModRoutes = pb.numModRoutes;
+        ++changed;
+    }
+    for (int i = 0; i < NUM_LFOS - 1; ++i) {
+        if (lfoDiffers(pa.extraLfos[i], pb.extraLfos[i])) {
+            p.extraLfos[i] = pb.extraLfos[i];
+            ++changed;
+        }
+    }
+    return changed;
+}
+
+} // namespace
+
+PresetWatcher::PresetWatcher(PolySynth& synth, ReverbEffect* reverb, const std::string& path,
+                             const Preset& current)
+    : synth_(synth), reverb_(reverb), path_(path), pending_(current), appliedReverb_(current.reverb),
+      appliedWheel_(current.modulationWheelValue), loaded_(current), built_(current) {
+    const size_t slash = path.find_last_of('/');
+    directory_ = slash == std::string::npos ? "." : path.substr(0, slash == 0 ? 1 : slash);
+    fileName_ = slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+PresetWatcher::~PresetWatcher() {
+    stop();
+}
+
+bool PresetWatcher::start(std::string& error) {
+    if (running_.load()) return true;
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        error = std::string("inotify_init1: ") + std::strerror(errno);
+        return false;
+    }
+    // The directory rather than the file, so editors that save by renaming a
+    // new file over the old one are seen too.
+    if (inotify_add_watch(inotifyFd_, directory_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        error = "cannot watch " + directory_ + ": " + std::strerror(errno);
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+        return false;
+    }
+    running_.store(true);
+    thread_ = std::thread(&PresetWatcher::watchLoop, this);
+    return true;
+}
+
+void PresetWatcher::stop() {
+    if (!running_.exchange(false)) return;
+    if (thread_.joinable()) thread_.join();
+    close(inotifyFd_);
+    inotifyFd_ = -1;
+}
+
+void PresetWatcher::watchLoop() {
+    alignas(inotify_event) char buffer[4096];
+    while (running_.load()) {
+        pollfd fd = {inotifyFd_, POLLIN, 0};
+        if (poll(&fd, 1, POLL_MILLIS) <= 0) continue;
+        bool saved = false;
+        ssize_t bytes;
+        while ((bytes = read(inotifyFd_, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + bytes;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(p);
+                if (event->len > 0 && fileName_ == event->name) saved = true;
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (saved) reload();
+    }
+}
+
+void PresetWatcher::reload() {
+    Preset preset;
+    std::vector<std::string> errors;
+    const bool ok = compilePresetFile(path_, preset, errors);
+    for (const auto& error : errors) {
+        std::cerr << path_ << ": " << error << std::endl;
+    }
+    if (!ok) {
+        std::cerr << path_ << ": not reloaded, keeping the current sound" << std::endl;
+        return;
+    }
+    const int changed = applyChanges(loaded_, preset, built_);
+    loaded_ = preset;
+    if (changed == 0) return;
+    pending_.writeBuffer() = built_;
+    pending_.publish();
+    std::cout << "Reloaded " << path_ << ": " << changed << " parameter(s) changed" << std::endl;
+}
+
+int PresetWatcher::dispatch(int frame) {
+    if (frame != 0 || !pending_.update()) return INT_MAX;
+    const Preset& next = pending_.readBuffer();
+    synth_.setRenderedPatch(next.patch);
+    if (next.modulationWheelValue != appliedWheel_) {
+        synth_.setModulationWheelValue(next.modulationWheelValue);
+        appliedWheel_ = next.modulationWheelValue;
+    }
+    if (reverb_) {
+        // Room size, damping and RT60 each recompute the comb filters.
+        const ReverbSettings& r = next.reverb;
+        if (r.enabled != appliedReverb_.enabled) reverb_->setEnabled(r.enabled);
+        if (r.dryWetMix != appliedReverb_.dryWetMix) reverb_->setDryWetMix(r.dryWetMix);
+        if (r.wetGain != appliedReverb_.wetGain) reverb_->setWetGain(r.wetGain);
+        if (r.roomSize != appliedReverb_.roomSize) reverb_->setRoomSize(r.roomSize);
+        if (r.damping != appliedReverb_.damping) reverb_->setDamping(r.damping);
+        if (r.rt60 != appliedReverb_.rt60) reverb_->setRT60(r.rt60);
+    }
+    appliedReverb_ = next.reverb;
+    return INT_MAX;
+}
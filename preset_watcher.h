@@ -0,0 +1,63 @@
+// synth/preset_watcher.h
+#pragma once
+#include "param_table.h"
+#include "poly_synth.h"
+#include "preset.h"
+#include "triple_buffer.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Reloads a JSON preset whenever its file is saved. A background thread
+// waits on inotify, recompiles the file and logs every value it had to
+// reject or clamp; a file that does not parse leaves the sound as it is.
+//
+// The watcher thread diffs the new file against the one it loaded last and
+// applies only the parameters that changed to its copy of the sound, then
+// hands the finished preset over. The audio thread picks it up at the start
+// of its next block (pass the watcher as the event source of
+// PolySynth::processBlock) and swaps the patch in with
+// PolySynth::setRenderedPatch, so every change lands at once and the
+// control-side patch is never touched. Reverb settings and the wheel are
+// sent only when they changed. The audio thread never waits on the watcher
+// and allocates nothing. Like PresetMorph, the watcher owns the sound.
+class PresetWatcher : public BlockEventSource {
+public:
+    // `current` is what the synth was loaded with, the base of the first
+    // diff. `reverb` may be null.
+    PresetWatcher(PolySynth& synth, ReverbEffect* reverb, const std::string& path, const Preset& current);
+    ~PresetWatcher();
+
+    PresetWatcher(const PresetWatcher&) = delete;
+    PresetWatcher& operator=(const PresetWatcher&) = delete;
+
+    bool start(std::string& error);
+    void stop();
+
+    // Audio thread.
+    int dispatch(int frame) override;
+
+private:
+    void watchLoop();
+    void reload();
+
+    PolySynth& synth_;
+    ReverbEffect* reverb_;
+    std::string path_;
+    std::string directory_;
+    std::string fileName_;
+    TripleBuffer<Preset> pending_;
+
+    // Audio thread only.
+    ReverbSettings appliedReverb_;
+    float appliedWheel_;
+
+    // Watcher thread only: the file as last loaded, and the sound built
+    // from the diffs.
+    Preset loaded_;
+    Preset built_;
+
+    int inotifyFd_ = -1;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
@@ -0,0 +1,100 @@
+// synth/psbank.cpp
+// Builds and inspects preset banks (see preset_bank.h).
+//
+//   ./psbank build <preset_dir> <out.psb>
+//       Compiles every *.json in <preset_dir>, sorted by file name, into a
+//       bank. Program numbers follow that order and names are the file names
+//       without ".json". Validation problems are reported per preset; presets
+//       that cannot be compiled at all are left out.
+//   ./psbank list <bank.psb>
+//       Prints program numbers and names, and checks every preset's checksum
+//       and values; bad entries are listed with the reason.
+//
+// Build with `make psbank`.
+#include "preset_bank.h"
+#include "preset_json.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+int build(const std::string& directory, const std::string& outPath) {
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json") files.push_back(entry.path());
+    }
+    if (ec) {
+        std::cerr << "Cannot read " << directory << ": " << ec.message() << std::endl;
+        return 1;
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<std::pair<std::string, Preset>> presets;
+    int withWarnings = 0;
+    int skipped = 0;
+    for (const auto& file : files) {
+        const std::string name = file.stem().string();
+        if (name.empty() || name.size() >= PresetBankFile::NAME_BYTES) {
+            std::cerr << file.string() << ": name must be 1 to " << PresetBankFile::NAME_BYTES - 1
+                      << " characters, skipped" << std::endl;
+            ++skipped;
+            continue;
+        }
+        Preset preset;
+        std::vector<std::string> errors;
+        const bool ok = compilePresetFile(file.string(), preset, errors);
+        for (const auto& error : errors) {
+            std::cerr << file.string() << ": " << error << std::endl;
+        }
+        if (!ok) {
+            std::cerr << file.string() << ": skipped" << std::endl;
+            ++skipped;
+            continue;
+        }
+        if (!errors.empty()) ++withWarnings;
+        presets.emplace_back(name, preset);
+    }
+
+    std::string error;
+    if (!PresetBankFile::write(presets, outPath, error)) {
+        std::cerr << "Could not write bank: " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << presets.size() << " presets to " << outPath << " (" << withWarnings
+              << " with warnings, " << skipped << " skipped)" << std::endl;
+    return skipped > 0 ? 2 : 0;
+}
+
+int list(const std::string& path) {
+    PresetBank bank;
+    std::string error;
+    std::vector<std::string> skipped;
+    if (!bank.open(path, error, skipped)) {
+        std::cerr << "Could not open bank " << path << ": " << error << std::endl;
+        return 1;
+    }
+    int corrupt = 0;
+    for (int program = 0; program < bank.size(); ++program) {
+        const bool ok = bank.verify(program, error);
+        if (!ok) ++corrupt;
+        std::cout << program / 128 << ":" << program % 128 << "\t"
+                  << (ok ? std::string(bank.getName(program)) : error) << std::endl;
+    }
+    return corrupt > 0 ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::string command = argc > 1 ? argv[1] : "";
+    if (command == "build" && argc == 4) return build(argv[2], argv[3]);
+    if (command == "list" && argc == 3) return list(argv[2]);
+    std::cerr << "Usage: " << argv[0] << " build <preset_dir> <out.psb>\n"
+              << "       " << argv[0] << " list <bank.psb>" << std::endl;
+    return 1;
+}
@@ -0,0 +1,113 @@
+// synth/quality_governor.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+// What each quality tier trades away. Tier 0 is full quality and renders
+// exactly as the synth does with the governor disabled.
+struct QualitySettings {
+    int maxOversampling;  // cap on the per-voice oscillator factor
+    int controlInterval;  // samples between pitch/filter coefficient updates
+    int additivePartials; // partials written per additive frame
+};
+
+// Watches how long each audio block takes to render against the time it
+// represents and steps the quality tier down before the callback overruns,
+// then back up once load has stayed low for a while. Adaptation is off until
+// setAdaptive(true): offline renders have no deadline and should not lose
+// quality to a busy machine.
+//
+// onBlock() runs on the audio thread; the getters and setters are safe to
+// call from any thread.
+class QualityGovernor {
+public:
+    static constexpr int NUM_TIERS = 4;
+
+    // Smoothed load above which the tier drops, and single-block load that
+    // drops it immediately (the next block would likely miss its deadline).
+    static constexpr float STEP_DOWN_LOAD = 0.70f;
+    static constexpr float PANIC_LOAD = 0.90f;
+    // Smoothed load that has to hold for STEP_UP_HOLD_SECONDS before the tier
+    // rises again. The gap to STEP_DOWN_LOAD is the hysteresis.
+    static constexpr float STEP_UP_LOAD = 0.40f;
+    static constexpr double STEP_UP_HOLD_SECONDS = 2.0;
+    // Minimum time after start-up or any change before stepping down, so the
+    // smoothed load reflects the current tier and one slow block cannot
+    // cascade through several tiers.
+    static constexpr double COOLDOWN_SECONDS = 0.25;
+    static constexpr double LOAD_TIME_CONSTANT_SECONDS = 0.1;
+
+    static const QualitySettings& settingsFor(int tier) {
+        static constexpr QualitySettings TIERS[NUM_TIERS] = {
+            {4, 1, 256},
+            {2, 4, 128},
+            {1, 16, 64},
+            {1, 32, 32},
+        };
+        return TIERS[std::clamp(tier, 0, NUM_TIERS - 1)];
+    }
+
+    void setAdaptive(bool enabled) { adaptive_.store(enabled, std::memory_order_relaxed); }
+    bool isAdaptive() const { return adaptive_.load(std::memory_order_relaxed); }
+
+    // Requests a tier; applied at the next block. With adaptation on, the
+    // governor carries on from there.
+    void requestTier(int tier) {
+        requestedTier_.store(std::clamp(tier, 0, NUM_TIERS - 1), std::memory_order_relaxed);
+    }
+
+    int getTier() const { return tier_.load(std::memory_order_relaxed); }
+    unsigned getTransitions() const { return transitions_.load(std::memory_order_relaxed); }
+    float getLoad() const { return load_.load(std::memory_order_relaxed); }
+    float getPeakLoad() const { return peakLoad_.load(std::memory_order_relaxed); }
+
+    // Returns true when the tier changed and the caller has to apply it.
+    bool onBlock(double renderSeconds, double blockSeconds) {
+        if (blockSeconds <= 0.0) return false;
+        const float blockLoad = static_cast<float>(renderSeconds / blockSeconds);
+        const float alpha = static_cast<float>(1.0 - std::exp(-blockSeconds / LOAD_TIME_CONSTANT_SECONDS));
+        smoothedLoad_ += alpha * (blockLoad - smoothedLoad_);
+        load_.store(smoothedLoad_, std::memory_order_relaxed);
+        if (blockLoad > peakLoad_.load(std::memory_order_relaxed)) {
+            peakLoad_.store(blockLoad, std::memory_order_relaxed);
+        }
+        sinceChange_ += blockSeconds;
+
+        int tier = tier_.load(std::memory_order_relaxed);
+        int next = tier;
+        const int requested = requestedTier_.exchange(-1, std::memory_order_relaxed);
+        if (requested >= 0) {
+            next = requested;
+        } else if (adaptive_.load(std::memory_order_relaxed)) {
+            if (tier < NUM_TIERS - 1 && sinceChange_ >= COOLDOWN_SECONDS &&
+                (blockLoad > PANIC_LOAD || smoothedLoad_ > STEP_DOWN_LOAD)) {
+                next = tier + 1;
+            }
+            lowLoadSeconds_ = (smoothedLoad_ < STEP_UP_LOAD) ? lowLoadSeconds_ + blockSeconds : 0.0;
+            if (tier > 0 && lowLoadSeconds_ >= STEP_UP_HOLD_SECONDS) {
+                next = tier - 1;
+            }
+        }
+        if (next == tier) return false;
+
+        tier_.store(next, std::memory_order_relaxed);
+        transitions_.fetch_add(1, std::memory_order_relaxed);
+        sinceChange_ = 0.0;
+        lowLoadSeconds_ = 0.0;
+        return true;
+    }
+
+private:
+    std::atomic<bool> adaptive_{false};
+    std::atomic<int> requestedTier_{-1};
+    std::atomic<int> tier_{0};
+    std::atomic<unsigned> transitions_{0};
+    std::atomic<float> load_{0.0f};
+    std::atomic<float> peakLoad_{0.0f};
+
+    // Audio thread only.
+    float smoothedLoad_ = 0.0f;
+    double sinceChange_ = 0.0;
+    double lowLoadSeconds_ = 0.0;
+};
@@ -0,0 +1,17 @@
+// synth/random_seed.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <random>
+
+// Cheap, distinct seeds for the per-instance noise and drift generators.
+// std::random_device is only read once per process; every later call just
+// advances a SplitMix64 sequence, so constructing many voices stays fast.
+inline uint32_t nextRandomSeed() {
+    static std::atomic<uint64_t> state{
+        (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}()};
+    uint64_t z = state.fetch_add(0x9E3779B97F4A7C15ull, std::memory_order_relaxed) + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<uint32_t>(z ^ (z >> 31));
+}
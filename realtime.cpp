@@ -0,0 +1,103 @@
+// synth/realtime.cpp
+#include "realtime.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+constexpr size_t HEAP_RESERVE_BYTES = 16 * 1024 * 1024;
+constexpr size_t STACK_PREFAULT_BYTES = 256 * 1024;
+
+#ifdef __linux__
+// Touching the pages in a large stack frame maps them now rather than on the
+// first deep call during a render.
+__attribute__((noinline)) void prefaultStack() {
+    unsigned char stack[STACK_PREFAULT_BYTES];
+    std::memset(stack, 0, sizeof(stack));
+    asm volatile("" : : "r"(stack) : "memory"); // keep the writes
+}
+#endif
+
+} // namespace
+
+namespace Realtime {
+
+bool lockMemory(std::string& error) {
+#ifdef __linux__
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        error = std::string("mlockall: ") + std::strerror(errno) + " (check RLIMIT_MEMLOCK)";
+        return false;
+    }
+    // Freed memory stays in the heap instead of being trimmed or unmapped, so
+    // the reserve below keeps serving allocations without new page faults.
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    char* reserve = static_cast<char*>(std::malloc(HEAP_RESERVE_BYTES));
+    if (reserve) {
+        for (size_t i = 0; i < HEAP_RESERVE_BYTES; i += 4096) {
+            reserve[i] = 0;
+        }
+        std::free(reserve);
+    }
+    return true;
+#else
+    error = "memory locking is not supported on this platform";
+    return false;
+#endif
+}
+
+bool configureCurrentThread(const RealtimeConfig& config, std::string& error) {
+#ifdef __linux__
+    bool ok = true;
+    if (config.priority > 0) {
+        sched_param param{};
+        param.sched_priority = config.priority;
+        const int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (rc != 0) {
+            error = std::string("SCHED_FIFO priority ") + std::to_string(config.priority) + ": " +
+                    std::strerror(rc) + " (check RLIMIT_RTPRIO)";
+            ok = false;
+        }
+    }
+    if (config.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(config.cpu, &cpus);
+        const int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (rc != 0) {
+            if (!ok) error += "; ";
+            error += std::string("pinning to CPU ") + std::to_string(config.cpu) + ": " + std::strerror(rc);
+            ok = false;
+        }
+    }
+    prefaultStack();
+    return ok;
+#else
+    if (config.priority > 0 || config.cpu >= 0) {
+        error = "real-time thread configuration is not supported on this platform";
+        return false;
+    }
+    return true;
+#endif
+}
+
+long currentThreadPageFaults() {
+#ifdef __linux__
+    rusage usage{};
+    if (getrusage(RUSAGE_THREAD, &usage) != 0) return 0;
+    return usage.ru_minflt + usage.ru_majflt;
+#else
+    return 0;
+#endif
+}
+
+} // namespace Realtime
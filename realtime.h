@@ -0,0 +1,57 @@
+// synth/realtime.h
+#pragma once
+#include <atomic>
+#include <string>
+
+// Scheduling for a thread that renders audio. Applied by the thread itself
+// (see Realtime::configureCurrentThread) because PortAudio owns the callback
+// thread.
+struct RealtimeConfig {
+    int priority = 0; // SCHED_FIFO priority 1..99; 0 leaves the thread's scheduling alone
+    int cpu = -1;     // core to pin the thread to; -1 lets it run anywhere
+};
+
+namespace Realtime {
+
+// Locks all current and future pages of the process into RAM, stops the heap
+// from handing memory back to the OS and prefaults a heap reserve, so later
+// allocations and first touches do not fault. Call once, after the synth and
+// its effects have been built.
+bool lockMemory(std::string& error);
+
+// Applies priority and affinity to the calling thread and prefaults its stack.
+bool configureCurrentThread(const RealtimeConfig& config, std::string& error);
+
+// Minor plus major page faults the calling thread has taken so far, or 0
+// where the platform cannot tell.
+long currentThreadPageFaults();
+
+} // namespace Realtime
+
+// Counts page faults a render thread takes while rendering, to verify at run
+// time that locking and prefaulting worked. begin()/end() bracket the render
+// on that thread; the getters can be read from anywhere.
+class PageFaultMonitor {
+public:
+    void begin() { startFaults_ = Realtime::currentThreadPageFaults(); }
+    void end() {
+        const long faults = Realtime::currentThreadPageFaults() - startFaults_;
+        if (faults > 0) {
+            faults_.fetch_add(static_cast<unsigned long>(faults), std::memory_order_relaxed);
+            faultingBlocks_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void reset() {
+        faults_.store(0, std::memory_order_relaxed);
+        faultingBlocks_.store(0, std::memory_order_relaxed);
+    }
+
+    unsigned long getFaults() const { return faults_.load(std::memory_order_relaxed); }
+    unsigned getFaultingBlocks() const { return faultingBlocks_.load(std::memory_order_relaxed); }
+
+private:
+    long startFaults_ = 0;
+    std::atomic<unsigned long> faults_{0};
+    std::atomic<unsigned> faultingBlocks_{0};
+};
@@ -0,0 +1,95 @@
+// synth/render_ahead.cpp
+#include "render_ahead.h"
+#include "poly_synth.h"
+#include <algorithm>
+#include <chrono>
+
+RenderAhead::RenderAhead(PolySynth& synth, int blockFrames, int lookaheadBlocks,
+                         const RealtimeConfig& threadConfig)
+    : synth_(synth),
+      blockFrames_(std::max(1, blockFrames)),
+      lookaheadFrames_(std::max(1, lookaheadBlocks) * std::max(1, blockFrames)),
+      ring_(2 * static_cast<size_t>(lookaheadFrames_)),
+      block_(2 * static_cast<size_t>(blockFrames_)),
+      threadConfig_(threadConfig),
+      minFillFrames_(lookaheadFrames_) {}
+
+RenderAhead::~RenderAhead() {
+    stop();
+}
+
+bool RenderAhead::start() {
+    if (running_.load()) return threadConfigOk_;
+    while (renderBlockIfRoom()) {
+    }
+    resetStats();
+    pageFaults_.reset(); // the prefill ran on this thread, not the render thread
+    threadConfigured_.store(false);
+    running_.store(true);
+    thread_ = std::thread(&RenderAhead::renderLoop, this);
+    while (!threadConfigured_.load()) {
+        std::this_thread::yield();
+    }
+    return threadConfigOk_;
+}
+
+void RenderAhead::stop() {
+    running_.store(false);
+    if (thread_.joinable()) thread_.join();
+}
+
+bool RenderAhead::renderBlockIfRoom() {
+    if (ring_.size() / 2 + static_cast<size_t>(blockFrames_) > static_cast<size_t>(lookaheadFrames_)) {
+        return false;
+    }
+    pageFaults_.begin();
+    synth_.processBlock(block_.data(), blockFrames_);
+    pageFaults_.end();
+    ring_.write(block_.data(), block_.size());
+    blocksRendered_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Tops the ring up whenever a block's worth of room has opened, otherwise
+// sleeps for a fraction of a block so a drained ring is noticed quickly.
+void RenderAhead::renderLoop() {
+    threadConfigError_.clear();
+    threadConfigOk_ = Realtime::configureCurrentThread(threadConfig_, threadConfigError_);
+    threadConfigured_.store(true);
+
+    const auto idle = std::chrono::microseconds(
+        static_cast<long long>(250000.0 * blockFrames_ / synth_.getSampleRate()));
+    while (running_.load(std::memory_order_relaxed)) {
+        if (!renderBlockIfRoom()) {
+            std::this_thread::sleep_for(idle);
+        }
+    }
+}
+
+void RenderAhead::read(float* interleavedStereo, int numFrames) {
+    const int fill = static_cast<int>(ring_.size() / 2);
+    if (fill < minFillFrames_.load(std::memory_order_relaxed)) {
+        minFillFrames_.store(fill, std::memory_order_relaxed);
+    }
+    const size_t wanted = 2 * static_cast<size_t>(numFrames);
+    const size_t got = ring_.read(interleavedStereo, wanted);
+    if (got < wanted) {
+        std::fill(interleavedStereo + got, interleavedStereo + wanted, 0.0f);
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+RenderAheadStats RenderAhead::getStats() const {
+    RenderAheadStats stats;
+    stats.lookaheadFrames = lookaheadFrames_;
+    stats.fillFrames = static_cast<int>(ring_.size() / 2);
+    stats.minFillFrames = minFillFrames_.load(std::memory_order_relaxed);
+    stats.underruns = underruns_.load(std::memory_order_relaxed);
+    stats.blocksRendered = blocksRendered_.load(std::memory_order_relaxed);
+    stats.renderPageFaults = pageFaults_.getFaults();
+    return stats;
+}
+
+void RenderAhead::resetStats() {
+    minFillFrames_.store(lookaheadFrames_, std::memory_order_relaxed);
+}
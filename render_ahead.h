@@ -0,0 +1,71 @@
+// synth/render_ahead.h
+#pragma once
+#include "realtime.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+class PolySynth;
+
+struct RenderAheadStats {
+    int lookaheadFrames = 0;
+    int fillFrames = 0;      // rendered audio waiting in the ring right now
+    int minFillFrames = 0;   // lowest fill seen by the audio callback since resetStats()
+    unsigned underruns = 0;  // callbacks that found the ring short
+    unsigned long long blocksRendered = 0;
+    unsigned long renderPageFaults = 0; // taken by the render thread while rendering
+};
+
+// Renders the synth on its own thread up to `lookaheadBlocks` blocks ahead of
+// the audio callback, which then only copies from a lock-free ring. An
+// expensive block (preset load, voice storm) is absorbed as long as the ring
+// does not drain. The price is lookahead of added latency on note events, so
+// this suits playback rather than live playing.
+class RenderAhead {
+public:
+    RenderAhead(PolySynth& synth, int blockFrames, int lookaheadBlocks,
+                const RealtimeConfig& threadConfig = RealtimeConfig());
+    ~RenderAhead();
+
+    RenderAhead(const RenderAhead&) = delete;
+    RenderAhead& operator=(const RenderAhead&) = delete;
+
+    // start() fills the ring before returning, so the first callbacks do not
+    // underrun. It returns false if the render thread could not be given its
+    // real-time configuration (it still runs; see getThreadConfigError()).
+    bool start();
+    void stop();
+
+    // Audio callback side: copies interleaved stereo frames out of the ring,
+    // padding with silence if it runs short.
+    void read(float* interleavedStereo, int numFrames);
+
+    RenderAheadStats getStats() const;
+    void resetStats();
+    const std::string& getThreadConfigError() const { return threadConfigError_; }
+
+private:
+    void renderLoop();
+    bool renderBlockIfRoom();
+
+    PolySynth& synth_;
+    int blockFrames_;
+    int lookaheadFrames_;
+    SpscRing<float> ring_;
+    std::vector<float> block_;
+
+    RealtimeConfig threadConfig_;
+    std::string threadConfigError_;
+    std::atomic<bool> threadConfigured_{false};
+    bool threadConfigOk_ = true;
+    PageFaultMonitor pageFaults_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::atomic<int> minFillFrames_;
+    std::atomic<unsigned> underruns_{0};
+    std::atomic<unsigned long long> blocksRendered_{0};
+};
@@ -0,0 +1,87 @@
+// synth/render_pool.cpp
+#include "render_pool.h"
+#include <algorithm>
+
+namespace {
+
+constexpr int SPINS_BEFORE_YIELD = 2000;
+
+constexpr uint64_t generationOf(uint64_t claim) { return claim >> 48; }
+constexpr int countOf(uint64_t claim) { return static_cast<int>((claim >> 32) & 0xFFFF); }
+constexpr int indexOf(uint64_t claim) { return static_cast<int>(claim & 0xFFFFFFFF); }
+
+} // namespace
+
+RenderPool::RenderPool(int numWorkers, const RealtimeConfig& workerConfig) {
+    numWorkers = std::max(0, numWorkers);
+    workerErrors_.resize(numWorkers);
+    workers_.reserve(numWorkers);
+    for (int i = 0; i < numWorkers; ++i) {
+        RealtimeConfig config = workerConfig;
+        if (config.cpu >= 0) config.cpu += i;
+        workers_.emplace_back(&RenderPool::workerLoop, this, i, config);
+    }
+    while (workersConfigured_.load() < numWorkers) {
+        std::this_thread::yield();
+    }
+    for (const auto& error : workerErrors_) {
+        if (error.empty()) continue;
+        if (!workerConfigError_.empty()) workerConfigError_ += "; ";
+        workerConfigError_ += error;
+    }
+}
+
+RenderPool::~RenderPool() {
+    running_.store(false);
+    batchSignal_.notify();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void RenderPool::run(int count, TaskFn fn, void* context) {
+    count = std::min(count, MAX_TASKS);
+    if (count <= 0) return;
+    fn_ = fn;
+    context_ = context;
+    remaining_.store(count, std::memory_order_relaxed);
+    generation_ = (generation_ + 1) & 0xFFFF;
+    claim_.store((generation_ << 48) | (static_cast<uint64_t>(count) << 32), std::memory_order_release);
+    batchSignal_.notify();
+
+    drain(generation_);
+    for (int spins = 0; remaining_.load(std::memory_order_acquire) != 0; ++spins) {
+        if (spins >= SPINS_BEFORE_YIELD) std::this_thread::yield();
+    }
+}
+
+void RenderPool::drain(uint64_t generation) {
+    uint64_t claim = claim_.load(std::memory_order_acquire);
+    for (;;) {
+        if (generationOf(claim) != generation || indexOf(claim) >= countOf(claim)) return;
+        if (!claim_.compare_exchange_weak(claim, claim + 1, std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+            continue;
+        }
+        fn_(context_, indexOf(claim));
+        remaining_.fetch_sub(1, std::memory_order_release);
+        claim = claim_.load(std::memory_order_acquire);
+    }
+}
+
+void RenderPool::workerLoop(int worker, RealtimeConfig config) {
+    Realtime::configureCurrentThread(config, workerErrors_[worker]);
+    workersConfigured_.fetch_add(1);
+
+    uint64_t seen = generationOf(claim_.load(std::memory_order_acquire));
+    for (;;) {
+        uint64_t generation = seen;
+        batchSignal_.wait([this, seen, &generation] {
+            generation = generationOf(claim_.load(std::memory_order_acquire));
+            return generation != seen || !running_.load(std::memory_order_relaxed);
+        });
+        if (generation == seen) return; // shutting down
+        seen = generation;
+        drain(generation);
+    }
+}
@@ -0,0 +1,63 @@
+// synth/render_pool.h
+#pragma once
+#include "realtime.h"
+#include "worker_signal.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run the independent pieces of one audio
+// block (synth parts, instances) in parallel. parallelFor() hands out task
+// indices through one atomic word, takes tasks itself as well and returns
+// when all are done; nothing allocates or blocks, so it can be called from
+// the audio callback. Idle workers wait on a WorkerSignal: a short spin, then
+// sleep until the next parallelFor().
+class RenderPool {
+public:
+    static constexpr int MAX_TASKS = 0xFFFF;
+
+    // With workerConfig.cpu set, worker i is pinned to core cpu + i.
+    explicit RenderPool(int numWorkers, const RealtimeConfig& workerConfig = RealtimeConfig());
+    ~RenderPool();
+
+    RenderPool(const RenderPool&) = delete;
+    RenderPool& operator=(const RenderPool&) = delete;
+
+    int getNumWorkers() const { return static_cast<int>(workers_.size()); }
+    // Empty unless a worker could not be given its real-time configuration.
+    const std::string& getWorkerConfigError() const { return workerConfigError_; }
+
+    // Calls fn(i) for every i in [0, count), spread over the workers and the
+    // calling thread. Only one thread may call this at a time.
+    template <typename Fn>
+    void parallelFor(int count, Fn& fn) {
+        run(count, [](void* context, int index) { (*static_cast<Fn*>(context))(index); }, &fn);
+    }
+
+private:
+    using TaskFn = void (*)(void* context, int index);
+
+    void run(int count, TaskFn fn, void* context);
+    void workerLoop(int worker, RealtimeConfig config);
+    // Claims and runs tasks of the batch `generation` until none are left.
+    void drain(uint64_t generation);
+
+    // Current batch as generation (16 bits) | task count (16 bits) | next
+    // task index (32 bits). Tasks are claimed by compare-and-swap against
+    // the generation a thread woke up for, so a late worker can never take
+    // (or skip) a task of a newer batch.
+    std::atomic<uint64_t> claim_{0};
+    std::atomic<int> remaining_{0};
+    WorkerSignal batchSignal_;
+    TaskFn fn_ = nullptr;
+    void* context_ = nullptr;
+    uint64_t generation_ = 0;
+
+    std::string workerConfigError_;
+    std::vector<std::string> workerErrors_;
+    std::atomic<int> workersConfigured_{0};
+    std::atomic<bool> running_{true};
+    std::vector<std::thread> workers_;
+};
@@ -0,0 +1,218 @@
+// synth/rt_check.cpp
+#include "rt_check.h"
+
+#ifdef SYNTH_RT_CHECK
+
+// The interposers below replace libc entry points, which the fortified
+// inline wrappers would clash with.
+#undef _FORTIFY_SOURCE
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+// glibc's own allocator entry points, so malloc and friends can be wrapped
+// without dlsym (which itself allocates).
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+namespace {
+
+enum Kind { ALLOCATION, DEALLOCATION, MUTEX_LOCK, BLOCKING_CALL, NUM_KINDS };
+const char* const KIND_NAMES[NUM_KINDS] = {"allocation", "deallocation", "mutex lock", "blocking call"};
+
+constexpr int MAX_FRAMES = 32;
+constexpr int MAX_SITES = 256;
+
+// One distinct (kind, call, stack) combination. The table is fixed-size so
+// recording never allocates.
+struct Site {
+    Kind kind;
+    const char* call;
+    uint64_t hash;
+    void* frames[MAX_FRAMES];
+    int depth;
+    unsigned long count;
+};
+
+Site sites[MAX_SITES];
+int numSites = 0;
+unsigned long droppedSites = 0;
+std::atomic_flag sitesLock = ATOMIC_FLAG_INIT;
+
+thread_local int renderDepth = 0;
+thread_local bool recording = false;
+
+void record(Kind kind, const char* call) {
+    if (renderDepth == 0 || recording) return;
+    recording = true;
+
+    void* frames[MAX_FRAMES];
+    const int depth = backtrace(frames, MAX_FRAMES);
+    uint64_t hash = 1469598103934665603ull ^ static_cast<uint64_t>(kind);
+    for (int i = 0; i < depth; ++i) {
+        hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i])) * 1099511628211ull;
+    }
+
+    while (sitesLock.test_and_set(std::memory_order_acquire)) {
+    }
+    int found = -1;
+    for (int i = 0; i < numSites; ++i) {
+        if (sites[i].hash == hash && sites[i].kind == kind && std::strcmp(sites[i].call, call) == 0) {
+            found = i;
+            break;
+        }
+    }
+    if (found < 0 && numSites < MAX_SITES) {
+        found = numSites++;
+        Site& site = sites[found];
+        site.kind = kind;
+        site.call = call;
+        site.hash = hash;
+        site.depth = depth;
+        std::memcpy(site.frames, frames, sizeof(void*) * depth);
+        site.count = 0;
+    }
+    if (found >= 0) {
+        ++sites[found].count;
+    } else {
+        ++droppedSites;
+    }
+    sitesLock.clear(std::memory_order_release);
+
+    recording = false;
+}
+
+// backtrace() loads the unwinder (and allocates) the first time it runs;
+// get that over with before any render starts.
+struct UnwinderWarmup {
+    UnwinderWarmup() {
+        void* frames[2];
+        backtrace(frames, 2);
+    }
+} unwinderWarmup;
+
+template <typename Fn>
+Fn nextSymbol(Fn, const char* name) {
+    return reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+}
+
+} // namespace
+
+// Looks up the libc definition the first time through and forwards to it.
+#define RT_CHECK_FORWARD(kind, name, ...)                     \
+    record(kind, #name);                                      \
+    static const auto real = nextSymbol(&::name, #name);      \
+    return real(__VA_ARGS__)
+
+extern "C" {
+
+void* malloc(size_t size) {
+    record(ALLOCATION, "malloc");
+    return __libc_malloc(size);
+}
+void* calloc(size_t count, size_t size) {
+    record(ALLOCATION, "calloc");
+    return __libc_calloc(count, size);
+}
+void* realloc(void* ptr, size_t size) {
+    record(ALLOCATION, "realloc");
+    return __libc_realloc(ptr, size);
+}
+void* memalign(size_t alignment, size_t size) {
+    record(ALLOCATION, "memalign");
+    return __libc_memalign(alignment, size);
+}
+void* aligned_alloc(size_t alignment, size_t size) {
+    record(ALLOCATION, "aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    record(ALLOCATION, "posix_memalign");
+    *out = __libc_memalign(alignment, size);
+    return *out ? 0 : ENOMEM;
+}
+void free(void* ptr) {
+    if (ptr) record(DEALLOCATION, "free");
+    __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) { RT_CHECK_FORWARD(MUTEX_LOCK, pthread_mutex_lock, mutex); }
+int pthread_mutex_trylock(pthread_mutex_t* mutex) { RT_CHECK_FORWARD(MUTEX_LOCK, pthread_mutex_trylock, mutex); }
+int pthread_rwlock_rdlock(pthread_rwlock_t* lock) { RT_CHECK_FORWARD(MUTEX_LOCK, pthread_rwlock_rdlock, lock); }
+int pthread_rwlock_wrlock(pthread_rwlock_t* lock) { RT_CHECK_FORWARD(MUTEX_LOCK, pthread_rwlock_wrlock, lock); }
+
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+    RT_CHECK_FORWARD(BLOCKING_CALL, pthread_cond_wait, cond, mutex);
+}
+int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime) {
+    RT_CHECK_FORWARD(BLOCKING_CALL, pthread_cond_timedwait, cond, mutex, abstime);
+}
+int pthread_join(pthread_t thread, void** result) { RT_CHECK_FORWARD(BLOCKING_CALL, pthread_join, thread, result); }
+int nanosleep(const struct timespec* request, struct timespec* remaining) {
+    RT_CHECK_FORWARD(BLOCKING_CALL, nanosleep, request, remaining);
+}
+int clock_nanosleep(clockid_t clock, int flags, const struct timespec* request, struct timespec* remaining) {
+    RT_CHECK_FORWARD(BLOCKING_CALL, clock_nanosleep, clock, flags, request, remaining);
+}
+int usleep(useconds_t usec) { RT_CHECK_FORWARD(BLOCKING_CALL, usleep, usec); }
+ssize_t read(int fd, void* buf, size_t count) { RT_CHECK_FORWARD(BLOCKING_CALL, read, fd, buf, count); }
+ssize_t write(int fd, const void* buf, size_t count) { RT_CHECK_FORWARD(BLOCKING_CALL, write, fd, buf, count); }
+FILE* fopen(const char* path, const char* mode) { RT_CHECK_FORWARD(BLOCKING_CALL, fopen, path, mode); }
+int fclose(FILE* stream) { RT_CHECK_FORWARD(BLOCKING_CALL, fclose, stream); }
+int fflush(FILE* stream) { RT_CHECK_FORWARD(BLOCKING_CALL, fflush, stream); }
+// iostreams on stdout/stderr end up in these.
+size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream) {
+    RT_CHECK_FORWARD(BLOCKING_CALL, fwrite, ptr, size, count, stream);
+}
+int fputs(const char* str, FILE* stream) { RT_CHECK_FORWARD(BLOCKING_CALL, fputs, str, stream); }
+int fputc(int c, FILE* stream) { RT_CHECK_FORWARD(BLOCKING_CALL, fputc, c, stream); }
+int putc(int c, FILE* stream) { RT_CHECK_FORWARD(BLOCKING_CALL, putc, c, stream); }
+
+} // extern "C"
+
+namespace RtCheck {
+
+RenderScope::RenderScope() { ++renderDepth; }
+RenderScope::~RenderScope() { --renderDepth; }
+
+unsigned long report() {
+    while (sitesLock.test_and_set(std::memory_order_acquire)) {
+    }
+    unsigned long totals[NUM_KINDS] = {};
+    for (int i = 0; i < numSites; ++i) {
+        const Site& site = sites[i];
+        totals[site.kind] += site.count;
+        std::fprintf(stderr, "rtcheck: %s via %s, %lu time(s):\n", KIND_NAMES[site.kind], site.call, site.count);
+        std::fflush(stderr);
+        backtrace_symbols_fd(const_cast<void* const*>(site.frames), site.depth, STDERR_FILENO);
+    }
+    unsigned long total = 0;
+    std::fprintf(stderr, "rtcheck:");
+    for (int k = 0; k < NUM_KINDS; ++k) {
+        std::fprintf(stderr, " %lu %s(s)%s", totals[k], KIND_NAMES[k], k + 1 < NUM_KINDS ? "," : "\n");
+        total += totals[k];
+    }
+    if (droppedSites > 0) {
+        std::fprintf(stderr, "rtcheck: %lu further violation(s) at unrecorded sites\n", droppedSites);
+        total += droppedSites;
+    }
+    sitesLock.clear(std::memory_order_release);
+    return total;
+}
+
+} // namespace RtCheck
+
+#endif // SYNTH_RT_CHECK
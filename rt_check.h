@@ -0,0 +1,35 @@
+// synth/rt_check.h
+#pragma once
+
+// Real-time safety checker, compiled in with -DSYNTH_RT_CHECK (see the
+// rtcheck target in the Makefile). While a RenderScope is alive on a thread,
+// that thread counts as rendering audio: heap allocation and release, mutex
+// locks and blocking calls (I/O, sleeps, condition waits) made from it are
+// counted and their stack traces recorded. Without the flag RenderScope is an
+// empty struct and nothing is intercepted.
+namespace RtCheck {
+
+#ifdef SYNTH_RT_CHECK
+
+class RenderScope {
+public:
+    RenderScope();
+    ~RenderScope();
+    RenderScope(const RenderScope&) = delete;
+    RenderScope& operator=(const RenderScope&) = delete;
+};
+
+// Prints each distinct violation (kind, call, count, stack trace) to stderr
+// and returns the total number of violations. Call outside any RenderScope.
+unsigned long report();
+
+#else
+
+struct RenderScope {
+    RenderScope() {} // user-provided so an unused scope does not warn
+};
+inline unsigned long report() { return 0; }
+
+#endif
+
+} // namespace RtCheck
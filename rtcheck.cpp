@@ -0,0 +1,160 @@
+// synth/rtcheck.cpp
+// Plays a MIDI file through PolySynth::processBlock with the real-time checker
+// compiled in, and fails if the render path allocated, locked or blocked.
+// Notes arrive through a BlockEventSource at their frame, so note handling is
+// checked along with rendering. Besides the notes it cycles the quality tiers
+// and switches waveforms from the event source too, so patch publishing,
+// pick-up and tier changes run on the checked path.
+//
+// Build and run with `make rtcheck`, or
+//   ./rtcheck [song.mid] [frames_per_block] [pipelined|morph]
+// where "pipelined" runs the effects on the pipeline worker and "morph"
+// sweeps a PresetMorph between two presets instead of switching waveforms.
+#include "poly_synth.h"
+#include "effects/reverb_effect.h"
+#include "preset_morph.h"
+#include "rt_check.h"
+#include "waveform.h"
+#include "MidiFile.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef SYNTH_RT_CHECK
+#error "rtcheck needs -DSYNTH_RT_CHECK; build it with `make rtcheck`"
+#endif
+
+namespace {
+
+// The song's events for one block at a time, plus that block's control
+// changes, applied from inside processBlock.
+class SongEvents : public BlockEventSource {
+public:
+    SongEvents(PolySynth& synth, const smf::MidiEventList& events, BlockEventSource* morph)
+        : synth_(synth), events_(events), morph_(morph) {}
+
+    // Control thread, between blocks. tier and waveform are -1 for no change.
+    void beginBlock(double startSeconds, int numFrames, int tier, int waveform) {
+        startSeconds_ = startSeconds;
+        numFrames_ = numFrames;
+        tier_ = tier;
+        waveform_ = waveform;
+    }
+
+    int dispatch(int frame) override {
+        if (frame == 0) {
+            if (morph_) morph_->dispatch(0);
+            if (tier_ >= 0) synth_.setQualityTier(tier_);
+            if (waveform_ >= 0) synth_.setOsc1Waveform(static_cast<Waveform>(waveform_));
+        }
+        for (; next_ < events_.size(); ++next_) {
+            const int due = frameOf(events_[next_]);
+            if (due >= numFrames_) return INT_MAX;
+            if (due > frame) return due;
+            apply(events_[next_]);
+        }
+        return INT_MAX;
+    }
+
+private:
+    int frameOf(const smf::MidiEvent& event) const {
+        const double frames = (event.seconds - startSeconds_) * synth_.getSampleRate();
+        return std::max(0, static_cast<int>(frames));
+    }
+
+    void apply(const smf::MidiEvent& event) {
+        if (event.isNoteOn()) {
+            synth_.noteOn(event.getKeyNumber(), static_cast<float>(event.getVelocity()));
+        } else if (event.isNoteOff()) {
+            synth_.noteOff(event.getKeyNumber());
+        } else if (event.isPitchbend()) {
+            synth_.setPitchBend((static_cast<float>(event.getP2()) - 8192.0f) / 8192.0f);
+        } else if (event.isController() && event.getP1() == 1) {
+            synth_.setModulationWheelValue(static_cast<float>(event.getP2()) / 127.0f);
+        }
+    }
+
+    PolySynth& synth_;
+    const smf::MidiEventList& events_;
+    BlockEventSource* morph_;
+    int next_ = 0;
+    double startSeconds_ = 0.0;
+    int numFrames_ = 0;
+    int tier_ = -1;
+    int waveform_ = -1;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::string midiPath = argc > 1 ? argv[1] : "test_song.mid";
+    const int blockFrames = argc > 2 ? std::max(1, std::atoi(argv[2])) : 256;
+    const std::string mode = argc > 3 ? argv[3] : "";
+    const bool pipelined = mode == "pipelined";
+    const bool morphing = mode == "morph";
+
+    smf::MidiFile midifile;
+    if (!midifile.read(midiPath)) {
+        std::cerr << "Error: Could not read MIDI file: " << midiPath << std::endl;
+        return 2;
+    }
+    midifile.doTimeAnalysis();
+    midifile.joinTracks();
+
+    PolySynth synth(44100, 16);
+    auto reverb = std::make_unique<ReverbEffect>(synth.getSampleRate());
+    ReverbEffect* reverbPtr = reverb.get();
+    synth.addEffect(std::move(reverb));
+    if (pipelined) synth.setPipelinedEffects(true, blockFrames);
+
+    const Waveform waveforms[] = {Waveform::Saw, Waveform::Square, Waveform::Additive, Waveform::Triangle};
+    const double blockSeconds = static_cast<double>(blockFrames) / synth.getSampleRate();
+    const double tailSeconds = 3.0;
+    std::vector<float> block(2 * static_cast<size_t>(blockFrames));
+
+    PresetMorph morph(synth, reverbPtr);
+    if (morphing) {
+        Preset a;
+        Preset b;
+        a.patch.osc1Waveform = Waveform::Saw;
+        b.patch.osc1Waveform = Waveform::Additive;
+        b.patch.filter.baseCutoffHz = 5000.0f;
+        b.patch.ampEnv.release = 1.5f;
+        b.patch.osc1Harmonics[3] = 0.5f;
+        b.reverb.roomSize = 0.9f;
+        b.reverb.rt60 = 4.0f;
+        morph.setPresets(a, b);
+    }
+
+    // Only the morph position is set between blocks; everything else goes
+    // through the event source, on the audio path.
+    SongEvents song(synth, midifile[0], morphing ? &morph : nullptr);
+    long blocks = 0;
+    const int numEvents = midifile.getNumEvents(0);
+    const double endSeconds = (numEvents > 0 ? midifile.getEvent(0, numEvents - 1).seconds : 0.0) + tailSeconds;
+    for (double now = 0.0; now < endSeconds; now += blockSeconds, ++blocks) {
+        const long second = static_cast<long>(now);
+        int tier = -1;
+        int waveform = -1;
+        if (morphing) {
+            morph.setPosition(static_cast<float>(std::fabs(std::fmod(now, 4.0) - 2.0) / 2.0));
+        } else if (static_cast<long>(now + blockSeconds) != second) {
+            tier = static_cast<int>((second + 1) % QualityGovernor::NUM_TIERS);
+            waveform = static_cast<int>(waveforms[(second + 1) % 4]);
+        }
+        song.beginBlock(now, blockFrames, tier, waveform);
+        synth.processBlock(block.data(), blockFrames, &song);
+    }
+
+    synth.setPipelinedEffects(false);
+    std::cout << "Rendered " << blocks << " blocks of " << blockFrames << " frames from " << midiPath
+              << (pipelined ? " with pipelined effects" : morphing ? " while morphing" : "") << std::endl;
+    const unsigned long violations = RtCheck::report();
+    std::cout << (violations == 0 ? "Audio path is real-time safe." : "Audio path is NOT real-time safe.") << std::endl;
+    return violations == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+// synth/spsc_ring.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Single-producer / single-consumer ring of trivially copyable items. The
+// capacity is rounded up to a power of two and allocated once; after that
+// neither side blocks or allocates. Indices count items ever written/read and
+// wrap through the mask.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t minCapacity) {
+        size_t capacity = 1;
+        while (capacity < minCapacity) capacity <<= 1;
+        items_.resize(capacity);
+        mask_ = capacity - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return items_.size(); }
+
+    // Either side; exact for the caller's own side, a lower bound for the other.
+    size_t size() const {
+        return writeIndex_.load(std::memory_order_acquire) - readIndex_.load(std::memory_order_acquire);
+    }
+
+    // Producer side. Writes as many items as fit and returns that count.
+    size_t write(const T* src, size_t count) {
+        const size_t w = writeIndex_.load(std::memory_order_relaxed);
+        const size_t r = readIndex_.load(std::memory_order_acquire);
+        count = std::min(count, capacity() - (w - r));
+        copyIn(w, src, count);
+        writeIndex_.store(w + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side. Reads up to `count` items and returns how many it got.
+    size_t read(T* dst, size_t count) {
+        const size_t r = readIndex_.load(std::memory_order_relaxed);
+        const size_t w = writeIndex_.load(std::memory_order_acquire);
+        count = std::min(count, w - r);
+        copyOut(r, dst, count);
+        readIndex_.store(r + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    void copyIn(size_t index, const T* src, size_t count) {
+        const size_t start = index & mask_;
+        const size_t first = std::min(count, capacity() - start);
+        std::copy(src, src + first, items_.begin() + start);
+        std::copy(src + first, src + count, items_.begin());
+    }
+    void copyOut(size_t index, T* dst, size_t count) const {
+        const size_t start = index & mask_;
+        const size_t first = std::min(count, capacity() - start);
+        std::copy(items_.begin() + start, items_.begin() + start + first, dst);
+        std::copy(items_.begin(), items_.begin() + (count - first), dst + first);
+    }
+
+    std::vector<T> items_;
+    size_t mask_ = 0;
+    // Kept on separate cache lines so the two threads do not false-share.
+    alignas(64) std::atomic<size_t> writeIndex_{0};
+    alignas(64) std::atomic<size_t> readIndex_{0};
+};
@@ -0,0 +1,7 @@
+// synth/stereo_sample.h
+#pragma once
+
+struct StereoSample {
+    float L = 0.0f;
+    float R = 0.0f;
+};
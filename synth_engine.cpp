@@ -0,0 +1,67 @@
+// synth/synth_engine.cpp
+#include "synth_engine.h"
+#include "poly_synth.h"
+#include <algorithm>
+#include <chrono>
+
+SynthEngine::SynthEngine(int numWorkers, int maxBlockFrames, const RealtimeConfig& workerConfig)
+    : maxBlockFrames_(std::max(1, maxBlockFrames)),
+      pool_(numWorkers, workerConfig) {}
+
+int SynthEngine::addInstance(PolySynth* synth) {
+    if (!synth) return -1;
+    for (const auto& instance : instances_) {
+        if (instance.synth == synth) return -1;
+    }
+    if (getNumInstances() >= RenderPool::MAX_TASKS) return -1;
+    const size_t frames = static_cast<size_t>(maxBlockFrames_);
+    instances_.push_back({synth, std::vector<float>(frames, 0.0f), std::vector<float>(frames, 0.0f)});
+    updateMaxVoices();
+    return getNumInstances() - 1;
+}
+
+void SynthEngine::removeInstance(PolySynth* synth) {
+    instances_.erase(std::remove_if(instances_.begin(), instances_.end(),
+                                    [synth](const Instance& instance) { return instance.synth == synth; }),
+                     instances_.end());
+    updateMaxVoices();
+}
+
+void SynthEngine::updateMaxVoices() {
+    int voices = 0;
+    for (const auto& instance : instances_) {
+        voices += instance.synth->getMaxVoices();
+    }
+    governor_.setMaxVoices(voices);
+}
+
+PolySynth* SynthEngine::getInstance(int slot) const {
+    if (slot < 0 || slot >= getNumInstances()) return nullptr;
+    return instances_[slot].synth;
+}
+
+int SynthEngine::process(int numFrames) {
+    numFrames = std::clamp(numFrames, 0, maxBlockFrames_);
+    if (numFrames == 0) return 0;
+    auto render = [this, numFrames](int slot) {
+        Instance& instance = instances_[slot];
+        instance.synth->commitParams();
+        instance.synth->processBlock(instance.left.data(), instance.right.data(), numFrames);
+    };
+    const auto start = std::chrono::steady_clock::now();
+    pool_.parallelFor(getNumInstances(), render);
+    if (!instances_.empty()) {
+        const double renderSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        governor_.onBlock(getNumInstances(), [this](int slot) { return instances_[slot].synth; }, renderSeconds,
+                          static_cast<double>(numFrames) / instances_[0].synth->getSampleRate());
+    }
+    return numFrames;
+}
+
+const float* SynthEngine::getOutput(int slot, int channel) const {
+    if (slot < 0 || slot >= getNumInstances()) return nullptr;
+    if (channel == 0) return instances_[slot].left.data();
+    if (channel == 1) return instances_[slot].right.data();
+    return nullptr;
+}
@@ -0,0 +1,57 @@
+// synth/synth_engine.h
+#pragma once
+#include "group_governor.h"
+#include "render_pool.h"
+#include <vector>
+
+// Renders many independent PolySynth instances per block on one RenderPool,
+// for hosts that run dozens of them. Each registered instance gets its own
+// planar left/right output buffers, valid until the next process() call.
+//
+// The engine does not own the synths. Registration is not thread-safe with
+// respect to process(): add and remove instances while nothing is rendering.
+// Read-only tables (sine table, additive kernel and FFT) are process-wide
+// statics, so every instance already shares one copy.
+class SynthEngine {
+public:
+    SynthEngine(int numWorkers, int maxBlockFrames, const RealtimeConfig& workerConfig = RealtimeConfig());
+
+    const RenderPool& getRenderPool() const { return pool_; }
+    int getMaxBlockFrames() const { return maxBlockFrames_; }
+
+    // Returns the instance's slot, or -1 if it is already registered.
+    int addInstance(PolySynth* synth);
+    // Slots above the removed one move down by one.
+    void removeInstance(PolySynth* synth);
+    int getNumInstances() const { return static_cast<int>(instances_.size()); }
+    PolySynth* getInstance(int slot) const;
+
+    // Quality tier and voice cap for all instances together, from the time a
+    // whole process() call takes (see GroupGovernor). Both off by default, as
+    // for offline rendering; leave the instances' own adaptation and budgets off.
+    void setAdaptiveQuality(bool enabled) { governor_.setAdaptiveQuality(enabled); }
+    void setVoiceBudget(float loadFraction) { governor_.setVoiceBudget(loadFraction); }
+    const QualityGovernor& getQualityGovernor() const { return governor_.getQualityGovernor(); }
+    const VoiceBudget& getVoiceBudget() const { return governor_.getVoiceBudget(); }
+
+    // Renders every instance for min(numFrames, maxBlockFrames) frames and
+    // returns that count. Each instance first commits its recorded
+    // parameters (see PolySynth::commitParams).
+    int process(int numFrames);
+    // Channel 0 is left, 1 right; nullptr for a bad slot or channel.
+    const float* getOutput(int slot, int channel) const;
+
+private:
+    struct Instance {
+        PolySynth* synth;
+        std::vector<float> left;
+        std::vector<float> right;
+    };
+
+    void updateMaxVoices();
+
+    int maxBlockFrames_;
+    std::vector<Instance> instances_;
+    RenderPool pool_;
+    GroupGovernor governor_{1};
+};
@@ -0,0 +1,45 @@
+// synth/triple_buffer.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Single-producer / single-consumer triple buffer. The writer fills
+// writeBuffer() and calls publish(); the reader calls update() at a safe point
+// (e.g. the start of an audio block) and then owns readBuffer() exclusively
+// until its next update(). Neither side ever blocks or allocates.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : TripleBuffer(T{}) {}
+    explicit TripleBuffer(const T& initial)
+        : slots_{initial, initial, initial}, writeIndex_(0), middle_(1), readIndex_(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side.
+    T& writeBuffer() { return slots_[writeIndex_]; }
+    void publish() {
+        writeIndex_ = middle_.exchange(writeIndex_ | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Reader side. Returns true if a newer value was picked up.
+    bool update() {
+        if ((middle_.load(std::memory_order_relaxed) & FRESH_BIT) == 0) {
+            return false;
+        }
+        readIndex_ = middle_.exchange(readIndex_, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+    T& readBuffer() { return slots_[readIndex_]; }
+    const T& readBuffer() const { return slots_[readIndex_]; }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH_BIT = 0x4;
+
+    T slots_[3];
+    uint8_t writeIndex_;
+    std::atomic<uint8_t> middle_;
+    uint8_t readIndex_;
+};
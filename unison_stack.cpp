@@ -0,0 +1,121 @@
+// synth/unison_stack.cpp
+#include "unison_stack.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#ifndef M_PI_2
+#define M_PI_2 (1.57079632679489661923)
+#endif
+
+UnisonLayout UnisonLayout::make(int members, float detuneCents, float stereoSpread) {
+    UnisonLayout layout;
+    layout.members = std::clamp(members, 1, MAX_MEMBERS);
+    const int n = layout.members;
+    // Members add incoherently, so 1/sqrt(n) keeps a stacked note about as
+    // loud as a single oscillator.
+    const float norm = 1.0f / std::sqrt(static_cast<float>(n));
+
+    for (int i = 0; i < n; ++i) {
+        float spreadFactor = 0.0f;
+        if (n > 1) {
+            spreadFactor = (static_cast<float>(i) / static_cast<float>(n - 1) - 0.5f) * 2.0f;
+        }
+        if (n % 2 == 1 && i == n / 2) {
+            spreadFactor = 0.0f;
+        }
+        layout.detuneRatio[i] = std::pow(2.0f, (detuneCents * spreadFactor) / 1200.0f);
+
+        float pan = std::clamp(spreadFactor * stereoSpread, -1.0f, 1.0f);
+        float panAngle = (pan + 1.0f) * 0.5f * static_cast<float>(M_PI_2);
+        layout.gainL[i] = std::cos(panAngle) * norm;
+        layout.gainR[i] = std::sin(panAngle) * norm;
+        layout.monoGain[i] = 1.0f / static_cast<float>(n);
+    }
+    layout.monoFromStereo = 1.0f / (std::sqrt(2.0f) * norm * static_cast<float>(n));
+    return layout;
+}
+
+UnisonStack::UnisonStack(int sampleRate)
+    : invSampleRate_(1.0f / static_cast<float>(sampleRate)),
+      incrementPerHz_(PhaseAccumulator::incrementPerHz(
+          static_cast<double>(sampleRate) * AdaptiveOversampling::MAX_FACTOR)),
+      additive_(sampleRate) {
+    reset();
+}
+
+void UnisonStack::reset() {
+    for (int i = 0; i < UnisonLayout::MAX_MEMBERS; ++i) {
+        phases_[i] = static_cast<uint32_t>(i) * 0x9E3779B9u; // golden-ratio spacing
+    }
+    additive_.reset();
+    oversampling_.snapNextUpdate();
+}
+
+void UnisonStack::sync() {
+    std::fill(std::begin(phases_), std::end(phases_), 0u);
+    additive_.sync();
+}
+
+UnisonStack::RenderFn UnisonStack::rendererFor(Waveform waveform) {
+    switch (waveform) {
+        case Waveform::Sine:     return &UnisonStack::renderWaveform<Waveform::Sine>;
+        case Waveform::Saw:      return &UnisonStack::renderWaveform<Waveform::Saw>;
+        case Waveform::Square:   return &UnisonStack::renderWaveform<Waveform::Square>;
+        case Waveform::Triangle: return &UnisonStack::renderWaveform<Waveform::Triangle>;
+        case Waveform::Pulse:    return &UnisonStack::renderWaveform<Waveform::Pulse>;
+        case Waveform::Additive: return &UnisonStack::renderWaveform<Waveform::Additive>;
+    }
+    return &UnisonStack::renderWaveform<Waveform::Sine>;
+}
+
+template <Waveform W>
+void UnisonStack::renderWaveform(const UnisonLayout& layout, float baseFreq, float effectivePW,
+                                 const float* harmonicAmplitudes, UnisonOutput& out) {
+    if constexpr (W == Waveform::Additive) {
+        // All members share one stereo IFFT frame.
+        additive_.processStereo(layout.members, baseFreq, layout.detuneRatio, layout.gainL, layout.gainR,
+                                harmonicAmplitudes, out.left, out.right);
+        out.mono = (out.left + out.right) * layout.monoFromStereo;
+        return;
+    }
+
+    // Fixed trip count so the loops vectorise; unused lanes have zero gains.
+    constexpr int n = UnisonLayout::MAX_MEMBERS;
+
+    float weights[AdaptiveOversampling::MAX_FACTOR];
+    int subSamples = oversampling_.getFactor();
+    if (oversampling_.isFading()) {
+        subSamples = oversampling_.fadeWeights(weights);
+    } else {
+        std::fill(weights, weights + subSamples, 1.0f / static_cast<float>(subSamples));
+    }
+    const float stepScale = static_cast<float>(AdaptiveOversampling::MAX_FACTOR / subSamples);
+
+    alignas(32) uint32_t increments[UnisonLayout::MAX_MEMBERS];
+    alignas(32) float acc[UnisonLayout::MAX_MEMBERS] = {};
+    for (int m = 0; m < n; ++m) {
+        increments[m] = PhaseAccumulator::incrementFromHz(baseFreq * layout.detuneRatio[m] * stepScale,
+                                                          incrementPerHz_);
+    }
+
+    // Same oversample-and-average as HarmonicOscillator, one lane per member.
+    for (int s = 0; s < subSamples; ++s) {
+        for (int m = 0; m < n; ++m) {
+            acc[m] += weights[s] * HarmonicOscillator::waveformSample<W>(phases_[m], effectivePW, harmonicAmplitudes);
+            phases_[m] += increments[m];
+        }
+    }
+
+    float left = 0.0f;
+    float right = 0.0f;
+    float mono = 0.0f;
+    for (int m = 0; m < n; ++m) {
+        left += acc[m] * layout.gainL[m];
+        right += acc[m] * layout.gainR[m];
+        mono += acc[m] * layout.monoGain[m];
+    }
+    out.left = left;
+    out.right = right;
+    out.mono = mono;
+}
@@ -0,0 +1,72 @@
+// synth/unison_stack.h
+#pragma once
+#include "additive_osc.h"
+#include "harmonic_osc.h"
+#include "oversampling.h"
+#include "phase_accumulator.h"
+#include "waveform.h"
+#include <cstdint>
+
+// Detune ratio and pan gains of each stack member. Depends only on the patch,
+// so it is computed once per patch change and shared by every voice. Unused
+// lanes have zero ratio and gains, which lets the render loops always run
+// MAX_MEMBERS wide.
+struct UnisonLayout {
+    static constexpr int MAX_MEMBERS = 8;
+
+    int members = 1;
+    float detuneRatio[MAX_MEMBERS] = {};
+    float gainL[MAX_MEMBERS] = {};
+    float gainR[MAX_MEMBERS] = {};
+    float monoGain[MAX_MEMBERS] = {};
+    // Mean of the members recovered from L + R, exact for centred members.
+    // Additive stacks only produce L and R.
+    float monoFromStereo = 1.0f;
+
+    static UnisonLayout make(int members, float detuneCents, float stereoSpread);
+};
+
+struct UnisonOutput {
+    float left = 0.0f;
+    float right = 0.0f;
+    float mono = 0.0f; // mean of the members, for ring mod and cross-mod
+};
+
+// N detuned copies of oscillator A inside one voice (supersaw style). Member
+// state is laid out as plain arrays so the per-member loop vectorises.
+class UnisonStack {
+public:
+    using RenderFn = void (UnisonStack::*)(const UnisonLayout& layout, float baseFreq, float effectivePW,
+                                           const float* harmonicAmplitudes, UnisonOutput& out);
+    static RenderFn rendererFor(Waveform waveform);
+
+    explicit UnisonStack(int sampleRate);
+
+    // Members start spread around the cycle so a new note does not begin
+    // with all of them in phase.
+    void reset();
+    void sync();
+    // As HarmonicOscillator::updateOversampling; one factor for all members.
+    void updateOversampling(float spectrumReachHz) {
+        oversampling_.update(spectrumReachHz * invSampleRate_);
+    }
+    void setMaxOversampling(int factor) { oversampling_.setMaxFactor(factor); }
+    void setAdditivePartialLimit(int partials) { additive_.setPartialLimit(partials); }
+    void attachAdditiveBuffers(float* buffers) { additive_.attachBuffers(buffers); }
+
+    void render(RenderFn fn, const UnisonLayout& layout, float baseFreq, float effectivePW,
+                const float* harmonicAmplitudes, UnisonOutput& out) {
+        (this->*fn)(layout, baseFreq, effectivePW, harmonicAmplitudes, out);
+    }
+
+private:
+    template <Waveform W>
+    void renderWaveform(const UnisonLayout& layout, float baseFreq, float effectivePW,
+                        const float* harmonicAmplitudes, UnisonOutput& out);
+
+    float invSampleRate_;
+    float incrementPerHz_; // at AdaptiveOversampling::MAX_FACTOR times the sample rate
+    alignas(32) uint32_t phases_[UnisonLayout::MAX_MEMBERS];
+    AdaptiveOversampling oversampling_;
+    StereoAdditiveOscillator additive_;
+};
@@ -2,49 +2,33 @@
 #include "vcf.h"
 #include <cmath>
 #include <algorithm> 
+#include <iterator>
 
 VCF::VCF(float sr)
     : sampleRate(sr), currentFilterType_(SynthParams::FilterType::LPF24), 
-      baseCutoffHz(1000.0f), resonance(0.0f), keyFollow(0.0f),
-      envModAmount(0.0f), envelopeValue(0.0f), noteBaseFreq(440.0f),
+      envelopeValue(0.0f), noteBaseFreq(440.0f),
       s1_svf_(0.0f), s2_svf_(0.0f), svf_f_(0.1f), svf_q_coeff_(0.5f),
       currentEffectiveCutoffHz_(1000.0f) {
     std::fill(std::begin(z_ladder_), std::end(z_ladder_), 0.0f);
-    calculateCoefficients(baseCutoffHz, resonance); 
+    calculateCoefficients(currentEffectiveCutoffHz_, 0.0f); 
 }
 
-void VCF::setType(SynthParams::FilterType type) {
-    if (currentFilterType_ != type) {
-        currentFilterType_ = type;
-        std::fill(std::begin(z_ladder_), std::end(z_ladder_), 0.0f);
-        s1_svf_ = 0.0f;
-        s2_svf_ = 0.0f;
-        calculateCoefficients(currentEffectiveCutoffHz_, resonance); 
-    }
+void VCF::resetState(SynthParams::FilterType type) {
+    currentFilterType_ = type;
+    std::fill(std::begin(z_ladder_), std::end(z_ladder_), 0.0f);
+    s1_svf_ = 0.0f;
+    s2_svf_ = 0.0f;
+    svfInputShaper_.reset();
+    controlCountdown_ = 0;
 }
 
 SynthParams::FilterType VCF::getType() const {
     return currentFilterType_;
 }
 
-void VCF::setBaseCutoff(float hz) {
-    baseCutoffHz = std::clamp(hz, 20.0f, sampleRate * 0.49f); 
-}
-
-void VCF::setResonance(float r) {
-    resonance = std::clamp(r, 0.0f, 1.0f);
-}
-
-void VCF::setKeyFollow(float factor) {
-    keyFollow = std::clamp(factor, 0.0f, 1.0f);
-}
-
-void VCF::setEnvelopeMod(float amount) {
-    envModAmount = std::clamp(amount, -1.0f, 1.0f);
-}
-
 void VCF::setNote(int midiNote) {
     noteBaseFreq = 440.0f * std::pow(2.0f, (static_cast<float>(midiNote) - 69.0f) / 12.0f);
+    noteOctavesFromA4_ = std::log2(noteBaseFreq / 440.0f);
 }
 
 void VCF::setEnvelopeValue(float env) {
@@ -65,65 +49,89 @@ void VCF::calculateCoefficients(float cutoffHz, float resonanceValue) {
 }
 
 
-float VCF::process(float input, float directModHz) {
-    float effectiveCutoff = baseCutoffHz;
-    effectiveCutoff *= std::pow(2.0f, keyFollow * (std::log2(noteBaseFreq / 440.0f)) );
-    float envSweepOctaves = 5.0f; 
-    effectiveCutoff *= std::pow(2.0f, envModAmount * (envelopeValue - 0.5f) * 2.0f * envSweepOctaves); 
-    effectiveCutoff += directModHz;
-    currentEffectiveCutoffHz_ = std::clamp(effectiveCutoff, 20.0f, sampleRate * 0.49f);
+float VCF::process(const VCFParams& params, float input, float directModHz) {
+    switch (params.type) {
+        case SynthParams::FilterType::LPF24: return process<SynthParams::FilterType::LPF24>(params, input, directModHz);
+        case SynthParams::FilterType::LPF12: return process<SynthParams::FilterType::LPF12>(params, input, directModHz);
+        case SynthParams::FilterType::HPF12: return process<SynthParams::FilterType::HPF12>(params, input, directModHz);
+        case SynthParams::FilterType::BPF12: return process<SynthParams::FilterType::BPF12>(params, input, directModHz);
+        case SynthParams::FilterType::NOTCH: return process<SynthParams::FilterType::NOTCH>(params, input, directModHz);
+    }
+    return input;
+}
 
-    calculateCoefficients(currentEffectiveCutoffHz_, resonance);
+template <SynthParams::FilterType FT>
+float VCF::process(const VCFParams& params, float input, float directModHz) {
+    if (FT != currentFilterType_) {
+        resetState(FT);
+    }
+    const float resonance = params.resonance;
 
-    float output = 0.0f;
+    if (controlCountdown_ <= 0) {
+        controlCountdown_ = controlInterval_;
 
-    switch (currentFilterType_) {
-        case SynthParams::FilterType::LPF24: {
-            float f_ladder = 2.0f * std::sinf(static_cast<float>(M_PI) * currentEffectiveCutoffHz_ / sampleRate);
-            f_ladder = std::clamp(f_ladder, 0.0f, 1.0f); 
-            float fb_ladder = resonance * 3.95f; 
-            fb_ladder = std::clamp(fb_ladder, 0.0f, 3.95f);
+        float effectiveCutoff = params.baseCutoffHz;
+        if (params.keyFollow != 0.0f) {
+            effectiveCutoff *= std::pow(2.0f, params.keyFollow * noteOctavesFromA4_);
+        }
+        float envSweepOctaves = 5.0f; 
+        if (params.envModAmount != 0.0f) {
+            effectiveCutoff *= std::pow(2.0f, params.envModAmount * (envelopeValue - 0.5f) * 2.0f * envSweepOctaves); 
+        }
+        effectiveCutoff += directModHz;
+        currentEffectiveCutoffHz_ = std::clamp(effectiveCutoff, 20.0f, sampleRate * 0.49f);
+
+        if constexpr (FT == SynthParams::FilterType::LPF24) {
+            ladderF_ = 2.0f * std::sin(static_cast<float>(M_PI) * currentEffectiveCutoffHz_ / sampleRate);
+            ladderF_ = std::clamp(ladderF_, 0.0f, 1.0f); 
+        } else {
+            calculateCoefficients(currentEffectiveCutoffHz_, resonance);
+        }
+    }
+    --controlCountdown_;
 
-            float lowPass = input - z_ladder_[3] * fb_ladder; 
-            lowPass = std::clamp(lowPass, -10.0f, 10.0f); 
+    if constexpr (FT == SynthParams::FilterType::LPF24) {
+        const float f_ladder = ladderF_;
+        float fb_ladder = resonance * 3.95f; 
+        fb_ladder = std::clamp(fb_ladder, 0.0f, 3.95f);
 
-            z_ladder_[0] = z_ladder_[0] + f_ladder * (lowPass - z_ladder_[0]);
-            z_ladder_[1] = z_ladder_[1] + f_ladder * (z_ladder_[0] - z_ladder_[1]);
-            z_ladder_[2] = z_ladder_[2] + f_ladder * (z_ladder_[1] - z_ladder_[2]);
-            z_ladder_[3] = z_ladder_[3] + f_ladder * (z_ladder_[2] - z_ladder_[3]);
-            output = z_ladder_[3];
-            break;
-        }
+        float lowPass = input - z_ladder_[3] * fb_ladder; 
+        lowPass = std::clamp(lowPass, -10.0f, 10.0f); 
+
+        z_ladder_[0] = z_ladder_[0] + f_ladder * (lowPass - z_ladder_[0]);
+        z_ladder_[1] = z_ladder_[1] + f_ladder * (z_ladder_[0] - z_ladder_[1]);
+        z_ladder_[2] = z_ladder_[2] + f_ladder * (z_ladder_[1] - z_ladder_[2]);
+        z_ladder_[3] = z_ladder_[3] + f_ladder * (z_ladder_[2] - z_ladder_[3]);
+        return z_ladder_[3];
+    } else {
+        float svf_input = svfInputShaper_.process(input);
+
+        float v0 = svf_input; 
+        float v_lp = s2_svf_; 
+        float v_bp = s1_svf_; 
+
+        float v_hp = v0 - v_lp - svf_q_coeff_ * v_bp; 
+
+        float v_bp_new = svf_f_ * v_hp + v_bp;      
+        float v_lp_new = svf_f_ * v_bp_new + v_lp;    
+
+        s1_svf_ = v_bp_new; 
+        s2_svf_ = v_lp_new; 
         
-        case SynthParams::FilterType::LPF12:
-        case SynthParams::FilterType::HPF12:
-        case SynthParams::FilterType::BPF12:
-        case SynthParams::FilterType::NOTCH: {
-            float svf_input = std::tanh(input);
-
-            float v0 = svf_input; 
-            float v_lp = s2_svf_; 
-            float v_bp = s1_svf_; 
-
-            float v_hp = v0 - v_lp - svf_q_coeff_ * v_bp; 
-
-            float v_bp_new = svf_f_ * v_hp + v_bp;      
-            float v_lp_new = svf_f_ * v_bp_new + v_lp;    
-
-            s1_svf_ = v_bp_new; 
-            s2_svf_ = v_lp_new; 
-            
-            if (currentFilterType_ == SynthParams::FilterType::LPF12) {
-                output = s2_svf_; 
-            } else if (currentFilterType_ == SynthParams::FilterType::HPF12) {
-                output = v_hp; 
-            } else if (currentFilterType_ == SynthParams::FilterType::BPF12) {
-                output = s1_svf_; 
-            } else if (currentFilterType_ == SynthParams::FilterType::NOTCH) {
-                output = v_hp + s2_svf_; 
-            }
-            break;
+        if constexpr (FT == SynthParams::FilterType::LPF12) {
+            return s2_svf_; 
+        } else if constexpr (FT == SynthParams::FilterType::HPF12) {
+            return v_hp; 
+        } else if constexpr (FT == SynthParams::FilterType::BPF12) {
+            return s1_svf_; 
+        } else {
+            return v_hp + s2_svf_; 
         }
     }
-    return output;
-}
\ No newline at end of file
+}
+
+template float VCF::process<SynthParams::FilterType::LPF24>(const VCFParams&, float, float);
+template float VCF::process<SynthParams::FilterType::LPF12>(const VCFParams&, float, float);
+template float VCF::process<SynthParams::FilterType::HPF12>(const VCFParams&, float, float);
+template float VCF::process<SynthParams::FilterType::BPF12>(const VCFParams&, float, float);
+template float VCF::process<SynthParams::FilterType::NOTCH>(const VCFParams&, float, float);
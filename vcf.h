@@ -3,45 +3,60 @@
 #include <algorithm> 
 #include <cmath>     
 #include "synth_parameters.h" 
+#include "waveshaper.h"
 
 #ifndef M_PI
 #define M_PI (3.14159265358979323846)
 #endif
 
+struct VCFParams {
+    SynthParams::FilterType type = SynthParams::FilterType::LPF24;
+    float baseCutoffHz = 1000.0f; 
+    float resonance = 0.0f;    
+    float keyFollow = 0.0f;    
+    float envModAmount = 0.0f; 
+};
+
+// Per-voice filter state. Cutoff, resonance and type come from the shared
+// VCFParams on every call.
 class VCF {
 public:
     VCF(float sampleRate = 44100.0f);
 
-    void setType(SynthParams::FilterType type); 
     SynthParams::FilterType getType() const;    
 
-    void setBaseCutoff(float hz); 
-    float getBaseCutoff() const { return baseCutoffHz; }
-    void setResonance(float q); 
-    void setKeyFollow(float factor);
-    void setEnvelopeMod(float amount);
     void setNote(int midiNote); 
     void setEnvelopeValue(float env); 
+    // Cutoff and coefficients are recomputed every `samples` calls rather
+    // than every call (quality scaling); 1 is exact.
+    void setControlInterval(int samples) { controlInterval_ = std::max(1, samples); }
     
-    float process(float input, float directModHz);
+    float process(const VCFParams& params, float input, float directModHz);
+    // Same as above with the filter type fixed at compile time; only the
+    // coefficients that topology needs are computed.
+    template <SynthParams::FilterType FT>
+    float process(const VCFParams& params, float input, float directModHz);
 
 private:
+    void resetState(SynthParams::FilterType type);
     void calculateCoefficients(float cutoffHz, float resonanceValue); 
 
     SynthParams::FilterType currentFilterType_; 
-    float baseCutoffHz; 
-    float resonance;    
-    float keyFollow;    
-    float envModAmount; 
     float envelopeValue = 0.0f; 
     float noteBaseFreq = 440.0f; 
+    float noteOctavesFromA4_ = 0.0f;
     float sampleRate;
 
     float z_ladder_[4]; 
 
     float s1_svf_, s2_svf_; 
+    AdaaTanh svfInputShaper_;
     
     float svf_f_, svf_q_coeff_; 
+    float ladderF_ = 0.0f;
+
+    int controlInterval_ = 1;
+    int controlCountdown_ = 0;
 
     float currentEffectiveCutoffHz_;
-};
\ No newline at end of file
+};
@@ -6,38 +6,58 @@
 #include <iostream> 
 #include <algorithm> 
 
-std::default_random_engine generator; 
-std::uniform_real_distribution<float> distribution(-1.0f, 1.0f); 
+#ifndef M_PI_2
+#define M_PI_2 (1.57079632679489661923)
+#endif
 
 constexpr float FM_OCTAVE_RANGE = 5.0f;
 
+namespace {
+
+// Aliasing-relevant bandwidth of a waveform relative to a naive saw.
+float spectrumReach(Waveform waveform, bool hardSynced, float fmAmount) {
+    float reach = 1.0f;
+    switch (waveform) {
+        case Waveform::Saw:
+        case Waveform::Square:
+        case Waveform::Pulse:    reach = 1.0f; break;
+        case Waveform::Triangle: reach = 0.25f; break; // harmonics fall at 12 dB/octave
+        case Waveform::Sine:     reach = 0.0f; break;
+        case Waveform::Additive: return 0.0f; // band-limited by construction
+    }
+    if (hardSynced) reach = 1.0f; // the reset edge is a saw-like step
+    if (std::abs(fmAmount) > 0.001f) {
+        // FM sweeps the instantaneous frequency up to 2^(amount * range) and adds sidebands.
+        reach = std::max(reach, 0.25f) * std::pow(2.0f, std::abs(fmAmount) * FM_OCTAVE_RANGE);
+    }
+    return reach;
+}
+
+bool hasRouteTo(const Patch& patch, ModDestination destination) {
+    for (int i = 0; i < patch.numModRoutes && i < MAX_MOD_ROUTES; ++i) {
+        if (patch.modRoutes[i].destination == destination && patch.modRoutes[i].amount != 0.0f) return true;
+    }
+    return false;
+}
 
-Voice::Voice(int sampleRate_, int numHarmonics)
+} // namespace
+
+
+Voice::Voice(int sampleRate_)
     : sampleRate(sampleRate_), active(false),
       velocityValue(1.0f),
-      osc1(sampleRate_, numHarmonics),
-      osc2(sampleRate_, numHarmonics),
+      osc1(sampleRate_),
+      osc2(sampleRate_),
       envelopes{
-          Envelope(0.01f, 0.1f, 0.7f, 0.3f, sampleRate_), 
-          Envelope(0.01f, 0.1f, 0.9f, 0.2f, sampleRate_)  
+          Envelope(sampleRate_), 
+          Envelope(sampleRate_)  
       },
       filter(sampleRate_), 
+      unison_(sampleRate_),
+      filterR_(sampleRate_),
       noteOnTimestamp(0),
       lastS1OutputForFM_(0.0f), 
-      vcoBDetuneCents(0.0f),
-      vcoBLowFreqEnabled(false),
-      vcoBFreqKnob(0.5f),
-      vcoBKeyFollowEnabled_(true),      
       vcoBFixedBaseFreq_(-1.0f),        
-      filterEnvVelocitySensitivity(0.0f),
-      ampVelocitySensitivity(0.0f),
-      xmodOsc2ToOsc1FMAmount_(0.0f), 
-      xmodOsc1ToOsc2FMAmount_(0.0f), 
-      pm_filterEnv_to_freqA_amt(0.0f),
-      pm_filterEnv_to_pwA_amt(0.0f),
-      pm_filterEnv_to_filterCutoff_amt(0.0f),
-      pm_oscB_to_pwA_amt(0.0f),
-      pm_oscB_to_filterCutoff_amt(0.0f),
       currentOutputFreq(0.0f), 
       targetKeyFreq(0.0f),
       glideStartFreqForCurrentSegment(0.0f),
@@ -45,30 +65,32 @@ Voice::Voice(int sampleRate_, int numHarmonics)
       glideTimeSamples(0),
       glideSamplesElapsed(0),
       isGliding(false),
-      firstNoteForThisVoiceInstance(true)
-      , pitchDriftDepthCents(0.0f) 
-      , pwDriftDepth(0.0f)
-      , ringModLevel_(0.0f)
+      firstNoteForThisVoiceInstance(true),
+      noiseGenerator_(nextRandomSeed()),
+      noiseDistribution_(-1.0f, 1.0f)
       , panning_(0.0f)
-      , mixerDrive_(0.0f)
-      , mixerPostGain_(1.0f)
 { 
+    setPanning(0.0f);
 }
 
-void Voice::noteOn(float freq, float velocity, int midiNoteNum, bool globalGlideEnabled, float globalGlideTimeSeconds) {
+void Voice::noteOn(const Patch& patch, float freq, float velocity, int midiNoteNum) {
     float normalizedVelocity = std::clamp(velocity / 127.0f, 0.0f, 1.0f);
-    noteOnDetailed(freq, normalizedVelocity, midiNoteNum, globalGlideEnabled, globalGlideTimeSeconds);
+    noteOnDetailed(patch, freq, normalizedVelocity, midiNoteNum);
 }
 
 
-void Voice::noteOnDetailed(float newTargetFrequency, float normVelocity, int midiNoteNum, bool useGlide, float glideTimeSec) {
+void Voice::noteOnDetailed(const Patch& patch, float newTargetFrequency, float normVelocity, int midiNoteNum) {
+    const bool useGlide = patch.glideEnabled;
+    const float glideTimeSec = patch.glideTime;
+
     this->targetKeyFreq = newTargetFrequency; 
     this->velocityValue = normVelocity; 
     this->noteNumber = midiNoteNum; 
     this->active = true;
     this->lastS1OutputForFM_ = 0.0f; 
+    this->controlCountdown_ = 0;
 
-    if (vcoBKeyFollowEnabled_ || vcoBFixedBaseFreq_ < 0.0f) {
+    if (patch.vcoBKeyFollowEnabled || vcoBFixedBaseFreq_ < 0.0f) {
         vcoBFixedBaseFreq_ = this->targetKeyFreq; 
     }
 
@@ -76,9 +98,11 @@ void Voice::noteOnDetailed(float newTargetFrequency, float normVelocity, int mid
     osc1.resetPhase(); 
     osc2.noteOn();
     osc2.resetPhase(); 
+    unison_.reset();
     envelopes[0].noteOn(); 
     envelopes[1].noteOn(); 
     filter.setNote(noteNumber); 
+    filterR_.setNote(noteNumber);
 
     float freqToGlideFrom = this->currentOutputFreq; 
 
@@ -120,7 +144,57 @@ void Voice::noteOff() {
     envelopes[1].noteOff(); 
 }
 
-float Voice::process(const LfoModulationValues& lfoMod, float currentPitchBendValue, float pitchBendRangeInSemitones) {
+VoiceKernel Voice::selectKernel(const Patch& patch) {
+    unsigned stages = 0;
+    if (patch.noiseLevel != 0.0f || hasRouteTo(patch, ModDestination::NoiseLevel)) stages |= VOICE_STAGE_NOISE;
+    if (patch.ringModLevel != 0.0f) stages |= VOICE_STAGE_RINGMOD;
+    if (patch.mixerDrive > 0.001f || hasRouteTo(patch, ModDestination::Drive)) stages |= VOICE_STAGE_DRIVE;
+    if (patch.syncEnabled) stages |= VOICE_STAGE_SYNC;
+    if (std::abs(patch.xmodOsc1ToOsc2FMAmount) > 0.001f ||
+        std::abs(patch.xmodOsc2ToOsc1FMAmount) > 0.001f) {
+        stages |= VOICE_STAGE_XMOD;
+    }
+    if (patch.unisonEnabled) stages |= VOICE_STAGE_UNISON;
+
+    using AllStages = std::make_integer_sequence<unsigned, VOICE_STAGE_COMBINATIONS>;
+    VoiceKernel kernel;
+    kernel.stages = stages;
+    switch (patch.filter.type) {
+        case SynthParams::FilterType::LPF24: kernel.process = kernelFor<SynthParams::FilterType::LPF24>(stages, AllStages{}); break;
+        case SynthParams::FilterType::LPF12: kernel.process = kernelFor<SynthParams::FilterType::LPF12>(stages, AllStages{}); break;
+        case SynthParams::FilterType::HPF12: kernel.process = kernelFor<SynthParams::FilterType::HPF12>(stages, AllStages{}); break;
+        case SynthParams::FilterType::BPF12: kernel.process = kernelFor<SynthParams::FilterType::BPF12>(stages, AllStages{}); break;
+        case SynthParams::FilterType::NOTCH: kernel.process = kernelFor<SynthParams::FilterType::NOTCH>(stages, AllStages{}); break;
+        default:                             kernel.process = kernelFor<SynthParams::FilterType::LPF24>(stages, AllStages{}); break;
+    }
+    kernel.osc1 = HarmonicOscillator::rendererFor(patch.osc1Waveform);
+    kernel.osc2 = HarmonicOscillator::rendererFor(patch.osc2Waveform);
+    kernel.osc1Stack = UnisonStack::rendererFor(patch.osc1Waveform);
+    kernel.additive = patch.osc1Waveform == Waveform::Additive || patch.osc2Waveform == Waveform::Additive;
+    kernel.unison = UnisonLayout::make(patch.unisonVoices, patch.unisonDetuneCents, patch.unisonStereoSpread);
+    kernel.osc1SpectrumReach = spectrumReach(patch.osc1Waveform, patch.syncEnabled, patch.xmodOsc2ToOsc1FMAmount);
+    kernel.osc2SpectrumReach = spectrumReach(patch.osc2Waveform, false, patch.xmodOsc1ToOsc2FMAmount);
+
+    const float minLfoRate = 0.05f;
+    const float maxLfoRate = 20.0f;
+    kernel.vcoBLowFreqRateHz = minLfoRate * std::pow(maxLfoRate / minLfoRate, patch.vcoBFreqKnob);
+    float semitone_offset_from_knob = (patch.vcoBFreqKnob - 0.5f) * 2.0f * 30.0f;
+    kernel.vcoBKnobRatio = std::pow(2.0f, semitone_offset_from_knob / 12.0f);
+    kernel.vcoBDetuneRatio = std::pow(2.0f, patch.vcoBDetuneCents / 1200.0f);
+    return kernel;
+}
+
+template <SynthParams::FilterType FT, unsigned... Stages>
+Voice::KernelFn Voice::kernelFor(unsigned stages, std::integer_sequence<unsigned, Stages...>) {
+    static constexpr KernelFn kernels[] = { &Voice::processKernel<FT, Stages>... };
+    return kernels[stages];
+}
+
+template <SynthParams::FilterType FT, unsigned Stages>
+StereoSample Voice::processKernel(const Patch& patch, const VoiceKernel& kernel, const ModMatrix& mod,
+                                  const LfoValues& lfos, float currentPitchBendValue) {
+    const float pitchBendRangeInSemitones = patch.pitchBendRangeSemitones;
+
     if (isGliding) {
         glideSamplesElapsed++;
         if (glideSamplesElapsed >= glideTimeSamples) {
@@ -135,236 +209,213 @@ float Voice::process(const LfoModulationValues& lfoMod, float currentPitchBendVa
     
     if (!active && !envelopes[0].isActive() && !envelopes[1].isActive()) {
         lastS1OutputForFM_ = 0.0f; 
-        return 0.0f;
+        return StereoSample{};
     }
     
-    float filterEnvOutput_raw = envelopes[0].step();
-    float ampEnvOutput_raw = envelopes[1].step();
+    float filterEnvOutput_raw = envelopes[0].step(patch.filterEnv);
+    float ampEnvOutput_raw = envelopes[1].step(patch.ampEnv);
 
-    float filter_velocity_scaler = (1.0f - filterEnvVelocitySensitivity) + (velocityValue * filterEnvVelocitySensitivity);
+    float filter_velocity_scaler = (1.0f - patch.filterEnvVelocitySensitivity) + (velocityValue * patch.filterEnvVelocitySensitivity);
     float filterEnvOutput = filterEnvOutput_raw * filter_velocity_scaler; 
+    float amp_velocity_scaler = (1.0f - patch.ampVelocitySensitivity) + (velocityValue * patch.ampVelocitySensitivity);
+    float ampEnvOutput = ampEnvOutput_raw * amp_velocity_scaler;
 
-    float drift1_pitch_val = analogDriftPitch1.process(); 
-    float drift2_pitch_val = analogDriftPitch2.process(); 
-    float drift1_pw_val = analogDriftPW1.process();       
-    float drift2_pw_val = analogDriftPW2.process();       
-
-    float osc1_pitch_drift_cents = drift1_pitch_val * pitchDriftDepthCents;
-    float osc2_pitch_drift_cents = drift2_pitch_val * pitchDriftDepthCents; 
-    float osc1_pw_drift_offset = drift1_pw_val * pwDriftDepth;
-    float osc2_pw_drift_offset = drift2_pw_val * pwDriftDepth;
+    // Drift generators only run when their depth is non-zero.
+    float osc1_pitch_drift_cents = 0.0f;
+    float osc2_pitch_drift_cents = 0.0f;
+    float osc1_pw_drift_offset = 0.0f;
+    float osc2_pw_drift_offset = 0.0f;
+    if (patch.analogPitchDriftDepth != 0.0f) {
+        osc1_pitch_drift_cents = analogDriftPitch1.process() * patch.analogPitchDriftDepth;
+        osc2_pitch_drift_cents = analogDriftPitch2.process() * patch.analogPitchDriftDepth;
+    }
+    if (patch.analogPWDriftDepth != 0.0f) {
+        osc1_pw_drift_offset = analogDriftPW1.process() * patch.analogPWDriftDepth;
+        osc2_pw_drift_offset = analogDriftPW2.process() * patch.analogPWDriftDepth;
+    }
 
-    osc1.setPWMSource(lfoMod.osc1PwMod);
-    osc1.setWheelModPWValue(lfoMod.wheelOsc1PwOffset); 
-    osc2.setPWMSource(lfoMod.osc2PwMod);
-    osc2.setWheelModPWValue(lfoMod.wheelOsc2PwOffset); 
-    
     float baseFreqVCOA_unbent_glided = this->currentOutputFreq;
-    float driftedBaseFreqVCOA = baseFreqVCOA_unbent_glided * std::pow(2.0f, osc1_pitch_drift_cents / 1200.0f);
-    float totalPitchModSemitonesVCOA = lfoMod.osc1FreqMod + (currentPitchBendValue * pitchBendRangeInSemitones);
-    float freqAfterStdModsVCOA = driftedBaseFreqVCOA * std::pow(2.0f, totalPitchModSemitonesVCOA / 12.0f);
-    float pm_env_to_freqA_hz_offset = ((filterEnvOutput - 0.5f) * 2.0f) * pm_filterEnv_to_freqA_amt * (baseFreqVCOA_unbent_glided * 2.0f); 
-    float baseFreqOsc1BeforeFM = freqAfterStdModsVCOA + pm_env_to_freqA_hz_offset;
-
-    float baseFreqOsc2BeforeFM;
-    if (vcoBLowFreqEnabled) {
-        const float minLfoRate = 0.05f;
-        const float maxLfoRate = 20.0f;
-        float osc2_lfo_base_rate = minLfoRate * std::pow(maxLfoRate / minLfoRate, vcoBFreqKnob); 
-        baseFreqOsc2BeforeFM = osc2_lfo_base_rate * std::pow(2.0f, lfoMod.osc2FreqMod / 12.0f); 
-    } else {
-        float baseFreqVCOB_unbent = (vcoBKeyFollowEnabled_ ? this->currentOutputFreq 
-                                                            : ((vcoBFixedBaseFreq_ < 0.0f) ? 261.63f : vcoBFixedBaseFreq_));
-        float driftedBaseFreqVCOB = baseFreqVCOB_unbent * std::pow(2.0f, osc2_pitch_drift_cents / 1200.0f);
-        float totalPitchModSemitonesVCOB = lfoMod.osc2FreqMod + (currentPitchBendValue * pitchBendRangeInSemitones);
-        float freqAfterStdModsVCOB = driftedBaseFreqVCOB * std::pow(2.0f, totalPitchModSemitonesVCOB / 12.0f);
-        float semitone_offset_from_knob = (vcoBFreqKnob - 0.5f) * 2.0f * 30.0f; 
-        float freqAfterKnobVCOB = freqAfterStdModsVCOB * std::pow(2.0f, semitone_offset_from_knob / 12.0f);
-        baseFreqOsc2BeforeFM = freqAfterKnobVCOB * std::pow(2.0f, vcoBDetuneCents / 1200.0f);
+
+    // Modulation and the pitch from glide, drift, modulation and bend are
+    // control-rate work; with the default interval of 1 they are recomputed
+    // every sample.
+    if (controlCountdown_ <= 0) {
+        controlCountdown_ = controlInterval_;
+        mod.evaluateVoice(filterEnvOutput, ampEnvOutput, velocityValue, lfos, controlMod_);
+
+        float driftedBaseFreqVCOA = baseFreqVCOA_unbent_glided;
+        if (osc1_pitch_drift_cents != 0.0f) {
+            driftedBaseFreqVCOA *= std::pow(2.0f, osc1_pitch_drift_cents / 1200.0f);
+        }
+        float totalPitchModSemitonesVCOA = controlMod_[ModDestination::Osc1Pitch] + (currentPitchBendValue * pitchBendRangeInSemitones);
+        freqAfterStdModsVCOA_ = driftedBaseFreqVCOA * std::pow(2.0f, totalPitchModSemitonesVCOA / 12.0f);
+
+        if (patch.vcoBLowFreqEnabled) {
+            baseFreqOsc2BeforeFM_ = kernel.vcoBLowFreqRateHz * std::pow(2.0f, controlMod_[ModDestination::Osc2Pitch] / 12.0f);
+        } else {
+            float baseFreqVCOB_unbent = (patch.vcoBKeyFollowEnabled ? this->currentOutputFreq 
+                                                                : ((vcoBFixedBaseFreq_ < 0.0f) ? 261.63f : vcoBFixedBaseFreq_));
+            float driftedBaseFreqVCOB = baseFreqVCOB_unbent;
+            if (osc2_pitch_drift_cents != 0.0f) {
+                driftedBaseFreqVCOB *= std::pow(2.0f, osc2_pitch_drift_cents / 1200.0f);
+            }
+            float totalPitchModSemitonesVCOB = controlMod_[ModDestination::Osc2Pitch] + (currentPitchBendValue * pitchBendRangeInSemitones);
+            float freqAfterStdModsVCOB = driftedBaseFreqVCOB * std::pow(2.0f, totalPitchModSemitonesVCOB / 12.0f);
+            float freqAfterKnobVCOB = freqAfterStdModsVCOB * kernel.vcoBKnobRatio;
+            baseFreqOsc2BeforeFM_ = freqAfterKnobVCOB * kernel.vcoBDetuneRatio;
+        }
     }
+    --controlCountdown_;
+
+    const float baseFreqOsc2BeforeFM = baseFreqOsc2BeforeFM_;
 
     float osc2_final_freq = baseFreqOsc2BeforeFM;
-    if (std::abs(xmodOsc1ToOsc2FMAmount_) > 0.001f) { 
-        osc2_final_freq = baseFreqOsc2BeforeFM * std::pow(2.0f, lastS1OutputForFM_ * xmodOsc1ToOsc2FMAmount_ * FM_OCTAVE_RANGE);
+    if ((Stages & VOICE_STAGE_XMOD) && std::abs(patch.xmodOsc1ToOsc2FMAmount) > 0.001f) { 
+        osc2_final_freq = baseFreqOsc2BeforeFM * std::pow(2.0f, lastS1OutputForFM_ * patch.xmodOsc1ToOsc2FMAmount * FM_OCTAVE_RANGE);
     }
+    osc2.updateOversampling(baseFreqOsc2BeforeFM * kernel.osc2SpectrumReach);
     osc2.setFrequency(std::max(0.0f, osc2_final_freq));
     osc2.setDriftPWValue(osc2_pw_drift_offset); 
-    float s2_output = osc2.process(); 
+    osc2.setPolyModPWValue(controlMod_[ModDestination::Osc2PulseWidth]);
+    float s2_output = osc2.render(kernel.osc2, patch.pulseWidth, patch.osc2Harmonics); 
+
+    // Everything read from here on also sees oscillator B as a source.
+    const ModVector* modNow = &controlMod_;
+    if (mod.hasOscB()) {
+        audioMod_ = controlMod_;
+        mod.addOscB(s2_output, audioMod_);
+        modNow = &audioMod_;
+    }
+    const ModVector& m = *modNow;
+
+    float baseFreqOsc1BeforeFM = freqAfterStdModsVCOA_ + m[ModDestination::Osc1LinearFM] * baseFreqVCOA_unbent_glided;
 
     float osc1_final_freq = baseFreqOsc1BeforeFM;
-    if (std::abs(xmodOsc2ToOsc1FMAmount_) > 0.001f) { 
-        osc1_final_freq = baseFreqOsc1BeforeFM * std::pow(2.0f, s2_output * xmodOsc2ToOsc1FMAmount_ * FM_OCTAVE_RANGE);
+    if ((Stages & VOICE_STAGE_XMOD) && std::abs(patch.xmodOsc2ToOsc1FMAmount) > 0.001f) { 
+        osc1_final_freq = baseFreqOsc1BeforeFM * std::pow(2.0f, s2_output * patch.xmodOsc2ToOsc1FMAmount * FM_OCTAVE_RANGE);
+    }
+    if constexpr ((Stages & VOICE_STAGE_UNISON) != 0) {
+        unison_.updateOversampling(baseFreqOsc1BeforeFM * kernel.osc1SpectrumReach);
+    } else {
+        osc1.updateOversampling(baseFreqOsc1BeforeFM * kernel.osc1SpectrumReach);
     }
     osc1.setFrequency(std::max(0.0f, osc1_final_freq)); 
     osc1.setDriftPWValue(osc1_pw_drift_offset); 
 
-    float filterEnv_pwm_mod_scaled = (filterEnvOutput - 0.5f) * 2.0f; 
-    float vco1_pm_env_pw_effect = filterEnv_pwm_mod_scaled * pm_filterEnv_to_pwA_amt * 0.5f;
-    float vco1_pm_oscB_pw_effect = s2_output * pm_oscB_to_pwA_amt * 0.5f; 
-    osc1.setPolyModPWValue(vco1_pm_env_pw_effect + vco1_pm_oscB_pw_effect); 
+    osc1.setPolyModPWValue(m[ModDestination::Osc1PulseWidth]);
     
-    if (syncEnabled && s2_output > 0.0f && lastOsc2 <= 0.0f) { 
-        osc1.sync();
+    constexpr bool unison = (Stages & VOICE_STAGE_UNISON) != 0;
+
+    if ((Stages & VOICE_STAGE_SYNC) && s2_output > 0.0f && lastOsc2 <= 0.0f) { 
+        if constexpr (unison) {
+            unison_.sync();
+        } else {
+            osc1.sync();
+        }
     }
     lastOsc2 = s2_output;
 
-    float s1_output = osc1.process();
-    lastS1OutputForFM_ = s1_output; 
-
-    float noise = distribution(generator);
-    float ringModOutput = s1_output * s2_output * ringModLevel_;
-    float mixed_pre_drive = (osc1Level * s1_output + osc2Level * s2_output + noiseLevel * noise + ringModOutput);
-
-    float mixed_signal_after_drive;
-    if (mixerDrive_ <= 0.001f) { 
-        mixed_signal_after_drive = mixed_pre_drive; 
+    float s1_output;
+    UnisonOutput stack;
+    if constexpr (unison) {
+        unison_.render(kernel.osc1Stack, kernel.unison, osc1_final_freq,
+                       osc1.effectivePulseWidth(patch.pulseWidth),
+                       patch.osc1Harmonics, stack);
+        s1_output = stack.mono;
     } else {
-        float input_gain = 1.0f + mixerDrive_ * Voice::MAX_DRIVE_BOOST;
-        mixed_signal_after_drive = std::tanh(mixed_pre_drive * input_gain);
+        s1_output = osc1.render(kernel.osc1, patch.pulseWidth, patch.osc1Harmonics);
     }
-    float mixed = mixed_signal_after_drive * mixerPostGain_;
-
-
-    float vcfLfoModOffset = lfoMod.vcfCutoffMod; 
-    float pm_env_to_vcf_hz_offset = ((filterEnvOutput - 0.5f) * 2.0f) * pm_filterEnv_to_filterCutoff_amt * 2000.0f;
-    float pm_oscB_to_vcf_hz_offset = s2_output * pm_oscB_to_filterCutoff_amt * 2000.0f; 
-    
-    filter.setEnvelopeValue(filterEnvOutput); 
-    float directVcfModHz = vcfLfoModOffset + pm_env_to_vcf_hz_offset + pm_oscB_to_vcf_hz_offset;
-    float filtered = filter.process(mixed, directVcfModHz);
-
-    float amp_velocity_scaler = (1.0f - ampVelocitySensitivity) + (velocityValue * ampVelocitySensitivity);
-    float ampEnvOutput = ampEnvOutput_raw * amp_velocity_scaler;
-    float finalOutput = filtered * ampEnvOutput;
-    
-    return finalOutput;
-}
-
-bool Voice::isActive() const {
-    return active || envelopes[0].isActive() || envelopes[1].isActive();
-}
-
-void Voice::setOsc1Waveform(Waveform wf) {
-    osc1.setWaveform(wf);
-}
-
-void Voice::setOsc2Waveform(Waveform wf) {
-    osc2.setWaveform(wf);
-}
-
-void Voice::setOsc1Level(float level) { osc1Level = std::clamp(level, 0.0f, 1.0f); }
-void Voice::setOsc2Level(float level) { osc2Level = std::clamp(level, 0.0f, 1.0f); }
-void Voice::setNoiseLevel(float level) { noiseLevel = std::clamp(level, 0.0f, 1.0f); }
-void Voice::setRingModLevel(float level) { ringModLevel_ = std::clamp(level, 0.0f, 1.0f); }
-
-void Voice::setMixLevels(float level1, float level2, float noise, float ringMod) {
-    osc1Level = std::clamp(level1, 0.0f, 1.0f);
-    osc2Level = std::clamp(level2, 0.0f, 1.0f);
-    noiseLevel = std::clamp(noise, 0.0f, 1.0f);
-    ringModLevel_ = std::clamp(ringMod, 0.0f, 1.0f);
-}
+    lastS1OutputForFM_ = s1_output; 
 
+    const float osc1Level = std::clamp(patch.osc1Level + m[ModDestination::Osc1Level], 0.0f, 1.0f);
+    const float osc2Level = std::clamp(patch.osc2Level + m[ModDestination::Osc2Level], 0.0f, 1.0f);
 
-void Voice::setVCOBDetuneCents(float cents) { vcoBDetuneCents = cents; }
-void Voice::setSyncEnabled(bool enabled) { syncEnabled = enabled; }
-void Voice::setPulseWidth(float width) {
-    osc1.setPulseWidth(width);
-    osc2.setPulseWidth(width);
-}
-void Voice::setPWMDepth(float depth) {
-    osc1.setPWMDepth(depth);
-    osc2.setPWMDepth(depth);
-}
-void Voice::setVCOBLowFreqEnabled(bool enabled) {
-    vcoBLowFreqEnabled = enabled;
-}
-void Voice::setVCOBFreqKnob(float knobValue) {
-    vcoBFreqKnob = std::clamp(knobValue, 0.0f, 1.0f);
-}
-
-void Voice::setVCOBKeyFollowEnabled(bool enabled) {
-    vcoBKeyFollowEnabled_ = enabled;
-    if (enabled && active) { 
-        vcoBFixedBaseFreq_ = this->targetKeyFreq;
+    // In unison everything except the oscillator A stack is centred.
+    float mixed_pre_drive = unison ? osc2Level * s2_output
+                                   : osc1Level * s1_output + osc2Level * s2_output;
+    if constexpr ((Stages & VOICE_STAGE_NOISE) != 0) {
+        const float noiseLevel = std::clamp(patch.noiseLevel + m[ModDestination::NoiseLevel], 0.0f, 1.0f);
+        mixed_pre_drive += noiseLevel * noiseDistribution_(noiseGenerator_);
+    }
+    if constexpr ((Stages & VOICE_STAGE_RINGMOD) != 0) {
+        mixed_pre_drive += s1_output * s2_output * patch.ringModLevel;
     }
-}
-
-void Voice::setXModOsc2ToOsc1FMAmount(float amount) {
-    xmodOsc2ToOsc1FMAmount_ = std::clamp(amount, -1.0f, 1.0f);
-}
-void Voice::setXModOsc1ToOsc2FMAmount(float amount) {
-    xmodOsc1ToOsc2FMAmount_ = std::clamp(amount, -1.0f, 1.0f);
-}
-
-
-void Voice::setPMFilterEnvToFreqAAmount(float amount) {
-    pm_filterEnv_to_freqA_amt = std::clamp(amount, 0.0f, 1.0f);
-}
-void Voice::setPMFilterEnvToPWAAmount(float amount) {
-    pm_filterEnv_to_pwA_amt = std::clamp(amount, 0.0f, 1.0f);
-}
-void Voice::setPMFilterEnvToFilterCutoffAmount(float amount) {
-    pm_filterEnv_to_filterCutoff_amt = std::clamp(amount, 0.0f, 1.0f);
-}
-void Voice::setPMOscBToPWAAmount(float amount) {
-    pm_oscB_to_pwA_amt = std::clamp(amount, 0.0f, 1.0f);
-}
-void Voice::setPMOscBToFilterCutoffAmount(float amount) {
-    pm_oscB_to_filterCutoff_amt = std::clamp(amount, 0.0f, 1.0f);
-}
 
-void Voice::setFilterType(SynthParams::FilterType type) {
-    filter.setType(type);
-}
-void Voice::setVCFResonance(float q)         { filter.setResonance(q); }
-void Voice::setVCFKeyFollow(float f)         { filter.setKeyFollow(f); }
-void Voice::setVCFEnvelopeAmount(float amt)  { filter.setEnvelopeMod(amt); }
-void Voice::setVCFBaseCutoff(float hz)       { filter.setBaseCutoff(hz); }
+    float mixed_pre_drive_r = 0.0f;
+    if constexpr (unison) {
+        constexpr float centreGain = 0.70710678f; // equal-power pan at 0
+        mixed_pre_drive_r = osc1Level * stack.right + mixed_pre_drive * centreGain;
+        mixed_pre_drive = osc1Level * stack.left + mixed_pre_drive * centreGain;
+    }
 
-void Voice::setAmpEnvelope(const EnvelopeParams& p) {
-    envelopes[1] = Envelope(p.attack, p.decay, p.sustain, p.release, sampleRate);
-}
+    float mixed_signal_after_drive = mixed_pre_drive;
+    float mixed_signal_after_drive_r = mixed_pre_drive_r;
+    if constexpr ((Stages & VOICE_STAGE_DRIVE) != 0) {
+        const float drive = std::clamp(patch.mixerDrive + m[ModDestination::Drive], 0.0f, 1.0f);
+        float input_gain = 1.0f + drive * Voice::MAX_DRIVE_BOOST;
+        mixed_signal_after_drive = driveShaper_.process(mixed_pre_drive * input_gain);
+        if constexpr (unison) {
+            mixed_signal_after_drive_r = driveShaperR_.process(mixed_pre_drive_r * input_gain);
+        }
+    }
+    float mixed = mixed_signal_after_drive * patch.mixerPostGain;
 
-void Voice::setFilterEnvelope(const EnvelopeParams& p) {
-    envelopes[0] = Envelope(p.attack, p.decay, p.sustain, p.release, sampleRate);
-}
 
-void Voice::setFilterEnvVelocitySensitivity(float amount) {
-    filterEnvVelocitySensitivity = std::clamp(amount, 0.0f, 1.0f);
-}
+    const VCFParams* filterParams = &patch.filter;
+    if (mod.targets(ModDestination::FilterResonance)) {
+        modulatedFilter_ = patch.filter;
+        modulatedFilter_.resonance = std::clamp(patch.filter.resonance + m[ModDestination::FilterResonance], 0.0f, 1.0f);
+        filterParams = &modulatedFilter_;
+    }
+    filter.setEnvelopeValue(filterEnvOutput); 
+    float directVcfModHz = m[ModDestination::FilterCutoff];
+    float filtered = filter.process<FT>(*filterParams, mixed, directVcfModHz);
 
-void Voice::setAmpVelocitySensitivity(float amount) {
-    ampVelocitySensitivity = std::clamp(amount, 0.0f, 1.0f);
-}
+    ampEnvOutput *= std::max(0.0f, 1.0f + m[ModDestination::Amplitude]);
 
-void Voice::setPitchDriftDepth(float cents) {
-    pitchDriftDepthCents = cents;
+    StereoSample out;
+    if constexpr (unison) {
+        filterR_.setEnvelopeValue(filterEnvOutput);
+        float filteredR = filterR_.process<FT>(*filterParams, mixed_signal_after_drive_r * patch.mixerPostGain, directVcfModHz);
+        out.L = filtered * ampEnvOutput;
+        out.R = filteredR * ampEnvOutput;
+    } else {
+        float finalOutput = filtered * ampEnvOutput;
+        out.L = finalOutput * panGainL_;
+        out.R = finalOutput * panGainR_;
+    }
+    return out;
 }
 
-void Voice::setPWDriftDepth(float depth) {
-    pwDriftDepth = depth;
+bool Voice::isActive() const {
+    return active || envelopes[0].isActive() || envelopes[1].isActive();
 }
 
-void Voice::setOsc1HarmonicAmplitude(int harmonicIndex, float amplitude) {
-    osc1.setHarmonicAmplitude(harmonicIndex, amplitude);
+void Voice::setPanning(float pan) {
+    panning_ = std::clamp(pan, -1.0f, 1.0f);
+    float panAngle = (panning_ + 1.0f) * 0.5f * static_cast<float>(M_PI_2);
+    panGainL_ = std::cos(panAngle);
+    panGainR_ = std::sin(panAngle);
 }
 
-void Voice::setOsc2HarmonicAmplitude(int harmonicIndex, float amplitude) {
-    osc2.setHarmonicAmplitude(harmonicIndex, amplitude);
+void Voice::attachAdditive(AdditiveVoiceState* state) {
+    osc1.attachAdditiveBuffers(state ? state->osc1 : nullptr);
+    osc2.attachAdditiveBuffers(state ? state->osc2 : nullptr);
+    unison_.attachAdditiveBuffers(state ? state->unison : nullptr);
 }
 
-void Voice::setPanning(float pan) {
-    panning_ = std::clamp(pan, -1.0f, 1.0f);
+void Voice::setQuality(const QualitySettings& quality) {
+    controlInterval_ = std::max(1, quality.controlInterval);
+    osc1.setMaxOversampling(quality.maxOversampling);
+    osc2.setMaxOversampling(quality.maxOversampling);
+    unison_.setMaxOversampling(quality.maxOversampling);
+    osc1.setAdditivePartialLimit(quality.additivePartials);
+    osc2.setAdditivePartialLimit(quality.additivePartials);
+    unison_.setAdditivePartialLimit(quality.additivePartials);
+    filter.setControlInterval(quality.controlInterval);
+    filterR_.setControlInterval(quality.controlInterval);
 }
 
 float Voice::getPanning() const {
     return panning_;
 }
-
-void Voice::setMixerDrive(float drive) {
-    mixerDrive_ = std::clamp(drive, 0.0f, 1.0f);
-}
-
-void Voice::setMixerPostGain(float gain) {
-    mixerPostGain_ = std::max(0.0f, gain); 
-}
\ No newline at end of file
@@ -7,14 +7,69 @@
 #include "lfo.h"
 #include "analog_drift.h"
 #include "synth_parameters.h"
-struct LfoModulationValues {
-float osc1FreqMod = 0.0f;
-float osc2FreqMod = 0.0f;
-float osc1PwMod = 0.0f;
-float osc2PwMod = 0.0f;
-float wheelOsc1PwOffset = 0.0f;
-float wheelOsc2PwOffset = 0.0f;
-float vcfCutoffMod = 0.0f;
+#include "patch.h"
+#include "mod_matrix.h"
+#include "stereo_sample.h"
+#include "unison_stack.h"
+#include "waveshaper.h"
+#include "quality_governor.h"
+#include <random>
+#include <utility>
+
+// Optional stages of the voice signal path. Voice has a kernel instantiated for
+// every combination (and every filter type), so a stage that the patch leaves
+// unused costs nothing per sample.
+enum VoiceStage : unsigned {
+    VOICE_STAGE_NOISE   = 1u << 0,
+    VOICE_STAGE_RINGMOD = 1u << 1,
+    VOICE_STAGE_DRIVE   = 1u << 2,
+    VOICE_STAGE_SYNC    = 1u << 3,
+    VOICE_STAGE_XMOD    = 1u << 4,
+    VOICE_STAGE_UNISON  = 1u << 5,
+    VOICE_STAGE_COMBINATIONS = 1u << 6
+};
+
+class Voice;
+
+// Overlap-add buffers of one voice's additive oscillators, about 4 KB. They
+// are kept out of Voice in a pool (see PolySynth) and attached only while an
+// oscillator renders additively.
+struct AdditiveVoiceState {
+    float osc1[MonoAdditiveOscillator::BUFFER_FLOATS];
+    float osc2[MonoAdditiveOscillator::BUFFER_FLOATS];
+    float unison[StereoAdditiveOscillator::BUFFER_FLOATS];
+};
+
+// Everything Voice::process needs to know about the shape of the current patch,
+// resolved once per patch change by Voice::selectKernel().
+struct VoiceKernel {
+    StereoSample (Voice::*process)(const Patch&, const VoiceKernel&, const ModMatrix&, const LfoValues&, float) = nullptr;
+    HarmonicOscillator::RenderFn osc1 = nullptr;
+    HarmonicOscillator::RenderFn osc2 = nullptr;
+    UnisonStack::RenderFn osc1Stack = nullptr;
+    unsigned stages = 0;
+    bool additive = false; // needs AdditiveVoiceState attached
+
+    UnisonLayout unison;
+
+    // How far each oscillator's spectrum reaches, in multiples of its pre-FM
+    // frequency relative to a naive saw; drives per-voice oversampling.
+    // Zero means the oscillator never needs it.
+    float osc1SpectrumReach = 1.0f;
+    float osc2SpectrumReach = 1.0f;
+
+    // VCO-B frequency factors that only depend on the patch.
+    float vcoBLowFreqRateHz = 0.0f;
+    float vcoBKnobRatio = 1.0f;
+    float vcoBDetuneRatio = 1.0f;
+
+    // Whether a voice does the same work under both kernels: same kernel
+    // function (filter type and stages), oscillator renderers and unison
+    // size. Parameter values do not count.
+    bool sameWorkAs(const VoiceKernel& other) const {
+        return process == other.process && osc1 == other.osc1 && osc2 == other.osc2 &&
+               osc1Stack == other.osc1Stack && stages == other.stages && unison.members == other.unison.members;
+    }
 };
 class Voice {
 private:
@@ -26,35 +81,30 @@ int noteNumber = 60;
 HarmonicOscillator osc1;
 HarmonicOscillator osc2;
 
-float osc1Level = 1.0f;
-float osc2Level = 0.0f;
-float noiseLevel = 0.0f;
-float ringModLevel_ = 0.0f; 
-
 float lastOsc2 = 0.0f;
 float lastS1OutputForFM_ = 0.0f; 
 
-float vcoBDetuneCents = 0.0f;
-bool vcoBLowFreqEnabled = false;
-float vcoBFreqKnob = 0.5f;
-bool vcoBKeyFollowEnabled_;       
 float vcoBFixedBaseFreq_;         
 
-bool syncEnabled = false;
-
-float filterEnvVelocitySensitivity = 0.0f;
-float ampVelocitySensitivity = 0.0f;
-
-float xmodOsc2ToOsc1FMAmount_ = 0.0f; 
-float xmodOsc1ToOsc2FMAmount_ = 0.0f; 
-
-float pm_filterEnv_to_freqA_amt = 0.0f;
-float pm_filterEnv_to_pwA_amt = 0.0f;
-float pm_filterEnv_to_filterCutoff_amt = 0.0f;
-float pm_oscB_to_pwA_amt = 0.0f;
-float pm_oscB_to_filterCutoff_amt = 0.0f;
+// Control-rate pitch and modulation state, refreshed every controlInterval_
+// samples.
+int controlInterval_ = 1;
+int controlCountdown_ = 0;
+ModVector controlMod_;
+// Per-sample scratch for oscillator B as a source and resonance modulation.
+ModVector audioMod_;
+VCFParams modulatedFilter_;
+float freqAfterStdModsVCOA_ = 0.0f;
+float baseFreqOsc2BeforeFM_ = 0.0f;
 
 VCF filter;
+AdaaTanh driveShaper_;
+
+// Unison: oscillator A becomes a stereo stack, so the mixer and filter run
+// once per channel. The right-hand state is idle otherwise.
+UnisonStack unison_;
+VCF filterR_;
+AdaaTanh driveShaperR_;
 
 Envelope envelopes[2];
 
@@ -73,25 +123,41 @@ AnalogDrift analogDriftPitch1;
 AnalogDrift analogDriftPitch2;
 AnalogDrift analogDriftPW1;
 AnalogDrift analogDriftPW2;
-float pitchDriftDepthCents; 
-float pwDriftDepth;         
+
+// Per voice, so voices rendered on different threads share no state.
+std::default_random_engine noiseGenerator_;
+std::uniform_real_distribution<float> noiseDistribution_;
 
 float panning_ = 0.0f; 
+float panGainL_;
+float panGainR_;
+
+void noteOnDetailed(const Patch& patch, float newTargetFrequency, float normalizedVelocity, int midiNoteNum);
 
-float mixerDrive_;      
-float mixerPostGain_;   
+using KernelFn = StereoSample (Voice::*)(const Patch&, const VoiceKernel&, const ModMatrix&, const LfoValues&, float);
 
-void noteOnDetailed(float newTargetFrequency, float normalizedVelocity, int midiNoteNum, bool useGlide, float glideTimeSec);
+template <SynthParams::FilterType FT, unsigned Stages>
+StereoSample processKernel(const Patch& patch, const VoiceKernel& kernel, const ModMatrix& mod,
+                           const LfoValues& lfos, float currentPitchBendValue);
+
+template <SynthParams::FilterType FT, unsigned... Stages>
+static KernelFn kernelFor(unsigned stages, std::integer_sequence<unsigned, Stages...>);
 
 public:
-Voice(int sampleRate, int numHarmonics);
+Voice(int sampleRate);
 
 static constexpr float MAX_DRIVE_BOOST = 9.0f; 
 
-void noteOn(float freq, float velocity, int midiNoteNum, bool globalGlideEnabled, float globalGlideTimeSeconds);
+void noteOn(const Patch& patch, float freq, float velocity, int midiNoteNum);
 
 void noteOff();
-float process(const LfoModulationValues& lfoMod, float currentPitchBendValue, float pitchBendRangeInSemitones);
+static VoiceKernel selectKernel(const Patch& patch);
+// Returns the voice already panned (or spread, in unison) to stereo. `lfos`
+// carries this voice's per-voice LFOs (see LfoBank::voiceValues).
+StereoSample process(const Patch& patch, const VoiceKernel& kernel, const ModMatrix& mod, const LfoValues& lfos,
+                     float currentPitchBendValue) {
+    return (this->*kernel.process)(patch, kernel, mod, lfos, currentPitchBendValue);
+}
 bool isActive() const;
 
 float getTargetKeyFrequency() const { return targetKeyFreq; }; 
@@ -105,54 +171,15 @@ void setNoteOnTimestamp(unsigned long long ts) { noteOnTimestamp = ts; }
 bool isGateOpen() const { return active; }
 bool areEnvelopesActive() const { return envelopes[0].isActive() || envelopes[1].isActive(); }
 
-
-void setOsc1Waveform(Waveform wf);
-void setOsc2Waveform(Waveform wf);
-
-void setOsc1Level(float level);
-void setOsc2Level(float level);
-void setNoiseLevel(float level);
-void setRingModLevel(float level);
-void setMixLevels(float level1, float level2, float noise, float ringMod);
-
-void setVCOBDetuneCents(float cents);
-void setSyncEnabled(bool enabled);
-void setPulseWidth(float width);
-void setPWMDepth(float depth);
-void setVCOBLowFreqEnabled(bool enabled);
-void setVCOBFreqKnob(float knobValue); 
-void setVCOBKeyFollowEnabled(bool enabled); 
-void setFilterEnvVelocitySensitivity(float amount); 
-void setAmpVelocitySensitivity(float amount);       
-
-void setXModOsc2ToOsc1FMAmount(float amount);
-void setXModOsc1ToOsc2FMAmount(float amount);
-
-void setPMFilterEnvToFreqAAmount(float amount);
-void setPMFilterEnvToPWAAmount(float amount);
-void setPMFilterEnvToFilterCutoffAmount(float amount);
-void setPMOscBToPWAAmount(float amount);
-void setPMOscBToFilterCutoffAmount(float amount);
-
-void setFilterType(SynthParams::FilterType type);
-void setVCFResonance(float q);
-void setVCFKeyFollow(float f);
-void setVCFEnvelopeAmount(float amt);
-void setVCFBaseCutoff(float hz);
-
-void setAmpEnvelope(const EnvelopeParams& p);
-void setFilterEnvelope(const EnvelopeParams& p);
-
-void setPitchDriftDepth(float cents);
-void setPWDriftDepth(float depth);
-
-void setOsc1HarmonicAmplitude(int harmonicIndex, float amplitude); 
-void setOsc2HarmonicAmplitude(int harmonicIndex, float amplitude); 
-
 void setPanning(float pan); 
 float getPanning() const;
 
-void setMixerDrive(float drive);
-void setMixerPostGain(float gain);
+// Hands the voice its additive buffers, or takes them back with nullptr.
+// Audio thread, on patch change.
+void attachAdditive(AdditiveVoiceState* state);
+
+// Applies a quality tier's oversampling cap, control interval and additive
+// partial limit. Audio thread.
+void setQuality(const QualitySettings& quality);
 
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+// synth/voice_budget.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+// Dynamic polyphony limit. Each rendered block is fitted to
+//     load = fixed + perVoice * averageActiveVoices
+// (load being render time over block duration), and the cap is the number of
+// voices that fits in the budget at the current per-voice cost. The estimate
+// restarts when the quality tier changes or a patch change gives the voices
+// different work (see VoiceKernel::sameWorkAs), since both change what a
+// voice costs.
+//
+// There is no cap until a budget is set: offline renders have no deadline
+// and should never lose notes to a busy machine.
+//
+// onBlock() and restartEstimate() run on the audio thread; the rest is safe
+// from any thread.
+class VoiceBudget {
+public:
+    // A reasonable budget for live playback, leaving room for the host.
+    static constexpr float LIVE_BUDGET = 0.7f;
+    static constexpr float MIN_BUDGET = 0.05f;
+    static constexpr double TIME_CONSTANT_SECONDS = 0.5;
+    // The cap only rises once the budget fits this much more than one extra
+    // voice, so it does not flap around a boundary.
+    static constexpr float RAISE_MARGIN = 0.5f;
+
+    explicit VoiceBudget(int maxVoices) : maxVoices_(maxVoices), cap_(maxVoices) {}
+
+    // For pools whose size changes (see SynthEngine); not while onBlock() runs.
+    void setMaxVoices(int maxVoices) {
+        maxVoices_.store(std::max(1, maxVoices), std::memory_order_relaxed);
+        cap_.store(std::min(cap_.load(std::memory_order_relaxed), getMaxVoices()), std::memory_order_relaxed);
+    }
+    int getMaxVoices() const { return maxVoices_.load(std::memory_order_relaxed); }
+
+    // Fraction of each block's duration that voices and effects may use, or 0
+    // (or less) for no cap.
+    void setBudget(float loadFraction) {
+        const float budget = loadFraction > 0.0f ? std::clamp(loadFraction, MIN_BUDGET, 1.0f) : 0.0f;
+        budget_.store(budget, std::memory_order_relaxed);
+    }
+    float getBudget() const { return budget_.load(std::memory_order_relaxed); }
+    bool isLimited() const { return getBudget() > 0.0f; }
+
+    int getCap() const { return isLimited() ? cap_.load(std::memory_order_relaxed) : getMaxVoices(); }
+    // Estimated load of one voice with the current patch, 0 until measured.
+    float getVoiceLoad() const { return voiceLoadOut_.load(std::memory_order_relaxed); }
+
+    void restartEstimate() { voiceBlocks_ = 0; }
+
+    void onBlock(double renderSeconds, double blockSeconds, double averageVoices) {
+        if (blockSeconds <= 0.0) return;
+        const double load = renderSeconds / blockSeconds;
+        const double ema = 1.0 - std::exp(-blockSeconds / TIME_CONSTANT_SECONDS);
+
+        if (averageVoices < 0.5) {
+            fixedLoad_ += ema * (load - fixedLoad_);
+            return;
+        }
+        const double perVoice = std::max(0.0, load - fixedLoad_) / averageVoices;
+        // Plain running mean over the first blocks after a restart, then an EMA.
+        ++voiceBlocks_;
+        const double alpha = std::max(ema, 1.0 / static_cast<double>(voiceBlocks_));
+        voiceLoad_ += alpha * (perVoice - voiceLoad_);
+        voiceLoadOut_.store(static_cast<float>(voiceLoad_), std::memory_order_relaxed);
+
+        // Unlimited: keep measuring, and start from the full pool once a
+        // budget is set.
+        if (!isLimited()) {
+            cap_.store(getMaxVoices(), std::memory_order_relaxed);
+            return;
+        }
+        if (voiceLoad_ <= 0.0) return;
+        const double fits = (getBudget() - fixedLoad_) / voiceLoad_;
+        int cap = cap_.load(std::memory_order_relaxed);
+        if (fits < cap) {
+            cap = static_cast<int>(fits);
+        } else if (fits >= cap + 1 + RAISE_MARGIN) {
+            cap = static_cast<int>(fits - RAISE_MARGIN);
+        }
+        cap_.store(std::clamp(cap, 1, getMaxVoices()), std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int> maxVoices_;
+    std::atomic<int> cap_;
+    std::atomic<float> budget_{0.0f};
+    std::atomic<float> voiceLoadOut_{0.0f};
+
+    // Audio thread only.
+    double fixedLoad_ = 0.0;
+    double voiceLoad_ = 0.0;
+    long voiceBlocks_ = 0;
+};
@@ -1,6 +1,9 @@
 // synth/waveform.h
 #pragma once
 
+// Number of partials available to the Additive waveform.
+constexpr int NUM_OSC_HARMONICS = 256;
+
 enum class Waveform {
     Sine,
     Saw,
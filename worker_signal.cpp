@@ -0,0 +1,28 @@
+// synth/worker_signal.cpp
+#include "worker_signal.h"
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit integer");
+
+void WorkerSignal::sleep(uint32_t epoch) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAIT_PRIVATE, epoch, nullptr, nullptr, 0);
+#else
+    // No futex: poll at a short interval instead.
+    if (epoch_.load(std::memory_order_acquire) == epoch) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+#endif
+}
+
+void WorkerSignal::wakeAll() {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#endif
+}
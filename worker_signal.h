@@ -0,0 +1,56 @@
+// synth/worker_signal.h
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Wakes a worker thread when the audio thread hands it work. The worker spins
+// for at most SPIN_TIME, far below one block period (1.3 ms for 64 frames at
+// 48 kHz), so a hand-over that follows closely costs no system call; after
+// that it sleeps in the kernel (a futex on Linux) until notify(). notify()
+// never blocks and only makes a system call while a worker is asleep, so the
+// audio thread can call it every block.
+class WorkerSignal {
+public:
+    static constexpr auto SPIN_TIME = std::chrono::microseconds(50);
+
+    // Worker. Returns once ready() holds; ready() must become true before
+    // the notify() that goes with it.
+    template <typename Ready>
+    void wait(Ready ready) {
+        const auto spinUntil = std::chrono::steady_clock::now() + SPIN_TIME;
+        for (unsigned spins = 1; !ready(); ++spins) {
+            if (spins % 64 == 0 && std::chrono::steady_clock::now() >= spinUntil) break;
+            cpuRelax();
+        }
+        while (!ready()) {
+            const uint32_t epoch = epoch_.load(std::memory_order_seq_cst);
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            // Sleeps only while epoch_ is still `epoch`, so a notify() after
+            // the load above is never missed.
+            if (!ready()) sleep(epoch);
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Any thread, after making the work visible.
+    void notify() {
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_seq_cst) > 0) wakeAll();
+    }
+
+private:
+    static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    void sleep(uint32_t epoch);
+    void wakeAll();
+
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<int> sleepers_{0};
+};